@@ -52,9 +52,9 @@ if [ ! -f "build/quill" ]; then
 fi
 
 # Build runtime if needed
-if [ ! -f "runtime.o" ]; then
+if [ ! -f "runtime.o" ] || [ runtime.c -nt runtime.o ]; then
     echo -e "${YELLOW}Building runtime library...${NC}"
-    gcc -c runtime.c -o runtime.o
+    gcc -O2 -c -pthread runtime.c -o runtime.o
 fi
 
 # Compile reference programs
@@ -143,7 +143,7 @@ compile_quill() {
     fi
     
     /opt/homebrew/opt/llvm/bin/llc "benchmarks/$program.quill.o" -o "benchmarks/$program.s"
-    gcc "benchmarks/$program.s" runtime.o -o "$program"
+    gcc "benchmarks/$program.s" runtime.o -pthread -o "$program"
 }
 
 # Benchmark programs
@@ -200,7 +200,7 @@ for program in "${PROGRAMS[@]}"; do
         # Compile with specific optimization level
         if timeout 30 ./build/quill "$opt_level" "benchmarks/$program.quill" > /dev/null 2>&1; then
             if /opt/homebrew/opt/llvm/bin/llc "benchmarks/$program.quill.o" -o "benchmarks/$program.s" > /dev/null 2>&1; then
-                if gcc "benchmarks/$program.s" runtime.o -o "${program}_${opt_level}" > /dev/null 2>&1; then
+                if gcc "benchmarks/$program.s" runtime.o -pthread -o "${program}_${opt_level}" > /dev/null 2>&1; then
                     
                     # Run Quill benchmark
                     quill_results=$(run_benchmark "${program}_${opt_level}" "Quill")
@@ -0,0 +1,138 @@
+#include "corpus_generator.h"
+#include <algorithm>
+#include <random>
+#include <sstream>
+
+using namespace quill;
+
+namespace {
+
+const int LOCALS = 4;
+// Every fourth function calls nothing and only those are called, so
+// programs run in time linear in their size
+const int LEAF_EVERY = 4;
+
+class ProgramWriter {
+public:
+    explicit ProgramWriter(const CorpusShape& shape) : shape(shape), rng(shape.seed) {}
+    
+    std::string write() {
+        for (int i = 0; i < shape.functions; i++) writeFunction(i);
+        
+        out << "def main():\n";
+        out << "    total = 0.0\n";
+        for (int i = std::max(0, shape.functions - 8); i < shape.functions; i++) {
+            out << "    total = total + f" << i << "(1.5, 3)\n";
+        }
+        out << "    print(total)\n";
+        return out.str();
+    }
+    
+private:
+    const CorpusShape& shape;
+    // mt19937 is fully specified, unlike the standard distributions
+    std::mt19937 rng;
+    std::ostringstream out;
+    int function = 0;
+    
+    int pick(int n) { return n > 0 ? (int)(rng() % (uint32_t)n) : 0; }
+    
+    std::string constant() {
+        return std::to_string(pick(100)) + "." + std::to_string(pick(10)) + "5";
+    }
+    
+    std::string variable() {
+        int index = pick(LOCALS + 1);
+        return index == LOCALS ? "a" : "v" + std::to_string(index);
+    }
+    
+    // Every expression is a float, so assignments never change a type
+    std::string expression(int depth) {
+        int choice = pick(10);
+        if (depth == 0 || choice < 3) {
+            if (choice == 0) return constant();
+            if (choice == 1) return "b * " + constant();
+            return variable();
+        }
+        if (choice == 3 && function % LEAF_EVERY != 0) {
+            int leaf = LEAF_EVERY * pick((function + LEAF_EVERY - 1) / LEAF_EVERY);
+            return "f" + std::to_string(leaf) + "(" + expression(depth - 1) + ", b)";
+        }
+        if (choice == 4) {
+            std::string divisor = variable();
+            return "(" + expression(depth - 1) + ") / (" + divisor + " * " + divisor + " + 1.0)";
+        }
+        static const char* const operators[] = {" + ", " - ", " * "};
+        return expression(depth - 1) + operators[pick(3)] + expression(depth - 1);
+    }
+    
+    void indent(int level) { out << std::string(4 * level, ' '); }
+    
+    void writeAssignment(int level) {
+        indent(level);
+        out << "v" << pick(LOCALS) << " = " << expression(3) << "\n";
+    }
+    
+    // Writes `count` statements, blocks counting one plus their contents
+    void writeStatements(int level, int count) {
+        while (count > 0) {
+            count--;
+            if (level <= shape.depth && count >= 2 && pick(3) == 0) {
+                int inner = 1 + pick(std::min(count, 6));
+                count -= inner;
+                writeBlock(level, inner);
+            } else {
+                writeAssignment(level);
+            }
+        }
+    }
+    
+    void writeBlock(int level, int inner) {
+        switch (pick(3)) {
+            case 0: {
+                indent(level);
+                out << "if " << variable() << " > " << variable() << ":\n";
+                int then_count = inner >= 2 && pick(2) ? 1 + pick(inner - 1) : inner;
+                writeStatements(level + 1, then_count);
+                if (then_count < inner) {
+                    indent(level);
+                    out << "else:\n";
+                    writeStatements(level + 1, inner - then_count);
+                }
+                break;
+            }
+            case 1: {
+                std::string counter = "w" + std::to_string(level);
+                indent(level);
+                out << counter << " = 0\n";
+                indent(level);
+                out << "while " << counter << " < " << 2 + pick(6) << ":\n";
+                writeStatements(level + 1, inner);
+                indent(level + 1);
+                out << counter << " = " << counter << " + 1\n";
+                break;
+            }
+            default:
+                indent(level);
+                out << "for i" << level << " in range(" << 2 + pick(6) << "):\n";
+                writeStatements(level + 1, inner);
+                break;
+        }
+    }
+    
+    void writeFunction(int index) {
+        function = index;
+        out << "def f" << index << "(a: float, b: int) -> float:\n";
+        for (int i = 0; i < LOCALS; i++) {
+            out << "    v" << i << " = a * " << constant() << "\n";
+        }
+        writeStatements(1, shape.statements);
+        out << "    return v0 + v1 + v2 + v3\n\n";
+    }
+};
+
+} // namespace
+
+std::string quill::generateProgram(const CorpusShape& shape) {
+    return ProgramWriter(shape).write();
+}
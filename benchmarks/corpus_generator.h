@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace quill {
+
+// Shape of a synthetic Quill program
+struct CorpusShape {
+    int functions = 16;
+    int statements = 32;  // per function, counting those inside blocks
+    int depth = 2;        // deepest nesting of if/while/for blocks
+    uint32_t seed = 1;
+};
+
+// Generates a program that type checks cleanly and compiles at every
+// level. Each function mixes float arithmetic, branches, counted loops and
+// calls to simpler functions defined before it. The same shape always
+// yields the same program.
+std::string generateProgram(const CorpusShape& shape);
+
+} // namespace quill
@@ -0,0 +1,239 @@
+// Microbenchmarks of each compiler phase on synthetic programs.
+//
+//   quill_bench [--functions=1,4,16] [--statements=32] [--depth=2] [--seed=N]
+//               [--emit-corpus] [Google Benchmark flags]
+//
+// Every combination of the listed shapes is measured, so runs over one
+// dimension chart how a phase scales; the fitted complexity is in terms of
+// the program's token count. --emit-corpus prints the program for the
+// first shape instead.
+#include "codegen.h"
+#include "corpus_generator.h"
+#include "lexer.h"
+#include "optimization_passes.h"
+#include "parser.h"
+#include "type_checker.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace quill;
+
+namespace {
+
+struct ShapeGrid {
+    std::vector<int64_t> functions = {1, 4, 16, 64, 256};
+    std::vector<int64_t> statements = {32};
+    std::vector<int64_t> depth = {2};
+    uint32_t seed = 1;
+};
+
+CorpusShape shapeOf(const benchmark::State& state, uint32_t seed) {
+    CorpusShape shape;
+    shape.functions = state.range(0);
+    shape.statements = state.range(1);
+    shape.depth = state.range(2);
+    shape.seed = seed;
+    return shape;
+}
+
+std::unique_ptr<ProgramAST> parse(const std::string& source) {
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    return parser.parse();
+}
+
+// The front end's results for one compile; phases after the one being
+// measured need fresh ones each iteration
+struct Compilation {
+    std::unique_ptr<ProgramAST> program;
+    std::unique_ptr<TypeChecker> type_checker;
+    std::unique_ptr<CodeGen> codegen;  // declared last: uses the range analysis
+    
+    Compilation(const std::string& source, bool check) : program(parse(source)) {
+        if (!check) return;
+        type_checker = std::make_unique<TypeChecker>();
+        type_checker->checkProgram(program.get());
+    }
+    
+    // Configured as CompilerSession does for `level`
+    void prepareCodeGen(QuillOptimizationManager::OptimizationLevel level) {
+        codegen = std::make_unique<CodeGen>();
+        codegen->set_range_info(&type_checker->getRangeAnalysis(), level != QuillOptimizationManager::O0);
+        codegen->elide_bounds_checks = level != QuillOptimizationManager::O0;
+    }
+};
+
+void reportSize(benchmark::State& state, const std::string& source) {
+    Lexer lexer(source);
+    int64_t tokens = lexer.tokenize().size();
+    state.SetBytesProcessed(state.iterations() * source.size());
+    state.counters["tokens"] = tokens;
+    state.SetComplexityN(tokens);
+}
+
+void benchTokenize(benchmark::State& state, uint32_t seed) {
+    std::string source = generateProgram(shapeOf(state, seed));
+    for (auto _ : state) {
+        Lexer lexer(source);
+        auto tokens = lexer.tokenize();
+        benchmark::DoNotOptimize(tokens.data());
+    }
+    reportSize(state, source);
+}
+
+void benchParse(benchmark::State& state, uint32_t seed) {
+    std::string source = generateProgram(shapeOf(state, seed));
+    Lexer lexer(source);
+    const std::vector<Token> tokens = lexer.tokenize();
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<Token> input = tokens;
+        state.ResumeTiming();
+        Parser parser(std::move(input));
+        auto program = parser.parse();
+        benchmark::DoNotOptimize(program.get());
+        state.PauseTiming();
+        program.reset();
+        state.ResumeTiming();
+    }
+    reportSize(state, source);
+}
+
+void benchTypeCheck(benchmark::State& state, uint32_t seed) {
+    std::string source = generateProgram(shapeOf(state, seed));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto compilation = std::make_unique<Compilation>(source, false);
+        TypeChecker type_checker;
+        state.ResumeTiming();
+        auto result = type_checker.checkProgram(compilation->program.get());
+        benchmark::DoNotOptimize(result);
+        state.PauseTiming();
+        compilation.reset();
+        state.ResumeTiming();
+    }
+    reportSize(state, source);
+}
+
+void benchCodeGen(benchmark::State& state, uint32_t seed) {
+    std::string source = generateProgram(shapeOf(state, seed));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto compilation = std::make_unique<Compilation>(source, true);
+        compilation->prepareCodeGen(QuillOptimizationManager::O2);
+        state.ResumeTiming();
+        compilation->codegen->generate(*compilation->program);
+        state.PauseTiming();
+        compilation.reset();
+        state.ResumeTiming();
+    }
+    reportSize(state, source);
+}
+
+void benchOptimize(benchmark::State& state, uint32_t seed, QuillOptimizationManager::OptimizationLevel level) {
+    std::string source = generateProgram(shapeOf(state, seed));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto compilation = std::make_unique<Compilation>(source, true);
+        compilation->prepareCodeGen(level);
+        compilation->codegen->generate(*compilation->program);
+        auto optimizer = std::make_unique<QuillOptimizationManager>(level);
+        optimizer->setTypeInformation(compilation->type_checker.get());
+        state.ResumeTiming();
+        optimizer->runOptimizations(*compilation->codegen->module);
+        state.PauseTiming();
+        optimizer.reset();
+        compilation.reset();
+        state.ResumeTiming();
+    }
+    reportSize(state, source);
+}
+
+template <typename Function>
+void registerPhase(const std::string& name, const ShapeGrid& grid, Function run) {
+    uint32_t seed = grid.seed;
+    benchmark::RegisterBenchmark(name.c_str(), [=](benchmark::State& state) { run(state, seed); })
+        ->ArgsProduct({grid.functions, grid.statements, grid.depth})
+        ->ArgNames({"functions", "statements", "depth"})
+        ->Unit(benchmark::kMicrosecond)
+        ->Complexity();
+}
+
+// Comma-separated counts; false if any is not a positive number (depth may be 0)
+bool parseCounts(const std::string& text, std::vector<int64_t>& counts, int64_t minimum) {
+    counts.clear();
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = text.find(',', begin);
+        if (end == std::string::npos) end = text.size();
+        std::string item = text.substr(begin, end - begin);
+        char *rest = nullptr;
+        long long value = std::strtoll(item.c_str(), &rest, 10);
+        if (item.empty() || *rest || value < minimum) return false;
+        counts.push_back(value);
+        begin = end + 1;
+    }
+    return !counts.empty();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    ShapeGrid grid;
+    bool emit_corpus = false;
+    // Whatever is not ours goes to Google Benchmark
+    std::vector<char*> benchmark_args = {argv[0]};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool valid = true;
+        if (arg.rfind("--functions=", 0) == 0) {
+            valid = parseCounts(arg.substr(std::string("--functions=").size()), grid.functions, 1);
+        } else if (arg.rfind("--statements=", 0) == 0) {
+            valid = parseCounts(arg.substr(std::string("--statements=").size()), grid.statements, 1);
+        } else if (arg.rfind("--depth=", 0) == 0) {
+            valid = parseCounts(arg.substr(std::string("--depth=").size()), grid.depth, 0);
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            grid.seed = std::strtoul(arg.c_str() + std::string("--seed=").size(), nullptr, 10);
+        } else if (arg == "--emit-corpus") {
+            emit_corpus = true;
+        } else {
+            benchmark_args.push_back(argv[i]);
+        }
+        if (!valid) {
+            std::cerr << "Error: invalid " << arg << std::endl;
+            return 1;
+        }
+    }
+    
+    if (emit_corpus) {
+        CorpusShape shape;
+        shape.functions = grid.functions.front();
+        shape.statements = grid.statements.front();
+        shape.depth = grid.depth.front();
+        shape.seed = grid.seed;
+        std::cout << generateProgram(shape);
+        return 0;
+    }
+    
+    // Host detection is a one-time cost outside every phase
+    QuillOptimizationManager::initializeHost();
+    
+    registerPhase("Lexer::tokenize", grid, benchTokenize);
+    registerPhase("Parser::parse", grid, benchParse);
+    registerPhase("TypeChecker::checkProgram", grid, benchTypeCheck);
+    registerPhase("CodeGen::generate", grid, benchCodeGen);
+    for (auto level : {QuillOptimizationManager::O1, QuillOptimizationManager::O2, QuillOptimizationManager::O3}) {
+        registerPhase("runOptimizations/O" + std::to_string((int)level), grid,
+                      [level](benchmark::State& state, uint32_t seed) { benchOptimize(state, seed, level); });
+    }
+    
+    int benchmark_argc = benchmark_args.size();
+    benchmark::Initialize(&benchmark_argc, benchmark_args.data());
+    if (benchmark::ReportUnrecognizedArguments(benchmark_argc, benchmark_args.data())) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
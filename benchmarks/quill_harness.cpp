@@ -0,0 +1,632 @@
+// Generated-code benchmarks: every benchmarks/*.quill program is JIT-compiled
+// at each optimization level, run repeatedly (a freshly loaded copy per run)
+// and compared with its Python (reference/<name>.py) and C++ (<name>_cpp,
+// built alongside) references.
+//
+//   quill_harness [--levels=0,1,2,3] [--repetitions=5] [--warmup=1]
+//                 [--pin-cpu=N] [--counters] [--python=python3] [--no-python]
+//                 [--output=harness.json] [--baseline=FILE] [--threshold=10]
+//                 [--benchmarks=DIR] [NAME...]
+//
+// Each program's output must match its reference, numbers to a relative
+// 1e-9. With --baseline (an earlier --output), a level whose median run time
+// grew by more than --threshold percent is a regression. So is a level whose
+// median is slower than the next lower level's by more than --threshold
+// percent and by more than both 95% confidence intervals together. Exits 1 on
+// any mismatch, failure or regression. Reference times include process startup.
+#include "compiler_session.h"
+#include "json_writer.h"
+#include "timer.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace quill;
+
+namespace {
+
+struct HarnessOptions {
+    std::vector<int> levels = {0, 1, 2, 3};
+    int repetitions = 5;
+    BenchmarkOptions timing;
+    bool counters = false;
+    std::string python = "python3";
+    std::string output = "harness.json";
+    std::string baseline;
+    double threshold = 10.0;
+    std::string benchmark_dir = QUILL_BENCHMARK_DIR;
+    std::string reference_bin_dir = QUILL_REFERENCE_BIN_DIR;
+    std::vector<std::string> names;  // all benchmarks when empty
+};
+
+// Just enough JSON to read back an earlier report
+struct JsonValue {
+    enum Kind { Null, Bool, Number, String, Array, Object };
+    Kind kind = Null;
+    double number = 0;
+    std::string string;
+    std::vector<std::string> keys;  // objects only, parallel to items
+    std::vector<JsonValue> items;
+    
+    const JsonValue* get(const std::string& key) const {
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == key) return &items[i];
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : text(text) {}
+    
+    JsonValue parse() {
+        JsonValue value = parseValue();
+        skipSpace();
+        if (pos != text.size()) fail();
+        return value;
+    }
+    
+private:
+    const std::string& text;
+    size_t pos = 0;
+    
+    [[noreturn]] void fail() { throw std::runtime_error("malformed JSON at offset " + std::to_string(pos)); }
+    
+    void skipSpace() {
+        while (pos < text.size() && std::isspace((unsigned char)text[pos])) pos++;
+    }
+    
+    bool consume(char c) {
+        skipSpace();
+        if (pos >= text.size() || text[pos] != c) return false;
+        pos++;
+        return true;
+    }
+    
+    void expect(char c) {
+        if (!consume(c)) fail();
+    }
+    
+    bool consumeWord(const char* word) {
+        size_t length = std::char_traits<char>::length(word);
+        if (text.compare(pos, length, word) != 0) return false;
+        pos += length;
+        return true;
+    }
+    
+    JsonValue parseValue() {
+        skipSpace();
+        if (pos >= text.size()) fail();
+        JsonValue value;
+        if (consume('{')) {
+            value.kind = JsonValue::Object;
+            if (consume('}')) return value;
+            do {
+                skipSpace();
+                value.keys.push_back(parseString());
+                expect(':');
+                value.items.push_back(parseValue());
+            } while (consume(','));
+            expect('}');
+        } else if (consume('[')) {
+            value.kind = JsonValue::Array;
+            if (consume(']')) return value;
+            do {
+                value.items.push_back(parseValue());
+            } while (consume(','));
+            expect(']');
+        } else if (text[pos] == '"') {
+            value.kind = JsonValue::String;
+            value.string = parseString();
+        } else if (consumeWord("true")) {
+            value.kind = JsonValue::Bool;
+            value.number = 1;
+        } else if (consumeWord("false")) {
+            value.kind = JsonValue::Bool;
+        } else if (!consumeWord("null")) {
+            const char* begin = text.c_str() + pos;
+            char* end = nullptr;
+            value.number = std::strtod(begin, &end);
+            if (end == begin) fail();
+            value.kind = JsonValue::Number;
+            pos += end - begin;
+        }
+        return value;
+    }
+    
+    std::string parseString() {
+        if (pos >= text.size() || text[pos] != '"') fail();
+        pos++;
+        std::string result;
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c != '\\') {
+                result += c;
+                continue;
+            }
+            if (pos >= text.size()) fail();
+            char escaped = text[pos++];
+            switch (escaped) {
+                case 'b': result += '\b'; break;
+                case 'f': result += '\f'; break;
+                case 'n': result += '\n'; break;
+                case 'r': result += '\r'; break;
+                case 't': result += '\t'; break;
+                case 'u':
+                    // JsonWriter only escapes control characters this way
+                    if (pos + 4 > text.size()) fail();
+                    result += (char)std::strtol(text.substr(pos, 4).c_str(), nullptr, 16);
+                    pos += 4;
+                    break;
+                default: result += escaped; break;
+            }
+        }
+        if (pos >= text.size()) fail();
+        pos++;
+        return result;
+    }
+};
+
+std::string levelKey(const std::string& name, int level) {
+    return name + " -O" + std::to_string(level);
+}
+
+// Median run time of every benchmark and level in an earlier report
+std::map<std::string, double> readBaseline(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) throw std::runtime_error("cannot open " + filename);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+    JsonValue report = JsonParser(text).parse();
+    
+    std::map<std::string, double> medians;
+    const JsonValue* benchmarks = report.get("benchmarks");
+    if (!benchmarks) return medians;
+    for (const JsonValue& benchmark : benchmarks->items) {
+        const JsonValue* name = benchmark.get("name");
+        const JsonValue* levels = benchmark.get("quill");
+        if (!name || !levels) continue;
+        for (const JsonValue& entry : levels->items) {
+            const JsonValue* level = entry.get("level");
+            const JsonValue* run = entry.get("run");
+            const JsonValue* time = run ? run->get("time_ms") : nullptr;
+            const JsonValue* median = time ? time->get("median") : nullptr;
+            if (level && median && median->kind == JsonValue::Number) {
+                medians[levelKey(name->string, (int)level->number)] = median->number;
+            }
+        }
+    }
+    return medians;
+}
+
+// Points stdout at another file while alive. The runtime prints with
+// write(2), so the descriptor itself is swapped.
+class StdoutRedirect {
+public:
+    explicit StdoutRedirect(int fd) {
+        std::cout.flush();
+        std::fflush(stdout);
+        saved = dup(STDOUT_FILENO);
+        dup2(fd, STDOUT_FILENO);
+    }
+    
+    ~StdoutRedirect() {
+        std::fflush(stdout);
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+    
+private:
+    int saved;
+};
+
+std::string captureOutput(const std::function<void()>& run) {
+    FILE* file = std::tmpfile();
+    if (!file) throw std::runtime_error("cannot create a temporary file");
+    {
+        StdoutRedirect redirect(fileno(file));
+        run();
+    }
+    std::string output;
+    std::rewind(file);
+    char buffer[4096];
+    size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0) output.append(buffer, count);
+    std::fclose(file);
+    return output;
+}
+
+std::string shellQuote(const std::string& text) {
+    std::string quoted = "'";
+    for (char c : text) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+}
+
+// Runs a shell command, keeping its stdout; false unless it exits with 0
+bool runCommand(const std::string& command, std::string& output) {
+    output.clear();
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) return false;
+    char buffer[4096];
+    size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) output.append(buffer, count);
+    int status = pclose(pipe);
+    return status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Same whitespace-separated words, numbers equal to a relative 1e-9: the
+// references format doubles their own way
+bool outputsMatch(const std::string& actual, const std::string& expected) {
+    std::istringstream actual_words(actual);
+    std::istringstream expected_words(expected);
+    std::string a, e;
+    while (true) {
+        bool more_actual = (bool)(actual_words >> a);
+        bool more_expected = (bool)(expected_words >> e);
+        if (!more_actual || !more_expected) return more_actual == more_expected;
+        if (a == e) continue;
+        char* a_end = nullptr;
+        char* e_end = nullptr;
+        double a_value = std::strtod(a.c_str(), &a_end);
+        double e_value = std::strtod(e.c_str(), &e_end);
+        if (*a_end || *e_end) return false;
+        if (std::fabs(a_value - e_value) > 1e-9 * std::max(std::fabs(a_value), std::fabs(e_value))) return false;
+    }
+}
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    return text.substr(begin, text.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+// Run time of one benchmark at one level, for comparing levels
+struct LevelTime {
+    int level = -1;  // -1 before any level was measured
+    double median_ms = 0;
+    double ci95_half_width_ms = 0;
+};
+
+class Harness {
+public:
+    explicit Harness(const HarnessOptions& options) : options(options) {}
+    
+    // False on any mismatch, failure or regression
+    bool run(JsonWriter& json) {
+        if (!options.baseline.empty()) baseline = readBaseline(options.baseline);
+        
+        // Creates the JIT and detects the host before anything is timed
+        session.jit("def main():\n    return 0\n");
+        
+        json.beginObject();
+        json.field("repetitions", options.repetitions);
+        json.field("warmup", options.timing.warmup_iterations);
+        json.field("threshold_percent", options.threshold);
+        if (!options.baseline.empty()) json.field("baseline", options.baseline);
+        json.key("benchmarks");
+        json.beginArray();
+        for (const std::string& name : benchmarkNames()) runBenchmark(name, json);
+        json.endArray();
+        json.key("failures");
+        json.beginArray();
+        for (const std::string& failure : failures) json.value(failure);
+        json.endArray();
+        json.field("passed", failures.empty());
+        json.endObject();
+        
+        for (const std::string& failure : failures) std::cerr << "FAIL: " << failure << std::endl;
+        return failures.empty();
+    }
+    
+private:
+    const HarnessOptions& options;
+    CompilerSession session;
+    std::map<std::string, double> baseline;
+    std::vector<std::string> failures;
+    bool warned_counters = false;
+    
+    std::vector<std::string> benchmarkNames() {
+        if (!options.names.empty()) return options.names;
+        std::vector<std::string> names;
+        for (const auto& entry : std::filesystem::directory_iterator(options.benchmark_dir)) {
+            if (entry.path().extension() == ".quill") names.push_back(entry.path().stem().string());
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+    
+    std::unique_ptr<BenchmarkTimer> timeCommand(const std::string& label, const std::string& command,
+                                                std::string& output, bool& succeeded) {
+        auto timer = std::make_unique<BenchmarkTimer>(label);
+        succeeded = true;
+        timer->run_benchmark(options.repetitions, [&]() {
+            succeeded = runCommand(command, output) && succeeded;
+        }, options.timing);
+        return timer;
+    }
+    
+    void printTime(const std::string& label, const BenchmarkTimer& timer) {
+        std::cout << "  " << std::left << std::setw(8) << label << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << timer.get_median_ms() << " ms  +/- " << timer.get_ci95_half_width_ms();
+    }
+    
+    void runBenchmark(const std::string& name, JsonWriter& json) {
+        std::filesystem::path directory = options.benchmark_dir;
+        std::ifstream file(directory / (name + ".quill"));
+        if (!file.is_open()) {
+            failures.push_back(name + ": no " + name + ".quill in " + options.benchmark_dir);
+            return;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string source = buffer.str();
+        std::cout << name << std::endl;
+        
+        json.beginObject();
+        json.field("name", name);
+        
+        // The expected output is Python's, else that of the C++ reference
+        std::string expected;
+        bool have_expected = false;
+        std::unique_ptr<BenchmarkTimer> python_timer;
+        std::filesystem::path python_reference = directory / "reference" / (name + ".py");
+        if (!options.python.empty() && std::filesystem::exists(python_reference)) {
+            bool succeeded;
+            python_timer = timeCommand(name + " python",
+                                       shellQuote(options.python) + " " + shellQuote(python_reference.string()),
+                                       expected, succeeded);
+            if (succeeded) {
+                have_expected = true;
+                printTime("python", *python_timer);
+                std::cout << std::endl;
+                json.key("python");
+                python_timer->write_results_json(json);
+            } else {
+                failures.push_back(name + ": " + python_reference.string() + " failed");
+                python_timer.reset();
+            }
+        }
+        
+        std::unique_ptr<BenchmarkTimer> cpp_timer;
+        std::filesystem::path cpp_reference = std::filesystem::path(options.reference_bin_dir) / (name + "_cpp");
+        if (std::filesystem::exists(cpp_reference)) {
+            std::string output;
+            bool succeeded;
+            cpp_timer = timeCommand(name + " c++", shellQuote(cpp_reference.string()), output, succeeded);
+            if (!succeeded) {
+                failures.push_back(name + ": " + cpp_reference.string() + " failed");
+                cpp_timer.reset();
+            } else {
+                printTime("c++", *cpp_timer);
+                std::cout << std::endl;
+                json.key("cpp");
+                cpp_timer->write_results_json(json);
+                if (!have_expected) {
+                    expected = output;
+                    have_expected = true;
+                } else if (!outputsMatch(output, expected)) {
+                    failures.push_back(name + ": the C++ reference printed " + trim(output) + ", Python " +
+                                       trim(expected));
+                }
+            }
+        }
+        if (!have_expected) failures.push_back(name + ": no reference output to compare with");
+        json.field("expected_output", trim(expected));
+        
+        json.key("quill");
+        json.beginArray();
+        LevelTime lower;
+        for (int level : options.levels) {
+            runLevel(name, source, level, have_expected ? &expected : nullptr, python_timer.get(),
+                     cpp_timer.get(), lower, json);
+        }
+        json.endArray();
+        json.endObject();
+    }
+    
+    void runLevel(const std::string& name, const std::string& source, int level, const std::string* expected,
+                  const BenchmarkTimer* python_timer, const BenchmarkTimer* cpp_timer, LevelTime& lower,
+                  JsonWriter& json) {
+        std::string key = levelKey(name, level);
+        session.getOptions().opt_level = (QuillOptimizationManager::OptimizationLevel)level;
+        BenchmarkTimer compile_timer(key + " compile");
+        // Every run gets a freshly loaded copy: state a program keeps in
+        // globals, such as the tables of memoized functions, would otherwise
+        // carry over and later runs would time cache hits
+        std::vector<void (*)()> programs;
+        try {
+            compile_timer.start();
+            programs.push_back(reinterpret_cast<void (*)()>(session.jit(source)));
+            compile_timer.stop();
+            for (int i = 0; i < options.timing.warmup_iterations + options.repetitions; ++i) {
+                programs.push_back(reinterpret_cast<void (*)()>(session.jit(source)));
+            }
+        } catch (const std::exception& e) {
+            failures.push_back(key + ": " + e.what());
+            return;
+        }
+        size_t next_program = 0;
+        auto run_program = [&programs, &next_program]() {
+            programs[next_program++]();
+            CompilerSession::flushOutput();
+        };
+        
+        std::string output = captureOutput(run_program);
+        bool matches = !expected || outputsMatch(output, *expected);
+        if (!matches) {
+            failures.push_back(key + " printed " + trim(output) + ", expected " + trim(*expected));
+        }
+        
+        BenchmarkTimer timer(key);
+        if (options.counters && !timer.enable_hardware_counters() && !warned_counters) {
+            std::cerr << "Warning: hardware counters are unavailable (see perf_event_paranoid)" << std::endl;
+            warned_counters = true;
+        }
+        int null_fd = open("/dev/null", O_WRONLY);
+        {
+            StdoutRedirect redirect(null_fd);
+            timer.run_benchmark(options.repetitions, run_program, options.timing);
+        }
+        close(null_fd);
+        
+        json.beginObject();
+        json.field("level", level);
+        json.field("compile_ms", compile_timer.get_last_measurement_ms());
+        json.field("output", trim(output));
+        json.field("output_matches", matches);
+        json.key("run");
+        timer.write_results_json(json);
+        
+        double median = timer.get_median_ms();
+        printTime("-O" + std::to_string(level), timer);
+        // Time ratios: below 1 means Quill was faster
+        if (python_timer) {
+            json.field("relative_to_python", median / python_timer->get_median_ms());
+            std::cout << std::defaultfloat << std::setprecision(3) << "  " << median / python_timer->get_median_ms() << "x python";
+        }
+        if (cpp_timer) {
+            json.field("relative_to_cpp", median / cpp_timer->get_median_ms());
+            std::cout << std::defaultfloat << std::setprecision(3) << "  " << median / cpp_timer->get_median_ms() << "x c++";
+        }
+        auto previous = baseline.find(key);
+        if (previous != baseline.end()) {
+            double change = (median / previous->second - 1.0) * 100.0;
+            bool regressed = change > options.threshold;
+            json.field("baseline_median_ms", previous->second);
+            json.field("change_percent", change);
+            json.field("regressed", regressed);
+            std::cout << std::fixed << std::showpos << std::setprecision(1) << "  " << change << "%" << std::noshowpos;
+            if (regressed) {
+                std::ostringstream failure;
+                failure << std::fixed << std::setprecision(1) << key << " slowed by " << change << "% (median "
+                        << std::setprecision(3) << median << " ms, baseline " << previous->second << " ms)";
+                failures.push_back(failure.str());
+            }
+        }
+        // Higher levels are meant to be at least as fast; only flag a gap
+        // that timing noise cannot explain
+        if (lower.level >= 0 && lower.level < level) {
+            double change = (median / lower.median_ms - 1.0) * 100.0;
+            double noise = timer.get_ci95_half_width_ms() + lower.ci95_half_width_ms;
+            bool slower = change > options.threshold && median - lower.median_ms > noise;
+            json.field("lower_level", lower.level);
+            json.field("change_vs_lower_percent", change);
+            json.field("slower_than_lower", slower);
+            if (slower) {
+                std::cout << "  SLOWER THAN -O" << lower.level;
+                std::ostringstream failure;
+                failure << std::fixed << std::setprecision(1) << key << " is " << change << "% slower than -O"
+                        << lower.level << " (median " << std::setprecision(3) << median << " ms, -O" << lower.level
+                        << " " << lower.median_ms << " ms)";
+                failures.push_back(failure.str());
+            }
+        }
+        lower = {level, median, timer.get_ci95_half_width_ms()};
+        std::cout << (matches ? "" : "  OUTPUT MISMATCH") << std::endl;
+        json.endObject();
+    }
+};
+
+// Comma-separated levels from 0 to 3
+bool parseLevels(const std::string& text, std::vector<int>& levels) {
+    levels.clear();
+    std::istringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        if (item.size() != 1 || item[0] < '0' || item[0] > '3') return false;
+        levels.push_back(item[0] - '0');
+    }
+    return !levels.empty();
+}
+
+bool parsePositive(const std::string& text, int& value, int minimum) {
+    char* rest = nullptr;
+    long parsed = std::strtol(text.c_str(), &rest, 10);
+    if (text.empty() || *rest || parsed < minimum) return false;
+    value = (int)parsed;
+    return true;
+}
+
+std::string valueOf(const std::string& arg) {
+    return arg.substr(arg.find('=') + 1);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    HarnessOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool valid = true;
+        if (arg.rfind("--levels=", 0) == 0) {
+            valid = parseLevels(valueOf(arg), options.levels);
+        } else if (arg.rfind("--repetitions=", 0) == 0) {
+            valid = parsePositive(valueOf(arg), options.repetitions, 1);
+        } else if (arg.rfind("--warmup=", 0) == 0) {
+            valid = parsePositive(valueOf(arg), options.timing.warmup_iterations, 0);
+        } else if (arg.rfind("--pin-cpu=", 0) == 0) {
+            valid = parsePositive(valueOf(arg), options.timing.pin_cpu, 0);
+        } else if (arg == "--counters") {
+            options.counters = true;
+        } else if (arg.rfind("--python=", 0) == 0) {
+            options.python = valueOf(arg);
+        } else if (arg == "--no-python") {
+            options.python.clear();
+        } else if (arg.rfind("--output=", 0) == 0) {
+            options.output = valueOf(arg);
+        } else if (arg.rfind("--baseline=", 0) == 0) {
+            options.baseline = valueOf(arg);
+        } else if (arg.rfind("--threshold=", 0) == 0) {
+            char* rest = nullptr;
+            options.threshold = std::strtod(valueOf(arg).c_str(), &rest);
+            valid = *rest == '\0' && options.threshold >= 0;
+        } else if (arg.rfind("--benchmarks=", 0) == 0) {
+            options.benchmark_dir = valueOf(arg);
+        } else if (arg.rfind("--", 0) == 0) {
+            valid = false;
+        } else {
+            options.names.push_back(arg);
+        }
+        if (!valid) {
+            std::cerr << "Error: invalid " << arg << std::endl;
+            return 1;
+        }
+    }
+    
+    std::ofstream report(options.output);
+    if (!report.is_open()) {
+        std::cerr << "Error: cannot write " << options.output << std::endl;
+        return 1;
+    }
+    
+    try {
+        Harness harness(options);
+        JsonWriter json(report);
+        bool passed = harness.run(json);
+        std::cout << "Report written to " << options.output << std::endl;
+        return passed ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,145 @@
+// C++ reference for hft_simulation.quill
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// Shortest precision that reads back exactly, as Quill and Python print
+static void print_number(double value) {
+    char text[32];
+    for (int precision = 15; precision <= 17; precision++) {
+        snprintf(text, sizeof text, "%.*g", precision, value);
+        if (strtod(text, nullptr) == value) break;
+    }
+    printf("%s\n", text);
+}
+
+static double process_market_event(int64_t event_type, double price, double quantity, int64_t timestamp) {
+    // Process different types of market events
+    double processed_price = price;
+    double processed_qty = quantity;
+    double latency = 0;
+    
+    // Market impact calculation based on event type
+    if (event_type == 1) {  // Buy order
+        processed_price = price * 1.0001;
+        latency = 5;  // 5 microseconds processing time
+    } else if (event_type == 2) {  // Sell order
+        processed_price = price * 0.9999;
+        latency = 5;
+    } else if (event_type == 3) {  // Trade execution
+        processed_qty = quantity;
+        if (quantity > 1000) {
+            latency = latency + (quantity / 1000) * 2;
+        } else {
+            latency = 3;
+        }
+    } else if (event_type == 4) {  // Order cancellation
+        latency = 2;
+        processed_price = 0;
+        processed_qty = 0;
+    }
+    
+    // Risk check simulation
+    double risk_score = 0;
+    if (processed_price > 1000) {
+        risk_score = (processed_price - 1000) / 10;
+    }
+    
+    if (processed_qty > 10000) {
+        risk_score = risk_score + processed_qty / 1000;
+    }
+    
+    (void)timestamp;
+    return latency + risk_score / 100;
+}
+
+static double order_book_simulation() {
+    // Simulate high-frequency trading order book processing
+    double total_latency = 0;
+    int64_t total_volume = 0;
+    int64_t total_trades = 0;
+    
+    // Simulate 100,000 market events
+    int64_t seed = 12345;
+    
+    for (int64_t i = 0; i < 100000; i++) {
+        // Generate pseudo-random market events using same algorithm as Quill
+        seed = (1664525 * seed + 1013904223) % 4294967296;
+        
+        // Event type (1-4)
+        int64_t event_type = (seed % 4) + 1;
+        
+        // Price (around $100 with variation)
+        seed = (1664525 * seed + 1013904223) % 4294967296;
+        int64_t price_variation = (seed % 1000) - 500;
+        int64_t price = 10000 + price_variation;
+        
+        // Quantity (100 to 10,000 shares)
+        seed = (1664525 * seed + 1013904223) % 4294967296;
+        int64_t quantity = 100 + (seed % 9900);
+        
+        // Timestamp (microseconds since start)
+        int64_t timestamp = i * 10;
+        
+        // Process the market event
+        total_latency += process_market_event(event_type, price, quantity, timestamp);
+        
+        if (event_type == 3) {  // Count trades
+            total_trades += 1;
+            total_volume += quantity;
+        }
+    }
+    
+    return total_latency / 100000;
+}
+
+static int64_t arbitrage_detection() {
+    // Simulate arbitrage opportunity detection across multiple exchanges
+    int64_t opportunities_found = 0;
+    int64_t total_profit = 0;
+    
+    // Simulate price feeds from 3 exchanges
+    int64_t num_price_updates = 50000;
+    int64_t seed = 54321;
+    
+    // Initialize exchange prices
+    int64_t price1 = 10000, price2 = 10000, price3 = 10000;
+    
+    for (int64_t i = 0; i < num_price_updates; i++) {
+        // Generate price updates for each exchange
+        seed = (1664525 * seed + 1013904223) % 4294967296;
+        price1 += (seed % 200) - 100;
+        
+        seed = (1664525 * seed + 1013904223) % 4294967296;
+        price2 += (seed % 200) - 100;
+        
+        seed = (1664525 * seed + 1013904223) % 4294967296;
+        price3 += (seed % 200) - 100;
+        
+        // Check for arbitrage opportunities (>$0.50 spread)
+        int64_t min_price = price1, max_price = price1;
+        if (price2 < min_price) min_price = price2;
+        if (price2 > max_price) max_price = price2;
+        if (price3 < min_price) min_price = price3;
+        if (price3 > max_price) max_price = price3;
+        
+        int64_t spread = max_price - min_price;
+        
+        if (spread > 50) {  // Arbitrage opportunity (>$0.50)
+            opportunities_found += 1;
+            total_profit += spread - 10;  // $0.10 transaction cost
+        }
+    }
+    
+    return opportunities_found;
+}
+
+int main() {
+    // High-Frequency Trading Simulation Benchmark
+    double avg_latency = order_book_simulation();
+    int64_t arb_opportunities = arbitrage_detection();
+    
+    // Combined performance metric
+    print_number(avg_latency * 1000 + arb_opportunities);
+    return 0;
+}
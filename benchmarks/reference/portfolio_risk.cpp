@@ -0,0 +1,105 @@
+// C++ reference for portfolio_risk.quill
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// Shortest precision that reads back exactly, as Quill and Python print
+static void print_number(double value) {
+    char text[32];
+    for (int precision = 15; precision <= 17; precision++) {
+        snprintf(text, sizeof text, "%.*g", precision, value);
+        if (strtod(text, nullptr) == value) break;
+    }
+    printf("%s\n", text);
+}
+
+static double portfolio_var(int num_assets, int confidence_level) {
+    // Portfolio Value at Risk calculation
+    const double weights[3] = {0.5, 0.3, 0.2};  // 50% stocks, 30% bonds, 20% commodities
+    
+    // Volatilities (annualized %)
+    const double volatilities[3] = {0.20, 0.05, 0.25};
+    
+    // Correlation matrix
+    const double correlations[3][3] = {
+        {1.0, 0.3, 0.5},
+        {0.3, 1.0, 0.1},
+        {0.5, 0.1, 1.0},
+    };
+    
+    // Portfolio variance calculation
+    double portfolio_variance = 0;
+    for (int i = 0; i < num_assets; i++) {
+        for (int j = 0; j < num_assets; j++) {
+            portfolio_variance += weights[i] * weights[j] * volatilities[i] * volatilities[j] * correlations[i][j];
+        }
+    }
+    
+    double portfolio_vol = std::sqrt(portfolio_variance);
+    
+    // VaR calculation (assuming normal distribution)
+    double z_score = confidence_level <= 98 ? 1.645 : 2.326;
+    
+    // Daily VaR (1-day, assuming 252 trading days per year)
+    double daily_vol = portfolio_vol / std::sqrt(252.0);
+    return z_score * daily_vol;
+}
+
+static double monte_carlo_var(int num_simulations) {
+    // Monte Carlo simulation for VaR
+    double portfolio_value = 1000000;  // $1M portfolio
+    double worst_losses = 0;
+    int64_t count_extreme = 0;
+    
+    int64_t seed = 42;
+    
+    for (int n = 0; n < num_simulations; n++) {
+        // Generate correlated random returns for 3 assets using same algorithm as Quill
+        double rand_nums[3];
+        for (double& rand_num : rand_nums) {
+            seed = (1664525 * seed + 1013904223) % 4294967296;
+            rand_num = ((seed % 10000) - 5000) / 10000.0;  // [-0.5, 0.5]
+        }
+        
+        // Simulate daily returns
+        double return1 = 0.12 / 252 + 0.20 / std::sqrt(252.0) * rand_nums[0];  // Stock return
+        double return2 = 0.05 / 252 + 0.05 / std::sqrt(252.0) * rand_nums[1];  // Bond return
+        double return3 = 0.08 / 252 + 0.25 / std::sqrt(252.0) * rand_nums[2];  // Commodity return
+        
+        // Portfolio return
+        double portfolio_return = 0.5 * return1 + 0.3 * return2 + 0.2 * return3;
+        
+        // Portfolio loss (negative return)
+        if (portfolio_return < 0) {
+            worst_losses += std::fabs(portfolio_return * portfolio_value);
+            count_extreme += 1;
+        }
+    }
+    
+    // Average loss in extreme scenarios
+    return count_extreme > 0 ? worst_losses / count_extreme : 0;
+}
+
+int main() {
+    // Portfolio Risk Analysis Benchmark
+    double total_var = 0;
+    double total_mc_var = 0;
+    
+    // Run multiple VaR calculations with different parameters
+    for (int i = 0; i < 1000; i++) {
+        // Parametric VaR
+        int confidence = 95 + (i % 5);  // Confidence levels 95-99%
+        total_var += portfolio_var(3, confidence);
+        
+        // Monte Carlo VaR (smaller simulation for speed)
+        total_mc_var += monte_carlo_var(1000);
+    }
+    
+    double avg_var = total_var / 1000;
+    double avg_mc_var = total_mc_var / 1000;
+    
+    // Combined risk measure
+    print_number((avg_var + avg_mc_var / 1000000) * 1000);  // Scale for comparison
+    return 0;
+}
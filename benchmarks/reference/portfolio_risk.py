@@ -1,6 +1,5 @@
 #!/usr/bin/env python3
 import math
-import random
 
 def portfolio_var(num_assets=3, confidence_level=95):
     """Portfolio Value at Risk calculation"""
@@ -46,11 +45,14 @@ def monte_carlo_var(num_simulations=1000):
     worst_losses = 0
     count_extreme = 0
     
-    random.seed(42)  # For reproducible results
+    seed = 42
     
     for _ in range(num_simulations):
-        # Generate correlated random returns for 3 assets
-        rand_nums = [random.gauss(0, 1) for _ in range(3)]
+        # Generate correlated random returns for 3 assets using same algorithm as Quill
+        rand_nums = []
+        for _ in range(3):
+            seed = (1664525 * seed + 1013904223) % 4294967296
+            rand_nums.append(((seed % 10000) - 5000) / 10000.0)  # [-0.5, 0.5]
         
         # Simulate daily returns
         returns = [
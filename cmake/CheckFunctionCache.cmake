@@ -0,0 +1,36 @@
+# Compiles SOURCE with QUILL and FLAGS twice through a fresh function cache in
+# WORK_DIR and fails unless the second compile reused every function and
+# emitted the same LLVM IR as the first.
+#   cmake -DQUILL=... -DSOURCE=... -DFLAGS=-O3 -DWORK_DIR=... -P CheckFunctionCache.cmake
+
+file(REMOVE_RECURSE "${WORK_DIR}")
+
+# --opt-report skips the whole-file cache, so both compiles run the function
+# pipeline or reuse its results; the report precedes the IR
+foreach(build cold warm)
+    execute_process(
+        COMMAND ${QUILL} ${FLAGS} --cache --cache-dir=${WORK_DIR} --opt-report --emit-llvm ${SOURCE}
+        OUTPUT_VARIABLE output
+        ERROR_VARIABLE errors
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${build} compile of ${SOURCE} failed (${result}):\n${errors}")
+    endif()
+    string(FIND "${output}" "; ModuleID" ir_start)
+    if(ir_start EQUAL -1)
+        message(FATAL_ERROR "${build} compile of ${SOURCE} printed no IR:\n${output}")
+    endif()
+    string(SUBSTRING "${output}" 0 ${ir_start} ${build}_report)
+    string(SUBSTRING "${output}" ${ir_start} -1 ${build}_ir)
+endforeach()
+
+string(REGEX MATCH "Functions Reused From Cache: ([0-9]+) of ([0-9]+)" reused "${warm_report}")
+if(NOT reused OR NOT CMAKE_MATCH_1 EQUAL CMAKE_MATCH_2 OR CMAKE_MATCH_2 EQUAL 0)
+    message(FATAL_ERROR "the warm compile of ${SOURCE} did not reuse every function:\n${warm_report}")
+endif()
+if(NOT cold_ir STREQUAL warm_ir)
+    file(WRITE "${WORK_DIR}/cold.ll" "${cold_ir}")
+    file(WRITE "${WORK_DIR}/warm.ll" "${warm_ir}")
+    message(FATAL_ERROR "reused functions changed the IR of ${SOURCE}; see ${WORK_DIR}/cold.ll and warm.ll")
+endif()
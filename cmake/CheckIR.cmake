@@ -0,0 +1,25 @@
+# Compiles SOURCE with QUILL and FLAGS (a ;-list), and fails if the emitted
+# LLVM IR has a line matching the regex FORBIDDEN.
+#   cmake -DQUILL=... -DSOURCE=... -DFLAGS=-O3 -DFORBIDDEN=frem -P CheckIR.cmake
+
+execute_process(
+    COMMAND ${QUILL} ${FLAGS} --emit-llvm ${SOURCE}
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE errors
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "quill ${FLAGS} ${SOURCE} failed (${result}):\n${errors}")
+endif()
+
+# The IR follows the type checker's report on stdout
+string(FIND "${output}" "; ModuleID" ir_start)
+if(ir_start EQUAL -1)
+    message(FATAL_ERROR "quill ${FLAGS} ${SOURCE} printed no IR:\n${output}")
+endif()
+string(SUBSTRING "${output}" ${ir_start} -1 ir)
+
+string(REGEX MATCH "[^\n]*${FORBIDDEN}[^\n]*" line "${ir}")
+if(line)
+    message(FATAL_ERROR "${SOURCE} at ${FLAGS} has IR matching '${FORBIDDEN}':\n${line}")
+endif()
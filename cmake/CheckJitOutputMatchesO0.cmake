@@ -0,0 +1,27 @@
+# JIT-compiles and runs SOURCE with RUNNER (tests/jit_run.cpp) at -O0 and at
+# each of LEVELS (space-separated), and fails unless each optimized run prints
+# exactly what -O0 prints. With the runtime bitcode embedded, programs above
+# -O0 carry an internalized copy of the runtime whose buffered output only
+# reaches the host's quill_flush_output through the host's quill_thread_output.
+#   cmake -DRUNNER=... -DSOURCE=... -DLEVELS=-O2 -P CheckJitOutputMatchesO0.cmake
+
+separate_arguments(levels UNIX_COMMAND "${LEVELS}")
+
+foreach(level -O0 ${levels})
+    execute_process(
+        COMMAND ${RUNNER} ${level} ${SOURCE}
+        OUTPUT_VARIABLE output
+        ERROR_VARIABLE errors
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${SOURCE} run in the JIT at ${level} failed (${result}):\n${output}${errors}")
+    endif()
+
+    if(level STREQUAL "-O0")
+        set(expected "${output}")
+    elseif(NOT output STREQUAL expected)
+        message(FATAL_ERROR "${SOURCE} prints differently in the JIT at ${level} than at -O0\n"
+                            "-O0:\n${expected}\n${level}:\n${output}")
+    endif()
+endforeach()
@@ -0,0 +1,46 @@
+# Builds SOURCE with QUILL at -O0 and at each of LEVELS (space-separated,
+# such as "-O1 -O2"), links every build with RUNTIME through LLC and CC in WORK_DIR,
+# and fails unless each optimized program prints exactly what -O0 prints.
+#   cmake -DQUILL=... -DLLC=... -DCC=... -DRUNTIME=runtime.o -DSOURCE=...
+#         -DLEVELS=-O2 -DWORK_DIR=... -P CheckOutputMatchesO0.cmake
+
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+separate_arguments(levels UNIX_COMMAND "${LEVELS}")
+
+foreach(level -O0 ${levels})
+    set(program "${WORK_DIR}/program${level}")
+    execute_process(
+        COMMAND ${QUILL} ${level} -o ${program}.ll ${SOURCE}
+        OUTPUT_QUIET
+        ERROR_VARIABLE errors
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "quill ${level} ${SOURCE} failed (${result}):\n${errors}")
+    endif()
+    execute_process(
+        COMMAND ${LLC} -filetype=obj -relocation-model=pic ${program}.ll -o ${program}.o
+        COMMAND_ERROR_IS_FATAL ANY
+    )
+    execute_process(
+        COMMAND ${CC} ${program}.o ${RUNTIME} -pthread -lm -o ${program}
+        COMMAND_ERROR_IS_FATAL ANY
+    )
+    execute_process(
+        COMMAND ${program}
+        OUTPUT_VARIABLE output
+        RESULT_VARIABLE result
+    )
+    # main's return value is not an exit status; only a signal is a failure
+    if(NOT result MATCHES "^[0-9]+$")
+        message(FATAL_ERROR "${SOURCE} built with ${level} failed (${result}):\n${output}")
+    endif()
+
+    if(level STREQUAL "-O0")
+        set(expected "${output}")
+    elseif(NOT output STREQUAL expected)
+        message(FATAL_ERROR "${SOURCE} prints differently at ${level} than at -O0\n"
+                            "-O0:\n${expected}\n${level}:\n${output}")
+    endif()
+endforeach()
@@ -0,0 +1,32 @@
+# Writes INPUT (the runtime bitcode) into OUTPUT as a C++ byte array.
+# An empty or missing INPUT produces an empty array, which the compiler
+# treats as "no runtime to link".
+#
+#   cmake -DINPUT=runtime.bc -DOUTPUT=runtime_bitcode.cpp -P EmbedBitcode.cmake
+
+set(bytes "")
+set(size 0)
+if(INPUT AND EXISTS "${INPUT}")
+    file(READ "${INPUT}" hex HEX)
+    string(LENGTH "${hex}" hex_length)
+    math(EXPR size "${hex_length} / 2")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    string(REGEX REPLACE "(0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,)" "\\1\n    " bytes "${bytes}")
+endif()
+
+# Keep the array non-empty so the translation unit is valid either way
+file(WRITE "${OUTPUT}.tmp"
+"// Generated by cmake/EmbedBitcode.cmake; do not edit
+#include \"runtime_bitcode.h\"
+
+namespace quill {
+
+alignas(4) const unsigned char runtime_bitcode[] = {
+    ${bytes}0x00
+};
+const size_t runtime_bitcode_size = ${size};
+
+} // namespace quill
+")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
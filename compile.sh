@@ -1,7 +1,7 @@
 #!/bin/bash
 
 # Quill Compiler Script
-# Usage: ./compile.sh program.quill [output_name] [optimization_level]
+# Usage: ./compile.sh program.quill [output_name] [optimization_level] [quill flags...]
 
 set -e  # Exit on any error
 
@@ -25,6 +25,8 @@ fi
 QUILL_FILE="$1"
 OUTPUT_NAME="${2:-$(basename "$QUILL_FILE" .quill)}"
 OPT_LEVEL="${3:--O1}"  # Default to -O1 optimization
+shift $(( $# < 3 ? $# : 3 ))
+QUILL_FLAGS=("$@")    # e.g. --profile-generate or --profile-use=app.profdata
 
 # Check if quill file exists
 if [ ! -f "$QUILL_FILE" ]; then
@@ -44,19 +46,35 @@ if [ ! -f "build/quill" ]; then
 fi
 
 # Build runtime if needed
-if [ ! -f "runtime.o" ]; then
+if [ ! -f "runtime.o" ] || [ runtime.c -nt runtime.o ]; then
     echo -e "${YELLOW}Building runtime library...${NC}"
-    gcc -c runtime.c -o runtime.o
+    gcc -O2 -c -pthread runtime.c -o runtime.o
 fi
 
 echo -e "${BLUE}Step 1: Compiling with optimization ($OPT_LEVEL)...${NC}"
-./build/quill "$OPT_LEVEL" --timing "$QUILL_FILE"
+./build/quill "$OPT_LEVEL" --timing "${QUILL_FLAGS[@]}" "$QUILL_FILE"
+
+# Instrumented programs need LLVM's profile runtime to write their counts
+PROFILE_LIBS=()
+for flag in "${QUILL_FLAGS[@]}"; do
+    if [[ "$flag" == --profile-generate* ]]; then
+        PROFILE_RT=$(find "$(/opt/homebrew/opt/llvm/bin/llvm-config --libdir)/clang" -name 'libclang_rt.profile*.a' | head -1)
+        if [ -z "$PROFILE_RT" ]; then
+            echo -e "${RED}Error: LLVM profile runtime (libclang_rt.profile) not found${NC}"
+            exit 1
+        fi
+        PROFILE_LIBS=("$PROFILE_RT")
+        if [ "$(uname)" = "Linux" ]; then
+            PROFILE_LIBS+=("-Wl,-u,__llvm_profile_runtime")
+        fi
+    fi
+done
 
 echo -e "${BLUE}Step 2: Converting to assembly...${NC}"
 /opt/homebrew/opt/llvm/bin/llc "${QUILL_FILE}.o" -o "${QUILL_FILE%.quill}.s"
 
 echo -e "${BLUE}Step 3: Linking executable...${NC}"
-gcc "${QUILL_FILE%.quill}.s" runtime.o -o "$OUTPUT_NAME"
+gcc "${QUILL_FILE%.quill}.s" runtime.o "${PROFILE_LIBS[@]}" -pthread -o "$OUTPUT_NAME"
 
 echo -e "${GREEN}Successfully compiled '$QUILL_FILE' to '$OUTPUT_NAME' with $OPT_LEVEL${NC}"
 echo -e "${BLUE}Run with: ./$OUTPUT_NAME${NC}"
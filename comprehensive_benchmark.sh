@@ -16,8 +16,8 @@ echo -e "${BLUE}🚀 Comprehensive Optimization Benchmark${NC}"
 echo -e "${BLUE}=======================================${NC}"
 
 # Build runtime
-if [ ! -f "runtime.o" ]; then
-    gcc -c runtime.c -o runtime.o
+if [ ! -f "runtime.o" ] || [ runtime.c -nt runtime.o ]; then
+    gcc -O2 -c -pthread runtime.c -o runtime.o
 fi
 
 # Function to time execution accurately
@@ -66,7 +66,7 @@ for program in "${PROGRAMS[@]}"; do
         # Compile
         ./build/quill "$opt" "benchmarks/$program.quill" > /dev/null 2>&1
         /opt/homebrew/opt/llvm/bin/llc "benchmarks/$program.quill.o" -o "benchmarks/$program.s"
-        gcc "benchmarks/$program.s" runtime.o -o "${program}${opt}"
+        gcc "benchmarks/$program.s" runtime.o -pthread -o "${program}${opt}"
         
         # Benchmark
         quill_time=$(time_execution "${program}${opt}" 3)
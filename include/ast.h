@@ -35,8 +35,9 @@ public:
 class NumberExprAST : public ExprAST {
 public:
     double value;
+    bool is_float;  // written with a decimal point, so typed float even when whole
     
-    NumberExprAST(double val) : value(val) {}
+    NumberExprAST(double val, bool float_literal = false) : value(val), is_float(float_literal) {}
     llvm::Value* codegen(CodeGen& gen) override;
 };
 
@@ -86,6 +87,26 @@ public:
     llvm::Value* codegen(CodeGen& gen) override;
 };
 
+// List literal: [a, b, c]
+class ListExprAST : public ExprAST {
+public:
+    std::vector<std::unique_ptr<ExprAST>> elements;
+    
+    ListExprAST(std::vector<std::unique_ptr<ExprAST>> elems) : elements(std::move(elems)) {}
+    llvm::Value* codegen(CodeGen& gen) override;
+};
+
+// Element access: list[index]
+class IndexExprAST : public ExprAST {
+public:
+    std::unique_ptr<ExprAST> list;
+    std::unique_ptr<ExprAST> index;
+    
+    IndexExprAST(std::unique_ptr<ExprAST> l, std::unique_ptr<ExprAST> i)
+        : list(std::move(l)), index(std::move(i)) {}
+    llvm::Value* codegen(CodeGen& gen) override;
+};
+
 class StmtAST : public ASTNode {
 public:
     virtual ~StmtAST() = default;
@@ -101,6 +122,17 @@ public:
     llvm::Value* codegen(CodeGen& gen) override;
 };
 
+// Element store: list[index] = value
+class IndexAssignmentStmtAST : public StmtAST {
+public:
+    std::unique_ptr<IndexExprAST> target;
+    std::unique_ptr<ExprAST> value;
+    
+    IndexAssignmentStmtAST(std::unique_ptr<IndexExprAST> t, std::unique_ptr<ExprAST> v)
+        : target(std::move(t)), value(std::move(v)) {}
+    llvm::Value* codegen(CodeGen& gen) override;
+};
+
 class ExprStmtAST : public StmtAST {
 public:
     std::unique_ptr<ExprAST> expression;
@@ -141,6 +173,27 @@ public:
     llvm::Value* codegen(CodeGen& gen) override;
 };
 
+// Counted loop: for var in range(start, stop, step). The step is a nonzero
+// integer constant, so the trip count is known on loop entry.
+//
+// A `parallel for` runs its iterations on the runtime's thread pool. The
+// body may read enclosing variables and store to list elements; enclosing
+// numbers it updates must be reductions (v = v + e, min(v, e), max(v, e)).
+class ForRangeStmtAST : public StmtAST {
+public:
+    std::string var;
+    std::unique_ptr<ExprAST> start;  // nullptr means 0
+    std::unique_ptr<ExprAST> stop;
+    long long step;
+    std::unique_ptr<StmtAST> body;
+    bool parallel = false;
+    
+    ForRangeStmtAST(const std::string& v, std::unique_ptr<ExprAST> from, std::unique_ptr<ExprAST> to,
+                    long long s, std::unique_ptr<StmtAST> b)
+        : var(v), start(std::move(from)), stop(std::move(to)), step(s), body(std::move(b)) {}
+    llvm::Value* codegen(CodeGen& gen) override;
+};
+
 class ReturnStmtAST : public StmtAST {
 public:
     std::unique_ptr<ExprAST> value;
@@ -163,9 +216,20 @@ public:
     std::vector<std::string> args;
     std::unique_ptr<StmtAST> body;
     
+    // Type annotations as written in the source; empty when omitted
+    std::vector<std::string> arg_types;
+    std::string return_type;
+    
     FunctionAST(const std::string& n, std::vector<std::string> a, 
-                std::unique_ptr<StmtAST> b)
-        : name(n), args(std::move(a)), body(std::move(b)) {}
+                std::unique_ptr<StmtAST> b,
+                std::vector<std::string> a_types = {}, const std::string& ret_type = "")
+        : name(n), args(std::move(a)), body(std::move(b)),
+          arg_types(std::move(a_types)), return_type(ret_type) {
+        arg_types.resize(args.size());
+    }
+    
+    const std::string& getArgAnnotation(size_t index) const { return arg_types[index]; }
+    bool hasReturnAnnotation() const { return !return_type.empty(); }
     llvm::Value* codegen(CodeGen& gen) override;
 };
 
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+
+namespace quill {
+
+// Math functions every program can call without defining them. Codegen
+// lowers them to LLVM intrinsics (or compare and select for min/max), so
+// the optimizer can fold, hoist and vectorize them. A user function with
+// the same name takes precedence.
+struct MathBuiltin {
+    const char* name;
+    unsigned arity;
+    bool preserves_int;   // int arguments give an int result
+};
+
+inline constexpr MathBuiltin MATH_BUILTINS[] = {
+    {"sqrt", 1, false},
+    {"abs", 1, true},
+    {"exp", 1, false},
+    {"log", 1, false},
+    {"pow", 2, false},
+    {"floor", 1, false},
+    {"min", 2, true},
+    {"max", 2, true},
+    {"fma", 3, false},
+};
+
+inline const MathBuiltin* findMathBuiltin(const std::string& name) {
+    for (const MathBuiltin& builtin : MATH_BUILTINS) {
+        if (name == builtin.name) return &builtin;
+    }
+    return nullptr;
+}
+
+} // namespace quill
@@ -1,13 +1,17 @@
 #pragma once
 #include "ast.h"
+#include "range_analysis.h"
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Value.h>
+#include <iostream>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
+#include <vector>
 
 class CodeGen {
 public:
@@ -18,16 +22,100 @@ public:
     std::unordered_map<std::string, llvm::AllocaInst*> named_values;
     llvm::Function* current_function;
     
+    // Source function whose variables are being generated; outlined
+    // parallel loop bodies keep their parent's, so range facts still apply
+    std::string current_scope;
+    
+    // Lists are pointers to a runtime header {elements*, i64 len, i64 cap}.
+    // Element types of list variables in the current function, and the
+    // declarations whose annotations give list parameter and return types.
+    std::unordered_map<std::string, llvm::Type*> list_elements;
+    std::unordered_map<std::string, const FunctionAST*> function_decls;
+    std::unordered_map<std::string, llvm::MDNode*> list_access_tags;
+    
+    // Strings are pointers to constant {i64 length, chars} records, emitted
+    // once per distinct literal; string variables of the current function
+    std::unordered_set<std::string> string_variables;
+    std::unordered_map<std::string, llvm::Constant*> string_constants;
+    
+    // Value ranges from the type checker; typed ints and narrowing use them.
+    // Arithmetic left in FP carries quill.range metadata for the
+    // type-directed pass.
+    const quill::RangeAnalysis* range_info;
+    bool narrow_integers;
+    
+    // Skip bounds checks range analysis proved redundant
+    bool elide_bounds_checks;
+    
+    // Fast-math flags stamped on every floating-point operation; empty
+    // (strict IEEE semantics) unless requested on the command line
+    llvm::FastMathFlags fast_math_flags;
+    
+    // Every error log_error_v reported; the compile fails unless empty
+    std::vector<std::string> errors;
+    
     CodeGen();
     
     void generate(ProgramAST& program);
+    void set_range_info(const quill::RangeAnalysis* info, bool narrow) {
+        range_info = info;
+        narrow_integers = narrow;
+    }
     llvm::Value* log_error_v(const char* str);
-    llvm::AllocaInst* create_entry_block_alloca(llvm::Function* function, const std::string& var_name);
+    llvm::AllocaInst* create_entry_block_alloca(llvm::Function* function, const std::string& var_name,
+                                                llvm::Type* type = nullptr);
+    
+    // Integer narrowing driven by range analysis
+    const quill::ValueRange* expression_range(const ExprAST* expr) const;
+    llvm::Type* variable_type(const std::string& var_name);
+    llvm::Type* annotation_type(const std::string& annotation);
+    llvm::IntegerType* integer_type_for(const quill::ValueRange& range);
+    llvm::Value* to_double(llvm::Value* val);
+    llvm::Value* to_integer(llvm::Value* val, llvm::IntegerType* type);
+    llvm::Value* convert_to(llvm::Value* val, llvm::Type* type);
+    
+    // List support
+    llvm::StructType* list_type(llvm::Type* element_type);
+    llvm::PointerType* list_pointer_type(llvm::Type* element_type);
+    llvm::Type* annotation_element_type(const std::string& annotation);
+    llvm::Type* list_element_type(const ExprAST* expr);
+    
+    // String support
+    llvm::StructType* string_type();
+    llvm::PointerType* string_pointer_type();
+    llvm::Constant* string_constant(const std::string& value);
+    bool is_string(const ExprAST* expr) const;
+    
+    // TBAA tag for one kind of list memory: the "elements", "length" or
+    // "capacity" header field, or "f64"/"i64" element storage. Distinct
+    // kinds never alias, so element stores leave header loads invariant.
+    llvm::MDNode* list_access_tag(const std::string& kind);
+    
+    // convert_to that also checks list-ness and element type against the target slot
+    llvm::Value* convert_operand(const ExprAST* expr, llvm::Value* val, llvm::Type* type,
+                                 llvm::Type* element_type);
+    
+    // Attach the expression's range as quill.range metadata for the optimizer
+    llvm::Value* annotate_range(llvm::Value* val, const ExprAST* expr);
     
     void print_ir();
-    void write_object_file(const std::string& filename);
+    void write_object_file(const std::string& filename, std::ostream& log = std::cout);
+    // The module text print_ir and write_object_file emit
+    std::string ir_text() const;
     
     // Helper functions for builtin operations
     llvm::Function* get_printf_function();
     llvm::Function* get_print_double_function();
+    llvm::Function* get_print_int_function();
+    llvm::Function* get_print_str_function();
+    // Runtime output is buffered; quill_flush_output runs as a module destructor
+    void register_output_flush();
+    llvm::Function* get_list_new_function();
+    llvm::Function* get_list_grow_function();
+    llvm::Function* get_index_error_function();
+    llvm::Function* get_zero_division_error_function();
+    
+    // Parallel loops: outlined bodies run void(env, begin, end, partials)
+    llvm::FunctionType* get_parallel_body_type();
+    llvm::Function* get_parallel_for_function();
 };
\ No newline at end of file
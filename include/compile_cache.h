@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace quill {
+
+// Content-addressed cache of compiled modules and functions.
+//
+// A key hashes everything that determines the output: source bytes,
+// compiler build, host target and every flag that changes codegen. Entries
+// are the emitted artifacts, one file each, named after the key. Hits
+// refresh the file's access time and pruning deletes the least recently
+// used entries once the directory exceeds its size limit.
+//
+// Counters and pruning are batched until flush(), so a compile that looks
+// up thousands of functions takes the lock and scans the directory once.
+// One cache may be shared by compiles running on several threads.
+class CompileCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t entries = 0;
+        uint64_t bytes = 0;
+    };
+    
+    // Accumulates key material; each field is length-prefixed so adjacent
+    // fields cannot run together
+    class KeyBuilder {
+    public:
+        KeyBuilder& add(const std::string& name, const std::string& value);
+        KeyBuilder& addFile(const std::string& name, const std::string& path);
+        std::string finish() const;  // hex SHA-1
+    
+    private:
+        std::string material;
+    };
+    
+    static constexpr uint64_t DEFAULT_MAX_BYTES = 512ull << 20;
+    
+    explicit CompileCache(std::string directory, uint64_t max_bytes = DEFAULT_MAX_BYTES);
+    ~CompileCache();
+    
+    // $QUILL_CACHE_DIR, else the user cache directory (~/.cache/quill)
+    static std::string defaultDirectory();
+    
+    // Identity of this compiler build and host: LLVM version, target and
+    // CPU, plus the executable's size and modification time, so
+    // rebuilding quill invalidates entries
+    static std::string compilerIdentity(const char* argv0);
+    
+    bool lookup(const std::string& key, std::string& artifact);
+    void store(const std::string& key, const std::string& artifact);
+    
+    // Records pending counters and prunes if anything was stored
+    void flush();
+    
+    Stats getStats();
+    void printStats();
+    
+    const std::string& getDirectory() const { return directory; }
+
+private:
+    std::string directory;
+    uint64_t max_bytes;
+    uint64_t pending_hits = 0;
+    uint64_t pending_misses = 0;
+    bool needs_prune = false;
+    std::mutex pending_mutex;  // guards the three fields above
+    
+    std::string entryPath(const std::string& key) const;
+    std::string statsPath() const;
+    // Adds to the persistent counters under a file lock, since concurrent
+    // builds share the directory
+    void recordCounters(uint64_t hits, uint64_t misses, uint64_t evictions) const;
+    void prune();
+    uint64_t countEntries(uint64_t* bytes = nullptr) const;
+};
+
+} // namespace quill
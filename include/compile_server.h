@@ -0,0 +1,46 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace quill {
+
+// Long-running compile server on a Unix domain socket.
+//
+// Each request runs in a child forked from the server after its warm-up, so
+// it starts with LLVM's targets, host detection and lazily built tables
+// already initialized instead of paying for them in a fresh process.
+// Clients hand over their stdin, stdout and stderr with the command line, so
+// compiler output streams straight to them; the child also takes on the
+// client's working directory and QUILL_* environment. Both ends check the
+// peer's credentials and only talk to processes of the same user.
+//
+// Nothing here depends on LLVM, so the quill-client executable can link it
+// without paying for LLVM's static initialization.
+class CompileServer {
+public:
+    using Compiler = std::function<int(int argc, char* argv[])>;
+    
+    explicit CompileServer(std::string socket_path);
+    
+    // $QUILL_SERVER_SOCKET, else quill-<uid>.sock in $XDG_RUNTIME_DIR, else
+    // server.sock in a 0700 /tmp/quill-<uid> created on first use. Empty
+    // (with an error printed) if that directory is not safely ours.
+    static std::string defaultSocketPath();
+    
+    // Accepts requests until SIGINT or SIGTERM; returns the exit status.
+    // `compile` must flush any output streams of its own before returning.
+    int serve(const Compiler& compile);
+    
+    // Runs `args` (without argv[0]) on the server at `socket_path` and sets
+    // the exit status. False if no server accepted the connection.
+    static bool forward(const std::string& socket_path, const std::vector<std::string>& args, int& status);
+    
+private:
+    std::string socket_path;
+    
+    // Runs in the forked child and never returns
+    [[noreturn]] void handle(int connection, const Compiler& compile);
+};
+
+} // namespace quill
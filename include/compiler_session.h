@@ -0,0 +1,112 @@
+#pragma once
+#include "optimization_passes.h"
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class TargetMachine;
+namespace orc {
+class LLJIT;
+}
+}
+
+namespace quill {
+
+class CompileCache;
+
+// Everything that changes the generated module
+struct SessionOptions {
+    QuillOptimizationManager::OptimizationLevel opt_level = QuillOptimizationManager::O0;
+    bool type_checking = true;
+    bool memoize = false;
+    bool no_memoize = false;
+    bool link_runtime = true;
+    bool fast_math = false;
+    bool associative_math = false;
+    bool no_signed_zeros = false;
+    std::string profile_generate;
+    std::string profile_use;
+    // Counts what every pass changed (QuillOptimizationManager::setDetailedStatistics)
+    bool detailed_statistics = false;
+    
+    // Reuses optimized bodies of unchanged functions; `cache_salt` must
+    // identify the compiler build (CompileCache::compilerIdentity)
+    CompileCache* cache = nullptr;
+    std::string cache_salt;
+};
+
+struct CompileResult {
+    // The context owns the module, so it is declared (and outlives it) first
+    std::unique_ptr<llvm::LLVMContext> context;
+    std::unique_ptr<llvm::Module> module;
+    
+    // Type checking does not stop a compile, except for values that contradict
+    // a declared annotation (thrown); diagnostics are reported here
+    bool type_errors = false;
+    std::vector<std::string> errors;
+    std::vector<std::string> warnings;
+    
+    // For reports; it no longer refers to the module's type information
+    std::unique_ptr<QuillOptimizationManager> optimizer;
+    
+    size_t tokens = 0;
+    double lexing_ms = 0;
+    double parsing_ms = 0;
+    double type_checking_ms = 0;
+    double codegen_ms = 0;
+    double optimization_ms = 0;  // zero when no pass ran
+    
+    bool hasDiagnostics() const { return type_errors || !errors.empty() || !warnings.empty(); }
+    std::string irText() const;
+};
+
+// Compiles Quill source held in memory. A session keeps what does not
+// depend on the program between calls: the host TargetMachine used for
+// object code and the JIT with everything it has loaded. Each compile
+// still gets its own LLVMContext.
+//
+// Syntax errors, values that contradict a declared type and LLVM failures
+// are thrown as std::runtime_error. A session is not thread-safe; use one
+// per thread.
+//
+// Programs run by jit() share the host process: a runtime error in one (a
+// bad list index, integer modulo by zero, out of memory) calls exit(1) and
+// ends the host too, unless the host installed quill_set_error_handler
+// (runtime.h) and its handler does not return.
+class CompilerSession {
+public:
+    explicit CompilerSession(SessionOptions options = SessionOptions());
+    ~CompilerSession();
+    
+    SessionOptions& getOptions() { return options; }
+    
+    // `name` identifies the module in diagnostics and the JIT
+    CompileResult compile(const std::string& source, const std::string& name = "quill");
+    
+    std::string emitIR(const std::string& source);
+    std::string emitBitcode(const std::string& source);
+    // Host object code, ready to link with runtime.o
+    std::string emitObject(const std::string& source);
+    
+    // Compiles `source` into the session's JIT and returns the address of
+    // `function` (extern "C" calling convention; Quill numbers are double).
+    // Each call loads a separate library, so programs may reuse names.
+    // Static destructors do not run: call flushOutput() after the program
+    // printed.
+    void* jit(const std::string& source, const std::string& function = "main");
+    static void flushOutput();
+    
+private:
+    SessionOptions options;
+    std::unique_ptr<llvm::TargetMachine> target_machine;
+    std::unique_ptr<llvm::orc::LLJIT> jit_engine;
+    unsigned jit_libraries = 0;
+    
+    llvm::TargetMachine& hostTargetMachine();
+    llvm::orc::LLJIT& jitEngine();
+};
+
+} // namespace quill
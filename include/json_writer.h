@@ -0,0 +1,50 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace quill {
+
+// Streams indented JSON. Calls must nest properly; inside an object every
+// value is preceded by key(), or written in one go with field().
+class JsonWriter {
+public:
+    explicit JsonWriter(std::ostream& out);
+    
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+    void key(const std::string& name);
+    
+    void value(const std::string& text);
+    void value(const char* text);
+    void value(bool flag);
+    // Non-finite numbers are written as null
+    void value(double number);
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type value(T number) {
+        beginValue();
+        out << std::to_string(number);
+    }
+    
+    template <typename T>
+    void field(const std::string& name, const T& v) {
+        key(name);
+        value(v);
+    }
+    
+private:
+    std::ostream& out;
+    // One entry per open object or array: whether it holds anything yet
+    std::vector<bool> nonempty;
+    bool after_key = false;
+    
+    void beginValue();
+    void writeString(const std::string& text);
+    void close(char bracket);
+    void newline();
+};
+
+} // namespace quill
@@ -1,18 +1,25 @@
 #pragma once
 #include <llvm/IR/PassManager.h>
+#include <llvm/IR/PassInstrumentation.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/Analysis/LoopInfo.h>
 #include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <llvm/Target/TargetMachine.h>
+#include <iostream>
 #include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
 // Forward declarations
 namespace llvm {
     class Value;
     class Instruction;
     class BasicBlock;
+    class IRMover;
 }
 
 namespace quill {
@@ -21,7 +28,7 @@ namespace quill {
 class QuillConstantFoldingPass : public llvm::PassInfoMixin<QuillConstantFoldingPass> {
 public:
     llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
-    
+
 private:
     bool foldBinaryOperations(llvm::Function &F);
     bool foldConstants(llvm::Function &F);
@@ -32,7 +39,7 @@ private:
 class QuillDeadCodeEliminationPass : public llvm::PassInfoMixin<QuillDeadCodeEliminationPass> {
 public:
     llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
-    
+
 private:
     bool eliminateDeadInstructions(llvm::Function &F);
     bool eliminateUnreachableBlocks(llvm::Function &F);
@@ -40,22 +47,86 @@ private:
 };
 
 // Simple Function Inlining Pass
+// With a profile loaded, hot call sites get a larger budget and cold ones
+// are left alone
 class QuillFunctionInliningPass : public llvm::PassInfoMixin<QuillFunctionInliningPass> {
 public:
     llvm::PreservedAnalyses run(llvm::Module &M, llvm::ModuleAnalysisManager &AM);
     
+    int getCallsInlined() const { return calls_inlined; }
+
 private:
-    bool shouldInlineFunction(llvm::Function* func);
-    bool inlineSmallFunctions(llvm::Module &M);
+    bool shouldInlineFunction(llvm::Function* func, bool hot_call_site);
+    bool inlineSmallFunctions(llvm::Module &M, llvm::ModuleAnalysisManager &AM);
     int calculateInstructionCount(llvm::Function* func);
     static const int INLINE_THRESHOLD = 20; // Instructions
+    static const int HOT_INLINE_THRESHOLD = 80;
+    static const int HOT_INLINE_MAX_BLOCKS = 12;
+    
+    int calls_inlined = 0;
+};
+
+// Function Specialization Pass
+// Clones functions for call sites that pass constant arguments, folds the
+// constants into the clone and keeps total code growth within a budget
+class QuillFunctionSpecializationPass : public llvm::PassInfoMixin<QuillFunctionSpecializationPass> {
+public:
+    struct SpecializationStats {
+        int functions_specialized = 0;
+        int call_sites_specialized = 0;
+        int instructions_added = 0;
+        int growth_budget = 0;
+        int constants_folded = 0;  // in clones that were kept
+    };
+    
+    llvm::PreservedAnalyses run(llvm::Module &M, llvm::ModuleAnalysisManager &AM);
+    
+    const SpecializationStats& getStats() const { return stats; }
+
+private:
+    bool specializeCallSites(llvm::Module &M);
+    llvm::Function* createSpecialization(llvm::Function* callee, const std::vector<llvm::Constant*>& constants);
+    void propagateArgumentConstants(llvm::Function* clone);
+    // Returns the number of instructions folded to constants
+    int simplifySpecialization(llvm::Function* clone);
+    bool canSpecialize(llvm::Function* func);
+    int calculateInstructionCount(llvm::Function* func);
+    
+    static const int MAX_FUNCTION_SIZE = 200;   // Instructions
+    static const int GROWTH_PERCENT = 25;       // Of the module's size
+    static const int MIN_GROWTH_BUDGET = 64;    // Instructions
+    
+    SpecializationStats stats;
+};
+
+// Memoization Pass
+// Wraps pure, tree-recursive numeric functions in a lookup against a
+// runtime memo table (quill_memo_lookup / quill_memo_store in runtime.c)
+class QuillMemoizationPass : public llvm::PassInfoMixin<QuillMemoizationPass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Module &M, llvm::ModuleAnalysisManager &AM);
+    
+    int getFunctionsMemoized() const { return functions_memoized; }
+
+private:
+    std::set<llvm::Function*> findPureFunctions(llvm::Module &M);
+    // Functions reachable from parallel loop bodies; memo tables are not thread-safe
+    std::set<llvm::Function*> findParallelCallees(llvm::Module &M);
+    bool isPureBody(llvm::Function* func, const std::set<llvm::Function*>& pure);
+    bool shouldMemoize(llvm::Function* func);
+    void memoizeFunction(llvm::Function* func);
+    static bool hasNumericSignature(llvm::Function* func);
+    
+    static const unsigned MAX_MEMO_ARITY = 4;
+    
+    int functions_memoized = 0;
 };
 
 // Loop Optimization Pass  
 class QuillLoopOptimizationPass : public llvm::PassInfoMixin<QuillLoopOptimizationPass> {
 public:
     llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
-    
+
 private:
     bool optimizeLoops(llvm::Function &F);
     bool unrollSmallLoops(llvm::Function &F);
@@ -63,15 +134,56 @@ private:
 };
 
 // Arithmetic Simplification Pass
+// Rewrites that produce a constant count as folds, the rest as simplifications
 class QuillArithmeticSimplificationPass : public llvm::PassInfoMixin<QuillArithmeticSimplificationPass> {
 public:
+    explicit QuillArithmeticSimplificationPass(int* expressions_simplified = nullptr, int* constants_folded = nullptr)
+        : expressions_simplified(expressions_simplified), constants_folded(constants_folded) {}
     llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
-    
+
 private:
     bool simplifyArithmetic(llvm::Function &F);
     llvm::Value* simplifyExpression(llvm::BinaryOperator* binOp);
     bool isZero(llvm::Value* val);
+    bool isNegativeZero(llvm::Value* val);
     bool isOne(llvm::Value* val);
+    
+    int* expressions_simplified;
+    int* constants_folded;
+};
+
+// Accumulator Recursion Pass
+// Turns self-recursion of the form `return x op f(...)` into a loop when
+// TailCallElim cannot, because op is not associative (floating-point math
+// without --ffast-math, subtraction, division). Each level's x goes on a
+// heap stack on the way down and is folded back in reverse order on the
+// way up, so results match the recursive code exactly and deep recursion
+// no longer grows the call stack. An x that is the same at every level (a
+// constant, or an argument passed on unchanged) needs no stack: the way up
+// folds it in once per level.
+class QuillAccumulatorRecursionPass : public llvm::PassInfoMixin<QuillAccumulatorRecursionPass> {
+public:
+    explicit QuillAccumulatorRecursionPass(int* functions_rewritten = nullptr)
+        : functions_rewritten(functions_rewritten) {}
+    llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+
+private:
+    // A `ret (x op call)` site: the call is the last thing with effects
+    struct RecursiveReturn {
+        llvm::CallInst* call;
+        llvm::BinaryOperator* op;
+        llvm::ReturnInst* ret;
+    };
+    
+    bool findRecursiveReturns(llvm::Function &F, std::vector<RecursiveReturn>& recursive,
+                              std::vector<llvm::ReturnInst*>& base);
+    bool matchRecursiveReturn(llvm::ReturnInst* ret, RecursiveReturn& site);
+    // The operand every site folds in, when it is the same at every level
+    llvm::Value* invariantOperand(llvm::Function &F, const std::vector<RecursiveReturn>& recursive);
+    void rewriteAsLoop(llvm::Function &F, const std::vector<RecursiveReturn>& recursive,
+                       const std::vector<llvm::ReturnInst*>& base);
+    
+    int* functions_rewritten;
 };
 
 // Forward declaration for type system integration
@@ -81,12 +193,12 @@ class TypeChecker;
 class QuillTypeDirectedOptimizationPass : public llvm::PassInfoMixin<QuillTypeDirectedOptimizationPass> {
 public:
     struct TypeOptimizationStats {
-        int specializations_applied = 0;
         int type_casts_eliminated = 0;
         int numeric_optimizations = 0;
         int integer_arithmetic_optimized = 0;
         int division_to_shifts = 0;
         int multiplication_to_shifts = 0;
+        int integer_chains_converted = 0;
     };
     
     QuillTypeDirectedOptimizationPass();
@@ -98,15 +210,16 @@ public:
     
     // Type information integration
     void setTypeInformation(const TypeChecker* type_checker) { type_info = type_checker; }
-    
+
 private:
     bool optimizeNumericOperations(llvm::Function &F);
     bool eliminateUnnecessaryTypeCasts(llvm::Function &F);
-    bool specializeGenericFunctions(llvm::Function &F);
     bool optimizePolymorphicCalls(llvm::Function &F);
     bool inlineMonomorphicFunctions(llvm::Function &F);
     
     // Enhanced optimizations with type information
+    // Rewrites FP dataflow chains that quill.range metadata proves hold
+    // exact integers into i64 arithmetic, converting only at chain edges
     bool optimizeIntegerArithmetic(llvm::Function &F);
     bool optimizeDivisionToShifts(llvm::Function &F);
     bool optimizeMultiplicationToShifts(llvm::Function &F);
@@ -114,7 +227,7 @@ private:
     // Utility methods
     bool isIntegerConstant(llvm::Value* val, int64_t& out_value);
     bool isFloatConstant(llvm::Value* val, double& out_value);
-    bool canSpecializeFunction(llvm::Function* func);
+    bool isExactIntegerOperand(llvm::Value* val, double& lo, double& hi);
     bool isPowerOfTwo(int64_t value);
     int getShiftAmount(int64_t power_of_two);
     
@@ -125,6 +238,9 @@ private:
     const TypeChecker* type_info = nullptr;
 };
 
+class CompileCache;
+class JsonWriter;
+
 // Optimization Pass Manager for Quill
 class QuillOptimizationManager {
 public:
@@ -137,43 +253,179 @@ public:
     
     QuillOptimizationManager(OptimizationLevel level = O0);
     
+    // Initializes the native target and detects the host CPU; otherwise
+    // done by the first optimization run
+    static void initializeHost();
+    // Tuned for the host CPU; null if the native target is unavailable
+    static std::unique_ptr<llvm::TargetMachine> createHostTargetMachine();
+    
     void runOptimizations(llvm::Module& module);
     void setOptimizationLevel(OptimizationLevel level);
     void enablePass(const std::string& pass_name);
     void disablePass(const std::string& pass_name);
     
+    // Enables the type-directed pass to trust codegen's range metadata
+    void setTypeInformation(const TypeChecker* type_checker);
+    
+    // Profile-guided optimization: instrument the program to write raw
+    // counts to `path` when it exits, or optimize with counts merged by
+    // llvm-profdata. The two builds must see the same source and level.
+    void setProfileGenerate(const std::string& path);
+    void setProfileUse(const std::string& path);
+    
+    // Incremental compilation: each function's optimized body is cached
+    // under a hash of its IR as it enters the function pipeline, so only
+    // functions whose code or inlined callees changed are optimized again.
+    // `compiler_identity` keys out other builds of quill.
+    void setFunctionCache(CompileCache* cache, const std::string& compiler_identity);
+    
     // Performance reporting
     struct OptimizationStats {
-        int instructions_eliminated = 0;
+        int instructions_eliminated = 0;  // net; negative when unrolling and vectorizing grew the code
         int constants_folded = 0;
+        int expressions_simplified = 0;
         int functions_inlined = 0;
         int loops_optimized = 0;
+        int functions_memoized = 0;
+        int recursions_to_loops = 0;  // by the accumulator pass; TailCallElim keeps no count
         double optimization_time_ms = 0.0;
         
         // Type-directed optimization stats
-        int type_specializations = 0;
         int type_casts_eliminated = 0;
         int numeric_operations_optimized = 0;
         int divisions_to_shifts = 0;
         int multiplications_to_shifts = 0;
+        int integer_chains_converted = 0;
+        
+        // Function specialization stats
+        int functions_specialized = 0;
+        int specialized_call_sites = 0;
+        int specialization_growth = 0;
+        int specialization_budget = 0;
+        
+        // Vectorization stats, gathered from optimization remarks
+        int loops_vectorized = 0;
+        int slp_trees_vectorized = 0;
+        std::vector<std::string> vectorization_remarks;
+        
+        // Runtime link-time optimization stats
+        bool runtime_linked = false;
+        int runtime_functions_linked = 0;
+        int runtime_calls_inlined = 0;
+        
+        // Profile-guided optimization stats
+        bool profile_instrumented = false;
+        bool profile_applied = false;
+        int hot_functions = 0;
+        int cold_functions = 0;
+        
+        // Incremental compilation stats
+        int functions_optimized = 0;
+        int functions_reused = 0;
+        
+        // Instruction counts of the program's functions as codegen left them
+        // and after optimization. Functions the optimizer removed end at
+        // zero; ones it created (specializations) start at zero.
+        struct FunctionSize {
+            std::string name;
+            int instructions_before = 0;
+            int instructions_after = 0;
+        };
+        std::vector<FunctionSize> function_sizes;
+        
+        // Every pass that ran, in first-run order; only with detailed statistics
+        struct PassActivity {
+            std::string name;
+            int runs = 0;
+            int runs_changed = 0;       // runs that did not preserve all analyses
+            int instructions_added = 0; // net, across all runs
+        };
+        std::vector<PassActivity> passes;
     };
     
     const OptimizationStats& getStats() const { return stats; }
-    void printOptimizationReport() const;
+    void printOptimizationReport(std::ostream& out = std::cout) const;
+    void writeStatisticsJSON(JsonWriter& json) const;
     
+    // Records what every pass run changed. Costs an instruction count
+    // around each pass, so it is off unless statistics are being exported.
+    void setDetailedStatistics(bool enabled) { detailed_statistics = enabled; }
+
 private:
     OptimizationLevel opt_level;
     OptimizationStats stats;
     
     std::unique_ptr<llvm::FunctionPassManager> function_pm;
+    // Vectorizers and unrolling, after the type-directed pass
+    std::unique_ptr<llvm::FunctionPassManager> vectorize_pm;
     std::unique_ptr<llvm::ModulePassManager> module_pm;
     
     // Reference to type-directed pass for statistics collection
     std::unique_ptr<QuillTypeDirectedOptimizationPass> type_directed_pass;
+    // Runs after type_directed_pass changed a function
+    std::unique_ptr<llvm::FunctionPassManager> cleanup_pm;
+    std::unique_ptr<QuillFunctionSpecializationPass> specialization_pass;
+    std::unique_ptr<QuillMemoizationPass> memoization_pass;
+    std::unique_ptr<QuillFunctionInliningPass> inlining_pass;
+    const TypeChecker* type_info = nullptr;
+    
+    std::string profile_generate_path;
+    std::string profile_use_path;
+    
+    // Shared by the pass pipelines; feeds passes into --time-trace and
+    // the detailed statistics
+    llvm::PassInstrumentationCallbacks pass_callbacks;
+    bool detailed_statistics = false;
+    // Instruction counts of the IR units of the passes currently running
+    std::vector<int> pass_sizes_before;
+    
+    // Host machine the vectorizers tune for; null if the host target is unavailable
+    std::unique_ptr<llvm::TargetMachine> target_machine;
+    
+    // Passes switched on or off explicitly, overriding the level's default
+    std::set<std::string> enabled_passes;
+    std::set<std::string> disabled_passes;
+    
+    // Definitions that came from the embedded runtime; clang already
+    // optimized them, so the function pipeline skips them
+    std::set<std::string> runtime_functions;
+    
+    CompileCache* function_cache = nullptr;
+    std::string function_cache_salt;
     
     void setupPassPipeline();
+    bool isPassEnabled(const std::string& pass_name, bool enabled_by_default) const;
     void addBasicOptimizations();
     void addAdvancedOptimizations();
+    void configureForHost(llvm::Module& module);
+    // Links the embedded runtime bitcode into the module and internalizes
+    // everything but main
+    bool linkRuntime(llvm::Module& module);
+    // Inlines runtime calls from generated code where the cost model agrees,
+    // then drops the runtime functions left unreferenced
+    void inlineRuntimeCalls(llvm::Module& module);
+    // Runs before any other pass, so the generate and use builds agree on
+    // the CFG the counters describe
+    void instrumentForProfiling(llvm::Module& module);
+    void applyProfile(llvm::Module& module);
+    // Turns the counter intrinsics into globals and runtime registration
+    void lowerProfileCounters(llvm::Module& module);
+    // Loops left with a preheader and a computable trip count
+    void countCanonicalLoops(llvm::Function& F, llvm::FunctionAnalysisManager& FAM);
+    void recordPassRun(llvm::StringRef pass, int size_before, int size_after, bool changed);
+    void runFunctionPipeline(llvm::Function& F, llvm::FunctionAnalysisManager& FAM);
+    // runFunctionPipeline, or F's body from an earlier identical run
+    void optimizeFunction(llvm::Function& F, llvm::FunctionAnalysisManager& FAM, llvm::IRMover& mover);
+    std::string functionCacheKey(llvm::Function& F, const std::vector<llvm::GlobalValue*>& references);
+    bool restoreFunction(llvm::Function& F, const std::vector<llvm::GlobalValue*>& references,
+                         const std::string& artifact, llvm::IRMover& mover);
+    void storeFunction(llvm::Function& F, const std::vector<llvm::GlobalValue*>& references,
+                       const std::string& key);
+    // Orders the uses of F's arguments, blocks and instructions by position.
+    // Use lists otherwise record the order uses were made in, which a body
+    // cloned and read back from the cache cannot reproduce (it shows up as
+    // the order of predecessors).
+    static void sortUseLists(llvm::Function& F);
 };
 
 } // namespace quill
\ No newline at end of file
@@ -16,6 +16,7 @@ private:
     void consume(TokenType type, const std::string& message);
     
     std::unique_ptr<ExprAST> parse_primary();
+    std::unique_ptr<ExprAST> parse_postfix();
     std::unique_ptr<ExprAST> parse_unary();
     std::unique_ptr<ExprAST> parse_factor();
     std::unique_ptr<ExprAST> parse_term();
@@ -29,12 +30,14 @@ private:
     std::unique_ptr<StmtAST> parse_expression_statement();
     std::unique_ptr<StmtAST> parse_if_statement();
     std::unique_ptr<StmtAST> parse_while_statement();
+    std::unique_ptr<StmtAST> parse_for_statement(bool parallel = false);
     std::unique_ptr<StmtAST> parse_return_statement();
     std::unique_ptr<StmtAST> parse_print_statement();
     std::unique_ptr<StmtAST> parse_block();
     std::unique_ptr<StmtAST> parse_statement();
     
     std::unique_ptr<FunctionAST> parse_function();
+    std::string parse_type_annotation();
     
     void skip_newlines();
     
@@ -0,0 +1,177 @@
+#pragma once
+#include "ast.h"
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+namespace quill {
+
+// Metadata kind codegen uses to hand ranges to the optimizer.
+// Operands: !{double lo, double hi, i1 integral, i1 negative_zero}
+constexpr const char* RANGE_METADATA_KIND = "quill.range";
+
+// Closed interval of values an expression or variable can take.
+// `integral` means every value in the interval is a whole number;
+// `native_int` means the value has declared type int and lives in a
+// 64-bit integer rather than a double; `negative_zero` means the value
+// may be the double -0.0, which compares equal to 0 but prints and
+// divides differently, so no integer can stand in for it. `nan` means the
+// value may also be NaN, which lies outside [lo, hi]: inf - inf and
+// 0 * inf are NaN even when both operands are integral.
+struct ValueRange {
+    double lo = -std::numeric_limits<double>::infinity();
+    double hi = std::numeric_limits<double>::infinity();
+    bool integral = false;
+    bool native_int = false;
+    bool negative_zero = true;
+    bool nan = true;
+
+    static ValueRange top() { return ValueRange(); }
+    static ValueRange constant(double value);
+    static ValueRange interval(double lo, double hi, bool integral);
+    static ValueRange nativeInteger();
+
+    bool isEmpty() const { return lo > hi; }
+    bool isBounded() const;
+    bool contains(double value) const { return lo <= value && value <= hi; }
+    bool equals(const ValueRange& other) const;
+
+    // Integral, never -0.0 or NaN and small enough that double and
+    // integer arithmetic agree (|x| < 2^53)
+    bool isExactInteger() const;
+    bool fitsInt32() const;
+
+    ValueRange join(const ValueRange& other) const;
+    ValueRange widen(const ValueRange& next) const;
+    ValueRange intersect(const ValueRange& other) const;
+
+    std::string toString() const;
+};
+
+// Interval arithmetic matching Quill's runtime semantics
+class RangeArithmetic {
+public:
+    static ValueRange add(const ValueRange& a, const ValueRange& b);
+    static ValueRange sub(const ValueRange& a, const ValueRange& b);
+    static ValueRange mul(const ValueRange& a, const ValueRange& b);
+    static ValueRange div(const ValueRange& a, const ValueRange& b);
+    static ValueRange rem(const ValueRange& a, const ValueRange& b);
+    static ValueRange neg(const ValueRange& a);
+    static ValueRange min(const ValueRange& a, const ValueRange& b);
+    static ValueRange max(const ValueRange& a, const ValueRange& b);
+    static ValueRange abs(const ValueRange& a);
+    static ValueRange floor(const ValueRange& a);
+    // Monotonically increasing functions defined for x >= domain_lo
+    static ValueRange increasing(const ValueRange& a, double (*fn)(double), double domain_lo);
+    static ValueRange boolean();
+};
+
+// Flow-sensitive value-range analysis over a function body.
+//
+// Walks the AST the way codegen lowers it and records, for every
+// expression and every assigned variable, an interval covering all
+// values it can hold. Loops iterate to a fixpoint with widening; branch
+// and loop conditions of the form `var <op> expr` narrow the variable on
+// each edge.
+//
+// List variables carry a lower bound on their length (lists only grow)
+// and relational facts such as `i < len(xs)`, which prove individual
+// element accesses in bounds.
+class RangeAnalysis {
+public:
+    using RangeMap = std::map<std::string, ValueRange>;
+
+    // Register a signature so calls to int-returning functions are typed
+    void declareFunction(const FunctionAST* function);
+    void analyzeFunction(const FunctionAST* function);
+    void clear();
+
+    // Range of an expression node, or nullptr if it was never reached
+    const ValueRange* getExpressionRange(const ExprAST* expr) const;
+
+    // Range of all values ever stored to a local variable of a function
+    const ValueRange* getVariableRange(const std::string& function_name,
+                                       const std::string& variable) const;
+    
+    // True when every evaluation of the access had its index in bounds
+    bool isIndexSafe(const IndexExprAST* expr) const;
+    
+    // The type checker typed the literal list[float]; it is stored as
+    // doubles whatever values its elements take
+    void markFloatList(const ListExprAST* expr);
+    
+    // True when the literal is not list[float] and its elements are all
+    // exact integers, so it is stored as list[int]
+    bool hasIntegerElements(const ListExprAST* expr) const;
+    
+    static bool isListAnnotation(const std::string& annotation);
+    static bool isIntegerListAnnotation(const std::string& annotation);
+
+    const std::map<std::string, RangeMap>& getVariableRanges() const { return variable_ranges; }
+
+private:
+    struct ListInfo {
+        double min_length = 0.0;
+        bool integer_elements = false;
+
+        bool equals(const ListInfo& other) const;
+    };
+
+    // (variable, list) pairs
+    using ListFacts = std::set<std::pair<std::string, std::string>>;
+
+    struct State {
+        RangeMap vars;
+        std::map<std::string, ListInfo> lists;
+        ListFacts below_length;   // index < len(list)
+        ListFacts length_bounds;  // bound <= len(list)
+        bool reachable = true;
+
+        ValueRange lookup(const std::string& name) const;
+        double minLength(const std::string& list) const;
+        bool provesBelowLength(const std::string& index, const std::string& list) const;
+        bool provesLengthBound(const std::string& bound, const std::string& list) const;
+        void forget(const std::string& name);
+        void join(const State& other);
+        bool equals(const State& other) const;
+    };
+
+    static const int WIDENING_DELAY = 3;
+    static const int MAX_LOOP_ITERATIONS = 32;
+
+    std::unordered_map<const ExprAST*, ValueRange> expression_ranges;
+    std::unordered_map<const IndexExprAST*, bool> safe_indexes;
+    std::unordered_map<const ListExprAST*, bool> integer_literals;
+    std::set<const ListExprAST*> float_lists;
+    std::map<std::string, RangeMap> variable_ranges;
+    std::set<std::string> integer_functions;
+    std::set<std::string> user_functions;
+    std::map<std::string, ListInfo> list_functions;
+    RangeMap* current_variables = nullptr;
+    bool recording = true;
+
+    void analyzeStatement(const StmtAST* stmt, State& state);
+    void analyzeWhile(const WhileStmtAST* stmt, State& state);
+    void analyzeFor(const ForRangeStmtAST* stmt, State& state);
+    void widenLoopState(int iteration, const State& head, State& next) const;
+    void analyzeIf(const IfStmtAST* stmt, State& state);
+    ValueRange evaluate(const ExprAST* expr, const State& state);
+    ValueRange evaluateIndex(const IndexExprAST* expr, const State& state);
+
+    // Length and element facts of a list-valued expression; false for numbers
+    bool listInfo(const ExprAST* expr, const State& state, ListInfo& info) const;
+    // The list variable `xs` when expr is the builtin call len(xs)
+    const VariableExprAST* lengthOperand(const ExprAST* expr) const;
+
+    // Narrow `state` assuming `cond` evaluated to `taken`
+    void refine(const ExprAST* cond, bool taken, State& state);
+    // Codegen compares unordered, so NaN operands take the true edge
+    void refineComparison(char op, bool taken, const ExprAST* lhs, const ExprAST* rhs, State& state);
+
+    void recordExpression(const ExprAST* expr, const ValueRange& range);
+    void recordVariable(const std::string& name, const ValueRange& range);
+};
+
+} // namespace quill
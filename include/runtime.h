@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+
+// Functions in runtime.c that generated code calls. The compiler links them
+// from runtime.o, or from libquill when a CompilerSession JIT-compiles.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint64_t* data;
+    int64_t cap;
+} quill_pending;
+
+typedef void (*quill_parallel_body)(void* env, int64_t begin, int64_t end, int64_t* partials);
+
+// The calling thread's output buffer. This is the only way to it, so the
+// print functions of a runtime linked into a module, which refer to this
+// one, fill the buffers quill_flush_output() drains.
+struct quill_output;
+struct quill_output* quill_thread_output(void);
+void quill_flush_output(void);
+void print_double(double value);
+void print_str(const char* chars, int64_t length);
+void print_int(int64_t value);
+int quill_memo_lookup(void** handle, const uint64_t* key, int arity, uint64_t* value);
+void quill_memo_store(void** handle, const uint64_t* key, int arity, uint64_t value);
+void quill_pending_reserve(quill_pending* pending, int64_t depth);
+void quill_pending_release(quill_pending* pending);
+void* quill_list_new(int64_t len, int64_t element_size);
+void quill_list_grow(void* handle, int64_t element_size);
+void quill_index_error(int64_t index, int64_t len);
+void quill_zero_division_error(void);
+void quill_parallel_for(int64_t count, quill_parallel_body body, void* env, int32_t num_reductions,
+                        const int32_t* ops, int64_t* values);
+
+// Runtime errors (a bad list index, integer modulo by zero, running out of
+// memory) end the process with exit(1) after printing the message to
+// stderr. A host that embeds the compiler can install a handler that sees
+// the message first and does not return, e.g. by longjmp-ing back to where
+// it called the program. It may run on a worker thread of a parallel loop.
+// If it returns, the runtime prints the message and exits as usual; NULL
+// restores the default.
+typedef void (*quill_error_handler)(const char* message);
+void quill_set_error_handler(quill_error_handler handler);
+
+// Where the handler is kept. The runtime linked into a module before
+// optimization refers to this one rather than a copy of its own.
+extern quill_error_handler quill_runtime_error_handler;
+
+#ifdef __cplusplus
+}
+#endif
+
+// Every symbol above, for tables that have to name them all
+#define QUILL_RUNTIME_SYMBOLS(X) \
+    X(quill_thread_output)       \
+    X(quill_flush_output)        \
+    X(print_double)              \
+    X(print_str)                 \
+    X(print_int)                 \
+    X(quill_memo_lookup)         \
+    X(quill_memo_store)          \
+    X(quill_pending_reserve)     \
+    X(quill_pending_release)     \
+    X(quill_list_new)            \
+    X(quill_list_grow)           \
+    X(quill_index_error)         \
+    X(quill_zero_division_error) \
+    X(quill_parallel_for)        \
+    X(quill_set_error_handler)   \
+    X(quill_runtime_error_handler)
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+
+namespace quill {
+
+// runtime.c compiled to LLVM bitcode and embedded at build time, so the
+// optimizer can link it into each program and inline across the boundary.
+// Empty (size 0) when the build had no clang matching the LLVM version.
+extern const unsigned char runtime_bitcode[];
+extern const size_t runtime_bitcode_size;
+
+} // namespace quill
@@ -1,18 +1,47 @@
 #pragma once
 #include <chrono>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <functional>
 
+namespace quill { class JsonWriter; }
+
+// Hardware events counted over one measurement
+struct HardwareCounters {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cache_misses = 0;
+    uint64_t branch_misses = 0;
+};
+
+struct BenchmarkOptions {
+    int warmup_iterations = 1;
+    // CPU the calling thread is pinned to while measuring; -1 leaves it free
+    int pin_cpu = -1;
+};
+
 class BenchmarkTimer {
 private:
     std::chrono::high_resolution_clock::time_point start_time;
     std::chrono::high_resolution_clock::time_point end_time;
     std::vector<double> measurements;
+    std::vector<HardwareCounters> counter_measurements;
     std::string benchmark_name;
+    // perf_event_open descriptors, the first leading the group; empty when off
+    std::vector<int> counter_fds;
+    int pinned_cpu = -1;
     
 public:
     BenchmarkTimer(const std::string& name);
+    ~BenchmarkTimer();
+    BenchmarkTimer(const BenchmarkTimer&) = delete;
+    BenchmarkTimer& operator=(const BenchmarkTimer&) = delete;
+    
+    // Counts hardware events for the calling thread in every later
+    // measurement. False where perf events are unsupported or not permitted.
+    bool enable_hardware_counters();
+    bool has_hardware_counters() const { return !counter_fds.empty(); }
     
     void start();
     void stop();
@@ -23,8 +52,18 @@ public:
     double get_min_ms() const;
     double get_max_ms() const;
     double get_stddev_ms() const;
+    double get_median_ms() const;
+    // Linearly interpolated between the closest ranks, percent in [0, 100]
+    double get_percentile_ms(double percent) const;
+    // Half width of the 95% confidence interval of the mean (Student's t)
+    double get_ci95_half_width_ms() const;
+    const std::vector<double>& get_measurements_ms() const { return measurements; }
+    const std::vector<HardwareCounters>& get_counter_measurements() const { return counter_measurements; }
     
-    void run_benchmark(int iterations, std::function<void()> benchmark_func);
+    void run_benchmark(int iterations, std::function<void()> benchmark_func,
+                       const BenchmarkOptions& options = BenchmarkOptions());
     void print_results() const;
     void save_results_csv(const std::string& filename) const;
+    void write_results_json(quill::JsonWriter& json) const;
+    bool save_results_json(const std::string& filename) const;
 };
\ No newline at end of file
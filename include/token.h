@@ -16,6 +16,8 @@ enum class TokenType {
     ELIF,
     WHILE,
     FOR,
+    IN,
+    PARALLEL,
     RETURN,
     PRINT,
     TRUE,
@@ -49,6 +51,7 @@ enum class TokenType {
     RIGHT_BRACKET,
     COMMA,
     COLON,
+    ARROW,
     
     // Special
     NEWLINE,
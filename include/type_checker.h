@@ -1,5 +1,7 @@
 #pragma once
 #include "type_system.h"
+#include "range_analysis.h"
+#include "builtins.h"
 #include "ast.h"
 #include <memory>
 #include <map>
@@ -48,9 +50,33 @@ private:
     std::vector<std::string> error_messages;
     std::vector<std::string> warning_messages;
     
+    // Values of a known type that contradict a declared annotation (a float
+    // passed or returned as an int). Unlike other type errors these stop a
+    // compile: codegen would otherwise have to truncate them.
+    std::vector<std::string> annotation_errors;
+    
+    // Function whose body is being checked, for its declared return type
+    const FunctionAST* current_function = nullptr;
+    
+    // Value ranges of integer-valued variables, consumed by codegen
+    RangeAnalysis range_analysis;
+    
     // Built-in functions
     void initializeBuiltins();
     
+    // Builtins returning int when every argument is an int (abs, min, max)
+    std::set<const Type*> integer_preserving_builtins;
+    
+    // Resolve a source annotation, falling back when absent or malformed
+    std::unique_ptr<Type> resolveAnnotation(const std::string& annotation,
+                                            std::unique_ptr<Type> fallback,
+                                            bool report_errors);
+    
+    // Checks a value against a declared type; adds an error naming both to
+    // `result` when they conflict, and records it if the value's type is known
+    void checkDeclaredType(const Type* declared, const Type* actual, const std::string& context,
+                           TypeCheckResult& result);
+    
     // Internal helper functions are implemented in the .cpp file
     
     // Control flow analysis
@@ -76,8 +102,10 @@ public:
     TypeCheckResult checkReturn(const ReturnStmtAST* stmt);
     TypeCheckResult checkIf(const IfStmtAST* stmt);
     TypeCheckResult checkWhile(const WhileStmtAST* stmt);
+    TypeCheckResult checkFor(const ForRangeStmtAST* stmt);
     TypeCheckResult checkPrint(const PrintStmtAST* stmt);
     TypeCheckResult checkBlock(const BlockStmtAST* stmt);
+    TypeCheckResult checkIndexAssignment(const IndexAssignmentStmtAST* stmt);
     
     // Type inference for expressions
     TypeCheckResult inferExpressionType(ExprAST* expr);
@@ -87,6 +115,8 @@ public:
     TypeCheckResult inferBinaryType(BinaryExprAST* expr);
     TypeCheckResult inferUnaryType(UnaryExprAST* expr);
     TypeCheckResult inferCallType(CallExprAST* expr);
+    TypeCheckResult inferListType(ListExprAST* expr);
+    TypeCheckResult inferIndexType(IndexExprAST* expr);
     
     // Type compatibility checking
     bool isAssignable(const Type* target, const Type* source);
@@ -102,6 +132,7 @@ public:
     // Error and warning access
     const std::vector<std::string>& getErrors() const { return error_messages; }
     const std::vector<std::string>& getWarnings() const { return warning_messages; }
+    const std::vector<std::string>& getAnnotationErrors() const { return annotation_errors; }
     void clearMessages();
     
     // Type information access
@@ -112,6 +143,9 @@ public:
     void beginInference();
     void endInference();
     InferenceContext* getCurrentContext() { return current_context.get(); }
+    
+    // Value-range analysis results for the last checked program
+    const RangeAnalysis& getRangeAnalysis() const { return range_analysis; }
 };
 
 // Type annotation support for explicit type declarations
@@ -118,6 +118,7 @@ public:
     
     std::string toString() const override;
     bool equals(const Type* other) const override;
+    bool isAssignableFrom(const Type* other) const override;
     Type* clone() const override;
 };
 
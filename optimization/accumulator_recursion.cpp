@@ -0,0 +1,275 @@
+#include "../include/optimization_passes.h"
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/MDBuilder.h>
+
+using namespace llvm;
+using namespace quill;
+
+PreservedAnalyses QuillAccumulatorRecursionPass::run(Function &F, FunctionAnalysisManager &AM) {
+    if (F.isDeclaration() || F.isVarArg() || F.getName() == "main") return PreservedAnalyses::all();
+    
+    // Operands travel through the pending stack as 8-byte words
+    Type *return_type = F.getReturnType();
+    if (!return_type->isDoubleTy() && !(return_type->isIntegerTy() && return_type->getIntegerBitWidth() <= 64)) {
+        return PreservedAnalyses::all();
+    }
+    
+    std::vector<RecursiveReturn> recursive;
+    std::vector<ReturnInst*> base;
+    if (!findRecursiveReturns(F, recursive, base)) return PreservedAnalyses::all();
+    
+    rewriteAsLoop(F, recursive, base);
+    if (functions_rewritten) (*functions_rewritten)++;
+    return PreservedAnalyses::none();
+}
+
+bool QuillAccumulatorRecursionPass::findRecursiveReturns(Function &F, std::vector<RecursiveReturn>& recursive,
+                                                         std::vector<ReturnInst*>& base) {
+    for (BasicBlock &BB : F) {
+        auto *ret = dyn_cast<ReturnInst>(BB.getTerminator());
+        if (!ret) continue;
+        RecursiveReturn site;
+        if (matchRecursiveReturn(ret, site)) {
+            recursive.push_back(site);
+        } else {
+            base.push_back(ret);
+        }
+    }
+    if (recursive.empty() || base.empty()) return false;
+    
+    // Every self-call must be one of the sites, and they must all fold the
+    // same way so the unwind loop needs a single operation
+    int self_calls = 0;
+    for (BasicBlock &BB : F) {
+        for (Instruction &I : BB) {
+            auto *call = dyn_cast<CallBase>(&I);
+            if (call && call->getCalledFunction() == &F) self_calls++;
+        }
+    }
+    if (self_calls != (int)recursive.size()) return false;
+    
+    const RecursiveReturn &first = recursive.front();
+    unsigned call_operand = first.op->getOperand(0) == first.call ? 0 : 1;
+    for (const RecursiveReturn &site : recursive) {
+        if (site.op->getOpcode() != first.op->getOpcode() || site.op->getOperand(call_operand) != site.call) {
+            return false;
+        }
+    }
+    
+    // TailCallElim already carries these in a register; what it left has
+    // other reasons to stay recursive
+    if (first.op->isAssociative() && first.op->isCommutative()) return false;
+    return true;
+}
+
+Value* QuillAccumulatorRecursionPass::invariantOperand(Function &F, const std::vector<RecursiveReturn>& recursive) {
+    bool call_on_left = recursive.front().op->getOperand(0) == recursive.front().call;
+    Value *operand = recursive.front().op->getOperand(call_on_left ? 1 : 0);
+    for (const RecursiveReturn &site : recursive) {
+        if (site.op->getOperand(call_on_left ? 1 : 0) != operand) return nullptr;
+    }
+    if (isa<Constant>(operand)) return operand;
+    
+    auto *arg = dyn_cast<Argument>(operand);
+    if (!arg || arg->getParent() != &F) return nullptr;
+    for (const RecursiveReturn &site : recursive) {
+        if (site.call->getArgOperand(arg->getArgNo()) != arg) return nullptr;
+    }
+    return operand;
+}
+
+bool QuillAccumulatorRecursionPass::matchRecursiveReturn(ReturnInst* ret, RecursiveReturn& site) {
+    Function *F = ret->getFunction();
+    auto *op = dyn_cast_or_null<BinaryOperator>(ret->getReturnValue());
+    if (!op || op->getParent() != ret->getParent() || !op->hasOneUse()) return false;
+    
+    CallInst *call = nullptr;
+    for (Value *operand : op->operands()) {
+        auto *candidate = dyn_cast<CallInst>(operand);
+        if (!candidate || candidate->getCalledFunction() != F) continue;
+        if (call) return false;  // f(a) op f(b) is tree recursion
+        call = candidate;
+    }
+    if (!call || call->getParent() != ret->getParent() || !call->hasOneUse() ||
+        call->isMustTailCall() || call->hasOperandBundles()) {
+        return false;
+    }
+    
+    // Whatever ran after the call will run before the next level instead,
+    // so it must not touch memory, trap or have effects
+    for (Instruction *I = call->getNextNode(); I != ret; I = I->getNextNode()) {
+        if (I == op) continue;
+        if (I->mayReadOrWriteMemory() || !isSafeToSpeculativelyExecute(I)) return false;
+    }
+    
+    site = {call, op, ret};
+    return true;
+}
+
+void QuillAccumulatorRecursionPass::rewriteAsLoop(Function &F, const std::vector<RecursiveReturn>& recursive,
+                                                  const std::vector<ReturnInst*>& base) {
+    LLVMContext &ctx = F.getContext();
+    Module *M = F.getParent();
+    Type *return_type = F.getReturnType();
+    Type *int64_type = Type::getInt64Ty(ctx);
+    PointerType *words_type = PointerType::getUnqual(int64_type);
+    Value *invariant = invariantOperand(F, recursive);
+    
+    // Runtime support in runtime.c: struct quill_pending { uint64_t* data; int64_t cap; }
+    StructType *pending_type = StructType::get(ctx, {words_type, int64_type});
+    PointerType *pending_ptr_type = PointerType::getUnqual(pending_type);
+    FunctionCallee reserve;
+    FunctionCallee release;
+    if (!invariant) {
+        reserve = M->getOrInsertFunction("quill_pending_reserve",
+            FunctionType::get(Type::getVoidTy(ctx), {pending_ptr_type, int64_type}, false));
+        release = M->getOrInsertFunction("quill_pending_release",
+            FunctionType::get(Type::getVoidTy(ctx), {pending_ptr_type}, false));
+    }
+    
+    auto to_word = [&](IRBuilder<> &builder, Value *value) -> Value* {
+        if (value->getType()->isDoubleTy()) return builder.CreateBitCast(value, int64_type);
+        return builder.CreateSExtOrTrunc(value, int64_type);
+    };
+    auto from_word = [&](IRBuilder<> &builder, Value *word) -> Value* {
+        if (return_type->isDoubleTy()) return builder.CreateBitCast(word, return_type);
+        return builder.CreateSExtOrTrunc(word, return_type);
+    };
+    
+    // The old entry block becomes the loop header; static allocas move to
+    // a new entry so they are not re-executed per level
+    BasicBlock *header = &F.getEntryBlock();
+    header->setName("recurse");
+    BasicBlock *entry = BasicBlock::Create(ctx, "entry", &F, header);
+    for (auto it = header->begin(); it != header->end();) {
+        auto *alloca = dyn_cast<AllocaInst>(&*it++);
+        if (alloca && isa<ConstantInt>(alloca->getArraySize())) alloca->moveBefore(*entry, entry->end());
+    }
+    
+    IRBuilder<> builder(entry);
+    Value *pending = nullptr;
+    Value *data_field = nullptr;
+    Value *cap_field = nullptr;
+    if (!invariant) {
+        pending = builder.CreateAlloca(pending_type, nullptr, "pending");
+        data_field = builder.CreateStructGEP(pending_type, pending, 0, "pending.data");
+        cap_field = builder.CreateStructGEP(pending_type, pending, 1, "pending.cap");
+        builder.CreateStore(ConstantPointerNull::get(words_type), data_field);
+        builder.CreateStore(ConstantInt::get(int64_type, 0), cap_field);
+    }
+    builder.CreateBr(header);
+    
+    // Arguments every level passes on unchanged need no phi
+    unsigned incoming = recursive.size() + 1;
+    builder.SetInsertPoint(header, header->begin());
+    PHINode *depth = builder.CreatePHI(int64_type, incoming, "depth");
+    depth->addIncoming(ConstantInt::get(int64_type, 0), entry);
+    std::vector<PHINode*> arguments;
+    for (Argument &arg : F.args()) {
+        bool passed_on = std::all_of(recursive.begin(), recursive.end(), [&](const RecursiveReturn &site) {
+            return site.call->getArgOperand(arg.getArgNo()) == &arg;
+        });
+        if (passed_on) {
+            arguments.push_back(nullptr);
+            continue;
+        }
+        PHINode *phi = builder.CreatePHI(arg.getType(), incoming, arg.getName() + ".level");
+        arg.replaceAllUsesWith(phi);
+        phi->addIncoming(&arg, entry);
+        arguments.push_back(phi);
+    }
+    
+    // Unwind: fold the pending operands back, innermost level first
+    BasicBlock *unwind = BasicBlock::Create(ctx, "unwind", &F);
+    BasicBlock *fold = BasicBlock::Create(ctx, "unwind.fold", &F);
+    BasicBlock *done = BasicBlock::Create(ctx, "unwind.done", &F);
+    
+    builder.SetInsertPoint(unwind);
+    PHINode *acc = builder.CreatePHI(return_type, base.size() + 1, "acc");
+    PHINode *level = builder.CreatePHI(int64_type, base.size() + 1, "level");
+    builder.CreateCondBr(builder.CreateICmpEQ(level, ConstantInt::get(int64_type, 0)), done, fold);
+    
+    BinaryOperator *op = recursive.front().op;
+    bool call_on_left = op->getOperand(0) == recursive.front().call;
+    builder.SetInsertPoint(fold);
+    Value *below = builder.CreateSub(level, ConstantInt::get(int64_type, 1), "below", true, true);
+    Value *operand = invariant;
+    if (!operand) {
+        Value *data = builder.CreateLoad(words_type, data_field, "data");
+        Value *word = builder.CreateLoad(int64_type, builder.CreateInBoundsGEP(int64_type, data, below));
+        operand = from_word(builder, word);
+    }
+    auto *folded = cast<BinaryOperator>(builder.CreateBinOp(op->getOpcode(), call_on_left ? acc : operand,
+                                                            call_on_left ? operand : acc, "acc.next"));
+    folded->copyIRFlags(op);
+    for (const RecursiveReturn &site : recursive) folded->andIRFlags(site.op);
+    acc->addIncoming(folded, fold);
+    level->addIncoming(below, fold);
+    // Each fold waits for the last, so unrolling would only add code
+    MDNode *no_unroll = MDNode::get(ctx, MDString::get(ctx, "llvm.loop.unroll.disable"));
+    MDNode *loop_id = MDNode::getDistinct(ctx, {nullptr, no_unroll});
+    loop_id->replaceOperandWith(0, loop_id);
+    builder.CreateBr(unwind)->setMetadata(LLVMContext::MD_loop, loop_id);
+    
+    builder.SetInsertPoint(done);
+    if (invariant) {
+        builder.CreateRet(acc);
+    } else {
+        BasicBlock *free_pending = BasicBlock::Create(ctx, "unwind.release", &F);
+        BasicBlock *exit = BasicBlock::Create(ctx, "unwind.exit", &F);
+        Value *allocated = builder.CreateLoad(words_type, data_field, "data");
+        builder.CreateCondBr(builder.CreateIsNull(allocated), exit, free_pending);
+        builder.SetInsertPoint(free_pending);
+        builder.CreateCall(release, {pending});
+        builder.CreateBr(exit);
+        builder.SetInsertPoint(exit);
+        builder.CreateRet(acc);
+    }
+    
+    // Base cases start the unwind at the current depth
+    for (ReturnInst *ret : base) {
+        BasicBlock *block = ret->getParent();
+        acc->addIncoming(ret->getReturnValue(), block);
+        level->addIncoming(depth, block);
+        ret->eraseFromParent();
+        BranchInst::Create(unwind, block);
+    }
+    
+    // Recursive sites push their operand (unless it is invariant) and jump
+    // back to the header
+    MDNode *rarely_grows = MDBuilder(ctx).createBranchWeights(1 << 20, 1);
+    for (const RecursiveReturn &site : recursive) {
+        BasicBlock *block = site.ret->getParent();
+        Value *pushed = site.op->getOperand(call_on_left ? 1 : 0);
+        std::vector<Value*> next_arguments(site.call->arg_begin(), site.call->arg_end());
+        site.ret->eraseFromParent();
+        site.op->eraseFromParent();
+        site.call->eraseFromParent();
+        
+        BasicBlock *push = block;
+        if (!invariant) {
+            BasicBlock *grow = BasicBlock::Create(ctx, "push.grow", &F, unwind);
+            push = BasicBlock::Create(ctx, "push", &F, unwind);
+            builder.SetInsertPoint(block);
+            Value *cap = builder.CreateLoad(int64_type, cap_field, "cap");
+            builder.CreateCondBr(builder.CreateICmpSLT(depth, cap), push, grow, rarely_grows);
+            
+            builder.SetInsertPoint(grow);
+            builder.CreateCall(reserve, {pending, depth});
+            builder.CreateBr(push);
+            
+            builder.SetInsertPoint(push);
+            Value *slots = builder.CreateLoad(words_type, data_field, "data");
+            builder.CreateStore(to_word(builder, pushed), builder.CreateInBoundsGEP(int64_type, slots, depth));
+        }
+        builder.SetInsertPoint(push);
+        Value *deeper = builder.CreateAdd(depth, ConstantInt::get(int64_type, 1), "deeper", true, true);
+        builder.CreateBr(header);
+        
+        depth->addIncoming(deeper, push);
+        for (size_t i = 0; i < arguments.size(); i++) {
+            if (arguments[i]) arguments[i]->addIncoming(next_arguments[i], push);
+        }
+    }
+}
@@ -25,6 +25,8 @@ bool QuillArithmeticSimplificationPass::simplifyArithmetic(Function &F) {
         for (Instruction &I : BB) {
             if (auto *binOp = dyn_cast<BinaryOperator>(&I)) {
                 if (auto *simplified = simplifyExpression(binOp)) {
+                    int *counter = isa<Constant>(simplified) ? constants_folded : expressions_simplified;
+                    if (counter) (*counter)++;
                     binOp->replaceAllUsesWith(simplified);
                     toRemove.push_back(binOp);
                     changed = true;
@@ -45,34 +47,37 @@ Value* QuillArithmeticSimplificationPass::simplifyExpression(BinaryOperator* bin
     Value *lhs = binOp->getOperand(0);
     Value *rhs = binOp->getOperand(1);
     LLVMContext &ctx = binOp->getContext();
+    // Folds that drop a NaN, infinity or -0.0 need the matching fast-math flag
+    bool no_nans = binOp->hasNoNaNs() && binOp->hasNoInfs();
+    bool no_signed_zeros = binOp->hasNoSignedZeros();
     
     switch (binOp->getOpcode()) {
         case Instruction::FAdd:
-            // X + 0 = X
-            if (isZero(rhs)) return lhs;
-            if (isZero(lhs)) return rhs;
+            // X + -0 = X; X + 0 = X except -0 + 0 = 0
+            if (isZero(rhs) && (isNegativeZero(rhs) || no_signed_zeros)) return lhs;
+            if (isZero(lhs) && (isNegativeZero(lhs) || no_signed_zeros)) return rhs;
             
             // X + X = 2 * X (could be beneficial)
             if (lhs == rhs) {
                 // Create 2.0 * X
                 Value *two = ConstantFP::get(Type::getDoubleTy(ctx), 2.0);
-                return BinaryOperator::CreateFMul(lhs, two, "double", binOp->getIterator());
+                return BinaryOperator::CreateFMul(lhs, two, "double", binOp);
             }
             break;
             
         case Instruction::FSub:
-            // X - 0 = X
-            if (isZero(rhs)) return lhs;
+            // X - 0 = X; X - -0 = X except -0 - -0 = 0
+            if (isZero(rhs) && (!isNegativeZero(rhs) || no_signed_zeros)) return lhs;
             
-            // X - X = 0
-            if (lhs == rhs) {
+            // X - X = 0 (inf - inf and NaN - NaN are NaN)
+            if (lhs == rhs && no_nans) {
                 return ConstantFP::get(Type::getDoubleTy(ctx), 0.0);
             }
             break;
             
         case Instruction::FMul:
-            // X * 0 = 0
-            if (isZero(lhs) || isZero(rhs)) {
+            // X * 0 = 0 (inf * 0 is NaN; -X * 0 is -0)
+            if ((isZero(lhs) || isZero(rhs)) && no_nans && no_signed_zeros) {
                 return ConstantFP::get(Type::getDoubleTy(ctx), 0.0);
             }
             
@@ -83,12 +88,12 @@ Value* QuillArithmeticSimplificationPass::simplifyExpression(BinaryOperator* bin
             // X * 2 can be replaced with X + X (sometimes faster)
             if (auto *constant = dyn_cast<ConstantFP>(rhs)) {
                 if (constant->getValueAPF().convertToDouble() == 2.0) {
-                    return BinaryOperator::CreateFAdd(lhs, lhs, "double", binOp->getIterator());
+                    return BinaryOperator::CreateFAdd(lhs, lhs, "double", binOp);
                 }
             }
             if (auto *constant = dyn_cast<ConstantFP>(lhs)) {
                 if (constant->getValueAPF().convertToDouble() == 2.0) {
-                    return BinaryOperator::CreateFAdd(rhs, rhs, "double", binOp->getIterator());
+                    return BinaryOperator::CreateFAdd(rhs, rhs, "double", binOp);
                 }
             }
             break;
@@ -97,13 +102,13 @@ Value* QuillArithmeticSimplificationPass::simplifyExpression(BinaryOperator* bin
             // X / 1 = X
             if (isOne(rhs)) return lhs;
             
-            // X / X = 1 (assuming X != 0)
-            if (lhs == rhs) {
+            // X / X = 1 (0 / 0 and inf / inf are NaN)
+            if (lhs == rhs && no_nans) {
                 return ConstantFP::get(Type::getDoubleTy(ctx), 1.0);
             }
             
-            // 0 / X = 0 (assuming X != 0)
-            if (isZero(lhs)) {
+            // 0 / X = 0 (0 / 0 is NaN; 0 / -X is -0)
+            if (isZero(lhs) && no_nans && no_signed_zeros) {
                 return ConstantFP::get(Type::getDoubleTy(ctx), 0.0);
             }
             break;
@@ -122,6 +127,11 @@ bool QuillArithmeticSimplificationPass::isZero(Value* val) {
     return false;
 }
 
+bool QuillArithmeticSimplificationPass::isNegativeZero(Value* val) {
+    auto *constant = dyn_cast<ConstantFP>(val);
+    return constant && constant->isNegativeZeroValue();
+}
+
 bool QuillArithmeticSimplificationPass::isOne(Value* val) {
     if (auto *constant = dyn_cast<ConstantFP>(val)) {
         return constant->getValueAPF().convertToDouble() == 1.0;
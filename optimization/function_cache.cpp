@@ -0,0 +1,265 @@
+#include "../include/optimization_passes.h"
+#include "../include/compile_cache.h"
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Linker/IRMover.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <algorithm>
+
+using namespace llvm;
+using namespace quill;
+
+namespace {
+
+// Globals F refers to, in first-use order
+std::vector<GlobalValue*> collectReferences(Function& F) {
+    std::vector<GlobalValue*> references;
+    SmallPtrSet<Constant*, 32> visited;
+    std::vector<Constant*> worklist;
+    for (BasicBlock &BB : F) {
+        for (Instruction &I : BB) {
+            for (Value *operand : I.operands()) {
+                auto *constant = dyn_cast<Constant>(operand);
+                if (constant && visited.insert(constant).second) worklist.push_back(constant);
+                
+                // Globals can hide inside constant expressions
+                while (!worklist.empty()) {
+                    Constant *C = worklist.back();
+                    worklist.pop_back();
+                    if (auto *GV = dyn_cast<GlobalValue>(C)) {
+                        if (GV != &F) references.push_back(GV);
+                        continue;
+                    }
+                    for (Value *nested : C->operands()) {
+                        auto *nested_constant = dyn_cast<Constant>(nested);
+                        if (nested_constant && visited.insert(nested_constant).second) {
+                            worklist.push_back(nested_constant);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return references;
+}
+
+// Locally linked names are positional, so renumbered string constants and
+// renamed internal callees leave keys unchanged
+std::string referenceName(GlobalValue* GV, size_t index) {
+    return GV->hasLocalLinkage() ? "quill.ref." + std::to_string(index) : GV->getName().str();
+}
+
+std::string functionName(Function& F) {
+    return F.hasLocalLinkage() ? "quill.function" : F.getName().str();
+}
+
+// F alone in a module, with declarations for what it refers to. Null when
+// F refers to something that has no stable name in `references`.
+std::unique_ptr<Module> extractFunction(Function& F, const std::vector<GlobalValue*>& references) {
+    auto extracted = std::make_unique<Module>("quill.function", F.getContext());
+    extracted->setDataLayout(F.getParent()->getDataLayout());
+    extracted->setTargetTriple(F.getParent()->getTargetTriple());
+    
+    ValueToValueMapTy VMap;
+    for (GlobalValue *GV : collectReferences(F)) {
+        auto position = std::find(references.begin(), references.end(), GV);
+        if (position == references.end() && GV->hasLocalLinkage()) return nullptr;
+        std::string name = referenceName(GV, position - references.begin());
+        
+        if (auto *callee = dyn_cast<Function>(GV)) {
+            Function *declaration = Function::Create(callee->getFunctionType(), GlobalValue::ExternalLinkage,
+                                                     name, extracted.get());
+            declaration->copyAttributesFrom(callee);
+            VMap[GV] = declaration;
+        } else if (auto *variable = dyn_cast<GlobalVariable>(GV)) {
+            auto *declaration = new GlobalVariable(*extracted, variable->getValueType(), variable->isConstant(),
+                                                   GlobalValue::ExternalLinkage, nullptr, name);
+            declaration->copyAttributesFrom(variable);
+            VMap[GV] = declaration;
+        } else {
+            return nullptr;
+        }
+    }
+    
+    Function *clone = Function::Create(F.getFunctionType(), F.getLinkage(), functionName(F), extracted.get());
+    VMap[&F] = clone;
+    auto clone_arg = clone->arg_begin();
+    for (Argument &arg : F.args()) {
+        clone_arg->setName(arg.getName());
+        VMap[&arg] = &*clone_arg++;
+    }
+    SmallVector<ReturnInst*, 8> returns;
+    CloneFunctionInto(clone, &F, VMap, CloneFunctionChangeType::GlobalChanges, returns);
+    return extracted;
+}
+
+// Without the symbol table WriteBitcodeToFile adds; nothing links against
+// these modules
+std::string writeModule(Module& M) {
+    SmallVector<char, 0> buffer;
+    BitcodeWriter writer(buffer);
+    writer.writeModule(M);
+    writer.writeStrtab();
+    return std::string(buffer.begin(), buffer.end());
+}
+
+} // namespace
+
+void QuillOptimizationManager::setFunctionCache(CompileCache* cache, const std::string& compiler_identity) {
+    function_cache = cache;
+    function_cache_salt = compiler_identity;
+}
+
+void QuillOptimizationManager::optimizeFunction(Function& F, FunctionAnalysisManager& FAM, IRMover& mover) {
+    // Instrumented builds are rare and their counters are lowered later
+    if (!function_cache || opt_level == O0 || stats.profile_instrumented) {
+        runFunctionPipeline(F, FAM);
+        return;
+    }
+    
+    std::vector<GlobalValue*> references = collectReferences(F);
+    std::string key = functionCacheKey(F, references);
+    std::string artifact;
+    if (!key.empty() && function_cache->lookup(key, artifact) && restoreFunction(F, references, artifact, mover)) {
+        FAM.invalidate(F, PreservedAnalyses::none());
+        stats.functions_reused++;
+        return;
+    }
+    
+    runFunctionPipeline(F, FAM);
+    stats.functions_optimized++;
+    if (!key.empty()) storeFunction(F, references, key);
+}
+
+std::string QuillOptimizationManager::functionCacheKey(Function& F, const std::vector<GlobalValue*>& references) {
+    // Inlining happened at module level, so callees that were inlined are
+    // part of this IR; the declarations carry the other callees' signatures
+    std::unique_ptr<Module> extracted = extractFunction(F, references);
+    if (!extracted) return "";
+    
+    // Text rather than bitcode: bitcode also lists every metadata kind the
+    // context has seen, which grows as other functions are optimized
+    std::string material;
+    raw_string_ostream os(material);
+    extracted->print(os, nullptr);
+    // Loads from constant globals fold, so their contents count too
+    for (size_t i = 0; i < references.size(); i++) {
+        auto *variable = dyn_cast<GlobalVariable>(references[i]);
+        if (variable && variable->isConstant() && variable->hasDefinitiveInitializer()) {
+            os << referenceName(variable, i) << " = ";
+            variable->getInitializer()->print(os);
+            os << "\n";
+        }
+    }
+    os.flush();
+    
+    CompileCache::KeyBuilder key;
+    key.add("compiler", function_cache_salt);
+    key.add("pipeline", "O" + std::to_string(opt_level) + (type_directed_pass && type_info ? "+types" : ""));
+    key.add("function", material);
+    return key.finish();
+}
+
+bool QuillOptimizationManager::restoreFunction(Function& F, const std::vector<GlobalValue*>& references,
+                                               const std::string& artifact, IRMover& mover) {
+    Module &module = *F.getParent();
+    Expected<std::unique_ptr<Module>> parsed = parseBitcodeFile(MemoryBufferRef(artifact, "cached function"),
+                                                                F.getContext());
+    if (!parsed) {
+        consumeError(parsed.takeError());
+        return false;
+    }
+    std::unique_ptr<Module> cached = std::move(*parsed);
+    Function *body = cached->getFunction(functionName(F));
+    if (!body || body->isDeclaration()) return false;
+    
+    // Parsing recreated the named struct types under new names; the mover
+    // maps them back onto the module's and links the declarations
+    body->setName("quill.restored");
+    body->setLinkage(GlobalValue::ExternalLinkage);
+    if (Error error = mover.move(std::move(cached), {body}, [](GlobalValue&, IRMover::ValueAdder) {},
+                                 /*IsPerformingImport=*/false)) {
+        consumeError(std::move(error));
+        return false;
+    }
+    Function *restored = module.getFunction("quill.restored");
+    
+    // Locally linked references came over as positional declarations
+    std::vector<std::pair<GlobalValue*, GlobalValue*>> placeholders;
+    bool matches = restored && restored->getFunctionType() == F.getFunctionType();
+    for (size_t i = 0; i < references.size(); i++) {
+        if (!references[i]->hasLocalLinkage()) continue;
+        GlobalValue *placeholder = module.getNamedValue(referenceName(references[i], i));
+        if (!placeholder) continue;  // optimized away
+        matches &= placeholder->getType() == references[i]->getType();
+        placeholders.push_back({placeholder, references[i]});
+    }
+    if (!matches) {
+        if (restored) restored->eraseFromParent();
+        for (auto &placeholder : placeholders) {
+            if (placeholder.first->use_empty()) placeholder.first->eraseFromParent();
+        }
+        return false;
+    }
+    
+    for (auto &placeholder : placeholders) {
+        placeholder.first->replaceAllUsesWith(placeholder.second);
+        placeholder.first->eraseFromParent();
+    }
+    
+    // deleteBody would also make F external
+    F.dropAllReferences();
+    F.clearMetadata();
+#if LLVM_VERSION_MAJOR >= 16
+    F.splice(F.end(), restored);
+#else
+    F.getBasicBlockList().splice(F.end(), restored->getBasicBlockList());
+#endif
+    for (unsigned i = 0; i < F.arg_size(); i++) {
+        restored->getArg(i)->replaceAllUsesWith(F.getArg(i));
+    }
+    F.setAttributes(restored->getAttributes());
+    SmallVector<std::pair<unsigned, MDNode*>, 4> metadata;
+    restored->getAllMetadata(metadata);
+    for (auto &attachment : metadata) {
+        F.setMetadata(attachment.first, attachment.second);
+    }
+    restored->replaceAllUsesWith(&F);
+    restored->eraseFromParent();
+    sortUseLists(F);
+    return true;
+}
+
+void QuillOptimizationManager::storeFunction(Function& F, const std::vector<GlobalValue*>& references,
+                                             const std::string& key) {
+    std::unique_ptr<Module> extracted = extractFunction(F, references);
+    if (!extracted) return;
+    
+    function_cache->store(key, writeModule(*extracted));
+}
+
+void QuillOptimizationManager::sortUseLists(Function& F) {
+    DenseMap<const User*, unsigned> position;
+    unsigned next = 0;
+    for (BasicBlock &BB : F) {
+        for (Instruction &I : BB) position[&I] = next++;
+    }
+    // Users outside the body (block addresses) sort last
+    auto before = [&](const Use &a, const Use &b) {
+        auto found_a = position.find(a.getUser());
+        auto found_b = position.find(b.getUser());
+        unsigned user_a = found_a == position.end() ? ~0u : found_a->second;
+        unsigned user_b = found_b == position.end() ? ~0u : found_b->second;
+        if (user_a != user_b) return user_a < user_b;
+        return a.getOperandNo() < b.getOperandNo();
+    };
+    for (Argument &arg : F.args()) arg.sortUseList(before);
+    for (BasicBlock &BB : F) {
+        BB.sortUseList(before);
+        for (Instruction &I : BB) I.sortUseList(before);
+    }
+}
@@ -2,6 +2,8 @@
 #include <llvm/Transforms/Utils/Cloning.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/Analysis/InlineCost.h>
+#include <llvm/Analysis/BlockFrequencyInfo.h>
+#include <llvm/Analysis/ProfileSummaryInfo.h>
 #include <cmath>
 
 using namespace llvm;
@@ -10,7 +12,7 @@ using namespace quill;
 PreservedAnalyses QuillFunctionInliningPass::run(Module &M, ModuleAnalysisManager &AM) {
     bool changed = false;
     
-    changed |= inlineSmallFunctions(M);
+    changed |= inlineSmallFunctions(M, AM);
     
     if (changed) {
         return PreservedAnalyses::none();
@@ -19,19 +21,35 @@ PreservedAnalyses QuillFunctionInliningPass::run(Module &M, ModuleAnalysisManage
     return PreservedAnalyses::all();
 }
 
-bool QuillFunctionInliningPass::inlineSmallFunctions(Module &M) {
+bool QuillFunctionInliningPass::inlineSmallFunctions(Module &M, ModuleAnalysisManager &AM) {
     bool changed = false;
     std::vector<CallInst*> callsToInline;
     
+    // Call-site hotness is only known when a profile was loaded
+    ProfileSummaryInfo *PSI = &AM.getResult<ProfileSummaryAnalysis>(M);
+    FunctionAnalysisManager &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+    bool profiled = PSI->hasProfileSummary();
+    
     // Find calls to small functions
     for (Function &caller : M) {
         if (caller.isDeclaration()) continue;
         
+        BlockFrequencyInfo *BFI = nullptr;
+        if (profiled) {
+            BFI = &FAM.getResult<BlockFrequencyAnalysis>(caller);
+        }
+        
         for (BasicBlock &BB : caller) {
             for (Instruction &I : BB) {
                 if (auto *call = dyn_cast<CallInst>(&I)) {
                     Function *callee = call->getCalledFunction();
-                    if (callee && shouldInlineFunction(callee)) {
+                    bool hot = false;
+                    if (profiled) {
+                        // Code the training run never reached is not worth growing
+                        if (PSI->isColdCallSite(*call, BFI)) continue;
+                        hot = PSI->isHotCallSite(*call, BFI);
+                    }
+                    if (callee && shouldInlineFunction(callee, hot)) {
                         callsToInline.push_back(call);
                     }
                 }
@@ -69,13 +87,14 @@ bool QuillFunctionInliningPass::inlineSmallFunctions(Module &M) {
         
         if (inlineSuccess) {
             changed = true;
+            calls_inlined++;
         }
     }
     
     return changed;
 }
 
-bool QuillFunctionInliningPass::shouldInlineFunction(Function* func) {
+bool QuillFunctionInliningPass::shouldInlineFunction(Function* func, bool hot_call_site) {
     if (!func || func->isDeclaration()) {
         return false;
     }
@@ -86,13 +105,14 @@ bool QuillFunctionInliningPass::shouldInlineFunction(Function* func) {
     }
     
     // Don't inline functions with complex control flow
-    if (func->size() > 3) { // More than 3 basic blocks
+    size_t max_blocks = hot_call_site ? HOT_INLINE_MAX_BLOCKS : 3;
+    if (func->size() > max_blocks) {
         return false;
     }
     
     // Check instruction count
     int instCount = calculateInstructionCount(func);
-    return instCount <= INLINE_THRESHOLD;
+    return instCount <= (hot_call_site ? HOT_INLINE_THRESHOLD : INLINE_THRESHOLD);
 }
 
 int QuillFunctionInliningPass::calculateInstructionCount(Function* func) {
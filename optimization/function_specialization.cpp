@@ -0,0 +1,231 @@
+#include "../include/optimization_passes.h"
+#include <llvm/Analysis/ConstantFolding.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/Local.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+#include <algorithm>
+#include <map>
+
+using namespace llvm;
+using namespace quill;
+
+PreservedAnalyses QuillFunctionSpecializationPass::run(Module &M, ModuleAnalysisManager &AM) {
+    if (specializeCallSites(M)) {
+        return PreservedAnalyses::none();
+    }
+    
+    return PreservedAnalyses::all();
+}
+
+bool QuillFunctionSpecializationPass::specializeCallSites(Module &M) {
+    // Budget is a fraction of the module as it was before any cloning
+    int module_size = 0;
+    for (Function &F : M) {
+        if (!F.isDeclaration()) module_size += calculateInstructionCount(&F);
+    }
+    int budget = module_size * GROWTH_PERCENT / 100;
+    stats.growth_budget = budget > MIN_GROWTH_BUDGET ? budget : MIN_GROWTH_BUDGET;
+    
+    std::vector<CallInst*> candidates;
+    for (Function &caller : M) {
+        if (caller.isDeclaration()) continue;
+        
+        for (BasicBlock &BB : caller) {
+            for (Instruction &I : BB) {
+                auto *call = dyn_cast<CallInst>(&I);
+                if (!call) continue;
+                
+                Function *callee = call->getCalledFunction();
+                if (!callee || !canSpecialize(callee)) continue;
+                
+                bool has_constant_arg = false;
+                for (Value *arg : call->args()) {
+                    has_constant_arg |= isa<ConstantFP>(arg) || isa<ConstantInt>(arg);
+                }
+                if (has_constant_arg) candidates.push_back(call);
+            }
+        }
+    }
+    
+    // Call sites passing the same constants share one clone; nullptr marks
+    // a specialization that was tried and rejected
+    std::map<std::pair<Function*, std::vector<Constant*>>, Function*> specializations;
+    bool changed = false;
+    
+    for (CallInst *call : candidates) {
+        Function *callee = call->getCalledFunction();
+        
+        std::vector<Constant*> key;
+        for (Value *arg : call->args()) {
+            key.push_back(isa<ConstantFP>(arg) || isa<ConstantInt>(arg) ? cast<Constant>(arg) : nullptr);
+        }
+        
+        auto found = specializations.find({callee, key});
+        Function *clone;
+        if (found != specializations.end()) {
+            clone = found->second;
+        } else {
+            clone = createSpecialization(callee, key);
+            specializations[{callee, key}] = clone;
+        }
+        if (!clone) continue;
+        
+        // Forward only the arguments the clone still takes
+        std::vector<Value*> remaining_args;
+        for (unsigned i = 0; i < call->arg_size(); ++i) {
+            if (!key[i]) remaining_args.push_back(call->getArgOperand(i));
+        }
+        
+        CallInst *specialized_call = CallInst::Create(clone, remaining_args, "", call);
+        specialized_call->takeName(call);
+        specialized_call->setTailCallKind(call->getTailCallKind());
+        call->replaceAllUsesWith(specialized_call);
+        call->eraseFromParent();
+        
+        stats.call_sites_specialized++;
+        changed = true;
+    }
+    
+    return changed;
+}
+
+Function* QuillFunctionSpecializationPass::createSpecialization(Function* callee,
+                                                                const std::vector<Constant*>& constants) {
+    std::vector<Type*> param_types;
+    for (Argument &arg : callee->args()) {
+        if (!constants[arg.getArgNo()]) param_types.push_back(arg.getType());
+    }
+    
+    FunctionType *clone_type = FunctionType::get(callee->getReturnType(), param_types, false);
+    Function *clone = Function::Create(clone_type, GlobalValue::InternalLinkage,
+                                       callee->getName() + ".spec", callee->getParent());
+    
+    ValueToValueMapTy vmap;
+    auto clone_arg = clone->arg_begin();
+    for (Argument &arg : callee->args()) {
+        if (Constant *constant = constants[arg.getArgNo()]) {
+            vmap[&arg] = constant;
+        } else {
+            clone_arg->setName(arg.getName());
+            vmap[&arg] = &*clone_arg++;
+        }
+    }
+    
+    SmallVector<ReturnInst*, 8> returns;
+    CloneFunctionInto(clone, callee, vmap, CloneFunctionChangeType::LocalChangesOnly, returns);
+    
+    propagateArgumentConstants(clone);
+    int folded = simplifySpecialization(clone);
+    
+    // Keep the clone only if the constants actually removed code, and only
+    // while the module stays within its growth budget
+    int clone_size = calculateInstructionCount(clone);
+    if (clone_size >= calculateInstructionCount(callee) ||
+        stats.instructions_added + clone_size > stats.growth_budget) {
+        clone->eraseFromParent();
+        return nullptr;
+    }
+    
+    stats.functions_specialized++;
+    stats.instructions_added += clone_size;
+    stats.constants_folded += folded;
+    return clone;
+}
+
+void QuillFunctionSpecializationPass::propagateArgumentConstants(Function* clone) {
+    // Codegen spills every parameter to an entry-block alloca. When that
+    // spill is the only store, each load of the slot is the constant.
+    BasicBlock &entry = clone->getEntryBlock();
+    std::vector<AllocaInst*> slots;
+    for (Instruction &I : entry) {
+        if (auto *alloca = dyn_cast<AllocaInst>(&I)) slots.push_back(alloca);
+    }
+    
+    for (AllocaInst *alloca : slots) {
+        StoreInst *spill = nullptr;
+        std::vector<LoadInst*> loads;
+        bool promotable = true;
+        
+        for (User *user : alloca->users()) {
+            if (auto *store = dyn_cast<StoreInst>(user)) {
+                if (spill || store->getPointerOperand() != alloca || store->getParent() != &entry) {
+                    promotable = false;
+                    break;
+                }
+                spill = store;
+            } else if (auto *load = dyn_cast<LoadInst>(user)) {
+                loads.push_back(load);
+            } else {
+                promotable = false;
+                break;
+            }
+        }
+        
+        if (!promotable || !spill || !isa<Constant>(spill->getValueOperand())) continue;
+        
+        Constant *value = cast<Constant>(spill->getValueOperand());
+        bool all_after_spill = std::all_of(loads.begin(), loads.end(), [&](LoadInst *load) {
+            return load->getParent() != &entry || spill->comesBefore(load);
+        });
+        if (!all_after_spill) continue;
+        
+        for (LoadInst *load : loads) {
+            if (load->getType() != value->getType()) continue;
+            load->replaceAllUsesWith(value);
+            load->eraseFromParent();
+        }
+        if (alloca->hasOneUse()) {
+            spill->eraseFromParent();
+            alloca->eraseFromParent();
+        }
+    }
+}
+
+int QuillFunctionSpecializationPass::simplifySpecialization(Function* clone) {
+    const DataLayout &DL = clone->getParent()->getDataLayout();
+    
+    int folded_count = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        
+        for (BasicBlock &BB : *clone) {
+            for (Instruction &I : make_early_inc_range(BB)) {
+                if (Constant *folded = ConstantFoldInstruction(&I, DL)) {
+                    I.replaceAllUsesWith(folded);
+                    I.eraseFromParent();
+                    folded_count++;
+                    changed = true;
+                }
+            }
+        }
+        
+        // Branches on folded conditions become unconditional; SimplifyCFG
+        // cleans up whatever is left once the dead arms are gone
+        for (BasicBlock &BB : *clone) {
+            changed |= ConstantFoldTerminator(&BB, true);
+        }
+        changed |= removeUnreachableBlocks(*clone);
+    }
+    return folded_count;
+}
+
+bool QuillFunctionSpecializationPass::canSpecialize(Function* func) {
+    if (!func || func->isDeclaration() || func->isVarArg() || func->arg_size() == 0) {
+        return false;
+    }
+    
+    // Never clone the entry point or something that is already a clone
+    if (func->getName() == "main" || func->hasLocalLinkage()) return false;
+    
+    return calculateInstructionCount(func) <= MAX_FUNCTION_SIZE;
+}
+
+int QuillFunctionSpecializationPass::calculateInstructionCount(Function* func) {
+    int count = 0;
+    for (BasicBlock &BB : *func) {
+        count += BB.size();
+    }
+    return count;
+}
@@ -0,0 +1,217 @@
+#include "../include/optimization_passes.h"
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+
+using namespace llvm;
+using namespace quill;
+
+PreservedAnalyses QuillMemoizationPass::run(Module &M, ModuleAnalysisManager &AM) {
+    std::set<Function*> pure = findPureFunctions(M);
+    std::set<Function*> parallel = findParallelCallees(M);
+    
+    // Module order rather than the sets' pointer order, so output does not
+    // depend on where functions were allocated
+    std::vector<Function*> to_memoize;
+    for (Function &F : M) {
+        if (pure.count(&F) && !parallel.count(&F) && shouldMemoize(&F)) to_memoize.push_back(&F);
+    }
+    
+    for (Function *func : to_memoize) {
+        memoizeFunction(func);
+        functions_memoized++;
+    }
+    
+    return to_memoize.empty() ? PreservedAnalyses::all() : PreservedAnalyses::none();
+}
+
+std::set<Function*> QuillMemoizationPass::findPureFunctions(Module &M) {
+    std::set<Function*> pure;
+    for (Function &F : M) {
+        if (!F.isDeclaration() && F.getName() != "main" && hasNumericSignature(&F)) {
+            pure.insert(&F);
+        }
+    }
+    
+    // Optimistically assume every candidate is pure, then drop functions
+    // whose bodies depend on something impure until nothing changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = pure.begin(); it != pure.end();) {
+            if (!isPureBody(*it, pure)) {
+                it = pure.erase(it);
+                changed = true;
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+    return pure;
+}
+
+std::set<Function*> QuillMemoizationPass::findParallelCallees(Module &M) {
+    std::set<Function*> reachable;
+    std::vector<Function*> worklist;
+    
+    // Outlined bodies are the second argument of quill_parallel_for
+    if (Function *parallel_for = M.getFunction("quill_parallel_for")) {
+        for (User *user : parallel_for->users()) {
+            auto *call = dyn_cast<CallInst>(user);
+            if (!call || call->getCalledFunction() != parallel_for) continue;
+            if (auto *body = dyn_cast<Function>(call->getArgOperand(1)->stripPointerCasts())) {
+                if (reachable.insert(body).second) worklist.push_back(body);
+            }
+        }
+    }
+    
+    while (!worklist.empty()) {
+        Function *func = worklist.back();
+        worklist.pop_back();
+        for (BasicBlock &BB : *func) {
+            for (Instruction &I : BB) {
+                auto *call = dyn_cast<CallInst>(&I);
+                Function *callee = call ? call->getCalledFunction() : nullptr;
+                if (callee && !callee->isDeclaration() && reachable.insert(callee).second) {
+                    worklist.push_back(callee);
+                }
+            }
+        }
+    }
+    
+    return reachable;
+}
+
+bool QuillMemoizationPass::isPureBody(Function* func, const std::set<Function*>& pure) {
+    for (BasicBlock &BB : *func) {
+        for (Instruction &I : BB) {
+            if (auto *call = dyn_cast<CallInst>(&I)) {
+                Function *callee = call->getCalledFunction();
+                if (!callee) return false;
+                if (pure.count(callee)) continue;
+                
+                // Math intrinsics such as llvm.sqrt neither read nor write memory
+                if (callee->isIntrinsic() && callee->doesNotAccessMemory()) continue;
+                // Profile counters are not program state
+                if (callee->getIntrinsicID() == Intrinsic::instrprof_increment ||
+                    callee->getIntrinsicID() == Intrinsic::instrprof_increment_step) continue;
+                return false;
+            }
+            
+            // Locals live in entry-block allocas; anything else is shared state
+            if (auto *store = dyn_cast<StoreInst>(&I)) {
+                if (store->isVolatile() || !isa<AllocaInst>(store->getPointerOperand()->stripPointerCasts())) {
+                    return false;
+                }
+                continue;
+            }
+            if (auto *load = dyn_cast<LoadInst>(&I)) {
+                Value *ptr = load->getPointerOperand()->stripPointerCasts();
+                auto *global = dyn_cast<GlobalVariable>(ptr);
+                if (load->isVolatile() || !(isa<AllocaInst>(ptr) || (global && global->isConstant()))) {
+                    return false;
+                }
+                continue;
+            }
+            
+            if (I.mayHaveSideEffects() || I.mayReadOrWriteMemory()) return false;
+        }
+    }
+    return true;
+}
+
+bool QuillMemoizationPass::shouldMemoize(Function* func) {
+    if (func->arg_size() == 0 || func->arg_size() > MAX_MEMO_ARITY) return false;
+    
+    // Only tree recursion repeats work; a single self-call is a chain the
+    // cache could never hit within one top-level call
+    int self_calls = 0;
+    for (BasicBlock &BB : *func) {
+        for (Instruction &I : BB) {
+            if (auto *call = dyn_cast<CallInst>(&I)) {
+                if (call->getCalledFunction() == func) self_calls++;
+            }
+        }
+    }
+    return self_calls >= 2;
+}
+
+void QuillMemoizationPass::memoizeFunction(Function* func) {
+    Module *M = func->getParent();
+    LLVMContext &ctx = M->getContext();
+    
+    // The original body moves to an internal copy; its recursive calls keep
+    // targeting the wrapper, so every level of the recursion hits the cache
+    Function *impl = Function::Create(func->getFunctionType(), GlobalValue::InternalLinkage,
+                                      func->getName() + ".uncached", M);
+    ValueToValueMapTy vmap;
+    auto impl_arg = impl->arg_begin();
+    for (Argument &arg : func->args()) {
+        impl_arg->setName(arg.getName());
+        vmap[&arg] = &*impl_arg++;
+    }
+    SmallVector<ReturnInst*, 8> returns;
+    CloneFunctionInto(impl, func, vmap, CloneFunctionChangeType::LocalChangesOnly, returns);
+    func->deleteBody();
+    
+    Type *int32_type = Type::getInt32Ty(ctx);
+    Type *int64_type = Type::getInt64Ty(ctx);
+    PointerType *handle_type = PointerType::getUnqual(Type::getInt8Ty(ctx));
+    PointerType *handle_ptr_type = PointerType::getUnqual(handle_type);
+    PointerType *int64_ptr_type = PointerType::getUnqual(int64_type);
+    
+    auto *table = new GlobalVariable(*M, handle_type, false, GlobalValue::InternalLinkage,
+                                     ConstantPointerNull::get(handle_type), func->getName() + ".memo");
+    
+    // Runtime support in runtime.c
+    FunctionCallee lookup = M->getOrInsertFunction("quill_memo_lookup",
+        FunctionType::get(int32_type, {handle_ptr_type, int64_ptr_type, int32_type, int64_ptr_type}, false));
+    FunctionCallee store = M->getOrInsertFunction("quill_memo_store",
+        FunctionType::get(Type::getVoidTy(ctx), {handle_ptr_type, int64_ptr_type, int32_type, int64_type}, false));
+    
+    BasicBlock *entry = BasicBlock::Create(ctx, "entry", func);
+    BasicBlock *hit = BasicBlock::Create(ctx, "memo_hit", func);
+    BasicBlock *miss = BasicBlock::Create(ctx, "memo_miss", func);
+    
+    IRBuilder<> builder(entry);
+    Value *arity = ConstantInt::get(int32_type, func->arg_size());
+    Value *key = builder.CreateAlloca(int64_type, arity, "memo_key");
+    Value *cached = builder.CreateAlloca(int64_type, nullptr, "memo_value");
+    
+    std::vector<Value*> args;
+    for (Argument &arg : func->args()) {
+        Value *bits = arg.getType()->isDoubleTy() ? builder.CreateBitCast(&arg, int64_type) : &arg;
+        builder.CreateStore(bits, builder.CreateConstGEP1_32(int64_type, key, arg.getArgNo()));
+        args.push_back(&arg);
+    }
+    
+    Value *found = builder.CreateCall(lookup, {table, key, arity, cached}, "memo_found");
+    builder.CreateCondBr(builder.CreateICmpNE(found, ConstantInt::get(int32_type, 0)), hit, miss);
+    
+    Type *return_type = func->getReturnType();
+    builder.SetInsertPoint(hit);
+    Value *cached_bits = builder.CreateLoad(int64_type, cached);
+    builder.CreateRet(return_type->isDoubleTy() ? builder.CreateBitCast(cached_bits, return_type) : cached_bits);
+    
+    builder.SetInsertPoint(miss);
+    Value *result = builder.CreateCall(impl, args, "memo_result");
+    Value *result_bits = return_type->isDoubleTy() ? builder.CreateBitCast(result, int64_type) : result;
+    builder.CreateCall(store, {table, key, arity, result_bits});
+    builder.CreateRet(result);
+}
+
+bool QuillMemoizationPass::hasNumericSignature(Function* func) {
+    if (func->isVarArg()) return false;
+    
+    auto is_numeric = [](Type *type) {
+        return type->isDoubleTy() || type->isIntegerTy(64);
+    };
+    if (!is_numeric(func->getReturnType())) return false;
+    for (Argument &arg : func->args()) {
+        if (!is_numeric(arg.getType())) return false;
+    }
+    return true;
+}
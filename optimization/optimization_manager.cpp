@@ -1,23 +1,218 @@
 #include "../include/optimization_passes.h"
+#include "../include/json_writer.h"
 #include <llvm/Transforms/Scalar.h>
 #include <llvm/Transforms/InstCombine/InstCombine.h>
 #include <llvm/Transforms/Utils.h>
 #include <llvm/Analysis/TargetTransformInfo.h>
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Transforms/Scalar/SimplifyCFG.h>
+#include <llvm/Transforms/Scalar/ADCE.h>
+#include <llvm/Transforms/Scalar/TailRecursionElimination.h>
 #include <llvm/Transforms/Scalar/Reassociate.h>
 #include <llvm/Transforms/Scalar/GVN.h>
 #include <llvm/Transforms/Scalar/NewGVN.h>
+#include <llvm/Transforms/Scalar/IndVarSimplify.h>
+#include <llvm/Transforms/Scalar/LoopPassManager.h>
+#include <llvm/Transforms/Scalar/LoopUnrollPass.h>
+#include <llvm/Transforms/Utils/LoopSimplify.h>
+#include <llvm/Transforms/Utils/Mem2Reg.h>
+#include <llvm/Transforms/Scalar/LoopRotation.h>
+#include <llvm/Transforms/Vectorize/LoopVectorize.h>
+#include <llvm/Transforms/Vectorize/SLPVectorizer.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/DiagnosticHandler.h>
+#include <llvm/Linker/IRMover.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#if LLVM_VERSION_MAJOR >= 17
+#include <llvm/TargetParser/Host.h>
+#else
+#include <llvm/Support/Host.h>
+#endif
 #include <llvm/Analysis/CGSCCPassManager.h>
 #include <llvm/Analysis/LoopAnalysisManager.h>
+#include <algorithm>
 #include <chrono>
 #include <iostream>
+#include <map>
 
 using namespace llvm;
 using namespace quill;
 
+namespace {
+
+// Collects the vectorizers' optimization remarks for the report
+struct VectorizationRemarkHandler : public DiagnosticHandler {
+    QuillOptimizationManager::OptimizationStats& stats;
+    
+    explicit VectorizationRemarkHandler(QuillOptimizationManager::OptimizationStats& stats) : stats(stats) {}
+    
+    static bool isVectorizer(StringRef pass_name) {
+        return pass_name == "loop-vectorize" || pass_name == "slp-vectorizer";
+    }
+    
+    bool isPassedOptRemarkEnabled(StringRef pass_name) const override { return isVectorizer(pass_name); }
+    // Missed remarks only repeat what the analysis remarks explain
+    bool isMissedOptRemarkEnabled(StringRef) const override { return false; }
+    // Analysis remarks carry the reason a loop stayed scalar
+    bool isAnalysisRemarkEnabled(StringRef pass_name) const override { return pass_name == "loop-vectorize"; }
+    bool isAnyRemarkEnabled() const override { return true; }
+    
+    bool handleDiagnostics(const DiagnosticInfo& info) override {
+        auto *remark = dyn_cast<DiagnosticInfoOptimizationBase>(&info);
+        if (!remark) return false;
+        
+        // The context hands over every remark; keep the ones enabled above
+        StringRef pass_name = remark->getPassName();
+        if (!remark->isEnabled()) return true;
+        
+        if (remark->getKind() == DK_OptimizationRemark) {
+            if (pass_name == "slp-vectorizer") {
+                stats.slp_trees_vectorized++;
+            } else if (remark->getRemarkName() == "Vectorized") {
+                stats.loops_vectorized++;
+            }
+        }
+        
+        std::string function_name = "<module>";
+        if (auto *located = dyn_cast<DiagnosticInfoIROptimization>(remark)) {
+            function_name = located->getFunction().getName().str();
+        }
+        std::string line = function_name + ": " + remark->getMsg();
+        if (std::find(stats.vectorization_remarks.begin(), stats.vectorization_remarks.end(), line) ==
+            stats.vectorization_remarks.end()) {
+            stats.vectorization_remarks.push_back(line);
+        }
+        return true;
+    }
+};
+
+// The host target, CPU and feature string are the same for every manager
+// in the process; detecting them once also lets a compile server do it
+// before it starts forking
+struct HostTarget {
+    const Target *target = nullptr;
+    std::string triple;
+    std::string cpu;
+    std::string features;
+};
+
+const HostTarget& hostTarget() {
+    static const HostTarget host = [] {
+        HostTarget host;
+        InitializeNativeTarget();
+        host.triple = sys::getDefaultTargetTriple();
+        std::string error;
+        host.target = TargetRegistry::lookupTarget(host.triple, error);
+        host.cpu = sys::getHostCPUName().str();
+
+#if LLVM_VERSION_MAJOR >= 19
+        StringMap<bool> host_features = sys::getHostCPUFeatures();
+#else
+        StringMap<bool> host_features;
+        sys::getHostCPUFeatures(host_features);
+#endif
+        for (const auto &feature : host_features) {
+            if (!host.features.empty()) host.features += ",";
+            host.features += (feature.second ? "+" : "-") + feature.first().str();
+        }
+        return host;
+    }();
+    return host;
+}
+
+// Runs a pass the manager calls directly, outside any pass manager, with
+// the instrumentation a pass manager would give it. True if it changed IR.
+template <typename PassT, typename IRUnitT, typename AnalysisManagerT>
+bool runInstrumented(PassT& pass, IRUnitT& IR, AnalysisManagerT& AM) {
+    PassInstrumentation PI = AM.template getResult<PassInstrumentationAnalysis>(IR);
+    if (!PI.runBeforePass(pass, IR)) return false;
+    PreservedAnalyses PA;
+    {
+#if LLVM_VERSION_MAJOR < 17
+        // What pass managers themselves did for time traces before LLVM 17
+        TimeTraceScope scope(PassT::name(), IR.getName());
+#endif
+        PA = pass.run(IR, AM);
+    }
+    PI.runAfterPass(pass, IR, PA);
+    if (!PA.areAllPreserved()) AM.invalidate(IR, PA);
+    return !PA.areAllPreserved();
+}
+
+// The IR unit instrumentation callbacks were given, if it is a UnitT
+template <typename UnitT>
+const UnitT* irUnit(const Any& IR) {
+#if LLVM_VERSION_MAJOR >= 16
+    const UnitT *const *unit = any_cast<const UnitT*>(&IR);
+    return unit ? *unit : nullptr;
+#else
+    return any_isa<const UnitT*>(IR) ? any_cast<const UnitT*>(IR) : nullptr;
+#endif
+}
+
+#if LLVM_VERSION_MAJOR >= 17
+std::string irName(const Any& IR) {
+    if (const auto *F = irUnit<Function>(IR)) return F->getName().str();
+    if (const auto *M = irUnit<Module>(IR)) return M->getName().str();
+    if (const auto *L = irUnit<Loop>(IR)) return L->getName().str();
+    return "";
+}
+#endif
+
+// -1 for IR units that are not counted
+int instructionCount(const Any& IR) {
+    if (const auto *F = irUnit<Function>(IR)) return F->getInstructionCount();
+    if (const auto *M = irUnit<Module>(IR)) return M->getInstructionCount();
+    if (const auto *L = irUnit<Loop>(IR)) {
+        int count = 0;
+        for (BasicBlock *BB : L->blocks()) count += BB->size();
+        return count;
+    }
+    return -1;
+}
+
+// Pass managers and adaptors only forward to the passes they hold
+bool isContainerPass(StringRef pass) {
+    return pass.contains("PassManager") || pass.contains("PassAdaptor");
+}
+
+} // namespace
+
 QuillOptimizationManager::QuillOptimizationManager(OptimizationLevel level) 
     : opt_level(level) {
+#if LLVM_VERSION_MAJOR >= 17
+    // Pass managers stopped opening time-trace scopes in LLVM 17; these
+    // cost nothing unless a trace is being recorded
+    pass_callbacks.registerBeforeNonSkippedPassCallback([](StringRef pass, Any IR) {
+        if (timeTraceProfilerEnabled()) timeTraceProfilerBegin(pass, irName(IR));
+    });
+    pass_callbacks.registerAfterPassCallback([](StringRef, Any, const PreservedAnalyses&) {
+        timeTraceProfilerEnd();
+    });
+    pass_callbacks.registerAfterPassInvalidatedCallback([](StringRef, const PreservedAnalyses&) {
+        timeTraceProfilerEnd();
+    });
+#endif
+    pass_callbacks.registerBeforeNonSkippedPassCallback([this](StringRef, Any IR) {
+        if (detailed_statistics) pass_sizes_before.push_back(instructionCount(IR));
+    });
+    pass_callbacks.registerAfterPassCallback([this](StringRef pass, Any IR, const PreservedAnalyses& PA) {
+        if (!detailed_statistics || pass_sizes_before.empty()) return;
+        int size_before = pass_sizes_before.back();
+        pass_sizes_before.pop_back();
+        recordPassRun(pass, size_before, instructionCount(IR), !PA.areAllPreserved());
+    });
+    pass_callbacks.registerAfterPassInvalidatedCallback([this](StringRef pass, const PreservedAnalyses&) {
+        // The IR unit is gone (a loop that was fully unrolled)
+        if (!detailed_statistics || pass_sizes_before.empty()) return;
+        pass_sizes_before.pop_back();
+        recordPassRun(pass, -1, -1, true);
+    });
     setupPassPipeline();
 }
 
@@ -26,49 +221,150 @@ void QuillOptimizationManager::runOptimizations(Module& module) {
     
     // Reset stats
     stats = OptimizationStats{};
+    pass_sizes_before.clear();
+    
+    // Sizes as codegen left them, before the runtime is linked in
+    for (Function& F : module) {
+        if (F.isDeclaration()) continue;
+        stats.function_sizes.push_back({F.getName().str(), (int)F.getInstructionCount(), 0});
+    }
+    
+    configureForHost(module);
+    if (isPassEnabled("link-runtime", opt_level >= O1)) {
+        TimeTraceScope scope("LinkRuntime");
+        linkRuntime(module);
+    }
+    if (!profile_generate_path.empty()) {
+        TimeTraceScope scope("InstrumentForProfiling");
+        instrumentForProfiling(module);
+    } else if (!profile_use_path.empty()) {
+        TimeTraceScope scope("ApplyProfile", profile_use_path);
+        applyProfile(module);
+    }
+    if (stats.runtime_linked) {
+        TimeTraceScope scope("InlineRuntimeCalls");
+        inlineRuntimeCalls(module);
+    }
+    LLVMContext &ctx = module.getContext();
+    ctx.setDiagnosticHandler(std::make_unique<VectorizationRemarkHandler>(stats));
     
     // Run module-level optimizations
     if (module_pm) {
+        // The inliner reads block frequencies through the function proxy
+        LoopAnalysisManager LAM;
+        FunctionAnalysisManager FAM;
+        CGSCCAnalysisManager CGAM;
         ModuleAnalysisManager MAM;
-        PassBuilder PB;
+        
+        PassBuilder PB(target_machine.get(), PipelineTuningOptions(), {}, &pass_callbacks);
         PB.registerModuleAnalyses(MAM);
+        PB.registerCGSCCAnalyses(CGAM);
+        PB.registerFunctionAnalyses(FAM);
+        PB.registerLoopAnalyses(LAM);
+        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
         
         module_pm->run(module, MAM);
+        if (inlining_pass) {
+            runInstrumented(*inlining_pass, module, MAM);
+        }
+        if (specialization_pass) {
+            runInstrumented(*specialization_pass, module, MAM);
+        }
+        if (memoization_pass) {
+            runInstrumented(*memoization_pass, module, MAM);
+        }
     }
     
     // Run function-level optimizations
     if (function_pm) {
+        // Declared inner-to-outer so the proxies in FAM outlive nothing
+        // they point at when the managers are destroyed
+        LoopAnalysisManager LAM;
         FunctionAnalysisManager FAM;
-        ModuleAnalysisManager MAM;
         CGSCCAnalysisManager CGAM;
-        LoopAnalysisManager LAM;
+        ModuleAnalysisManager MAM;
         
-        PassBuilder PB;
+        PassBuilder PB(target_machine.get(), PipelineTuningOptions(), {}, &pass_callbacks);
         PB.registerModuleAnalyses(MAM);
         PB.registerCGSCCAnalyses(CGAM);  
         PB.registerFunctionAnalyses(FAM);
         PB.registerLoopAnalyses(LAM);
         PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
         
+        // Cached bodies come in through the linker's type mapping
+        std::unique_ptr<IRMover> mover;
+        if (function_cache) mover = std::make_unique<IRMover>(module);
+        
         for (Function& F : module) {
-            if (!F.isDeclaration()) {
-                function_pm->run(F, FAM);
+            if (F.isDeclaration() || runtime_functions.count(F.getName().str())) continue;
+            TimeTraceScope scope("OptimizeFunction", F.getName());
+            if (mover) {
+                optimizeFunction(F, FAM, *mover);
+            } else {
+                runFunctionPipeline(F, FAM);
             }
         }
+        // Intrinsics a pass declared and then optimized away; a reused body
+        // only brings the declarations it uses
+        for (auto it = module.begin(); it != module.end();) {
+            Function &F = *it++;
+            if (F.isIntrinsic() && F.use_empty()) F.eraseFromParent();
+        }
+    }
+    
+    if (stats.profile_instrumented) {
+        TimeTraceScope scope("LowerProfileCounters");
+        lowerProfileCounters(module);
     }
     
+    ctx.setDiagnosticHandler(std::make_unique<DiagnosticHandler>());
+    
     auto end_time = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
     stats.optimization_time_ms = duration.count() / 1000000.0;
     
+    std::map<std::string, size_t> size_index;
+    for (size_t i = 0; i < stats.function_sizes.size(); i++) {
+        size_index[stats.function_sizes[i].name] = i;
+    }
+    for (Function& F : module) {
+        if (F.isDeclaration() || runtime_functions.count(F.getName().str())) continue;
+        auto known = size_index.find(F.getName().str());
+        if (known == size_index.end()) {
+            stats.function_sizes.push_back({F.getName().str(), 0, (int)F.getInstructionCount()});
+        } else {
+            stats.function_sizes[known->second].instructions_after = F.getInstructionCount();
+        }
+    }
+    for (const auto& size : stats.function_sizes) {
+        stats.instructions_eliminated += size.instructions_before - size.instructions_after;
+    }
+    
     // Collect statistics from type-directed pass if available
     if (type_directed_pass) {
         const auto& type_stats = type_directed_pass->getStats();
-        stats.type_specializations = type_stats.specializations_applied;
         stats.type_casts_eliminated = type_stats.type_casts_eliminated;
         stats.numeric_operations_optimized = type_stats.numeric_optimizations;
-        stats.divisions_to_shifts = type_stats.divisions_to_shifts;
+        stats.divisions_to_shifts = type_stats.division_to_shifts;
         stats.multiplications_to_shifts = type_stats.multiplication_to_shifts;
+        stats.integer_chains_converted = type_stats.integer_chains_converted;
+    }
+    
+    if (memoization_pass) {
+        stats.functions_memoized = memoization_pass->getFunctionsMemoized();
+    }
+    
+    if (inlining_pass) {
+        stats.functions_inlined = inlining_pass->getCallsInlined();
+    }
+    
+    if (specialization_pass) {
+        const auto& spec_stats = specialization_pass->getStats();
+        stats.functions_specialized = spec_stats.functions_specialized;
+        stats.specialized_call_sites = spec_stats.call_sites_specialized;
+        stats.specialization_growth = spec_stats.instructions_added;
+        stats.specialization_budget = spec_stats.growth_budget;
+        stats.constants_folded += spec_stats.constants_folded;
     }
 }
 
@@ -78,34 +374,66 @@ void QuillOptimizationManager::setOptimizationLevel(OptimizationLevel level) {
 }
 
 void QuillOptimizationManager::setupPassPipeline() {
+    type_directed_pass.reset();
+    cleanup_pm.reset();
+    specialization_pass.reset();
+    memoization_pass.reset();
+    inlining_pass.reset();
     function_pm = std::make_unique<FunctionPassManager>();
+    vectorize_pm = std::make_unique<FunctionPassManager>();
     module_pm = std::make_unique<ModulePassManager>();
     
     switch (opt_level) {
         case O0:
             // No optimizations
             break;
-            
+        
         case O1:
             addBasicOptimizations();
             break;
-            
+        
         case O2:
             addBasicOptimizations();
             addAdvancedOptimizations();
             break;
-            
+        
         case O3:
             addBasicOptimizations();
             addAdvancedOptimizations();
-            function_pm->addPass(QuillArithmeticSimplificationPass());
+            function_pm->addPass(QuillArithmeticSimplificationPass(&stats.expressions_simplified,
+                                                                   &stats.constants_folded));
+            // Run directly (not through function_pm) so statistics stay readable
             type_directed_pass = std::make_unique<QuillTypeDirectedOptimizationPass>();
-            function_pm->addPass(*type_directed_pass);
+            type_directed_pass->setTypeInformation(type_info);
+            // Rewritten chains leave conversions and FP code behind
+            cleanup_pm = std::make_unique<FunctionPassManager>();
+            cleanup_pm->addPass(InstCombinePass());
+            cleanup_pm->addPass(ADCEPass());
+            // Clones are simplified by the function pipeline that follows
+            specialization_pass = std::make_unique<QuillFunctionSpecializationPass>();
             break;
     }
+    
+    // Memoization trades memory for time, so below -O3 it is opt-in
+    if (isPassEnabled("memoize", opt_level == O3)) {
+        memoization_pass = std::make_unique<QuillMemoizationPass>();
+    }
+    
+    // Without a profile the inliner cannot tell hot call sites from cold
+    if (isPassEnabled("inline", opt_level >= O2 && !profile_use_path.empty())) {
+        inlining_pass = std::make_unique<QuillFunctionInliningPass>();
+    }
 }
 
 void QuillOptimizationManager::addBasicOptimizations() {
+    // Locals start out as allocas; promoting them first gives every later
+    // pass (and the loop passes in particular) SSA induction variables
+    function_pm->addPass(PromotePass());
+    // Self-recursion becomes loops while each return still has its own
+    // block: TailCallElim takes tail calls and associative accumulators,
+    // the Quill pass the floating-point shapes it has to leave alone
+    function_pm->addPass(TailCallElimPass());
+    function_pm->addPass(QuillAccumulatorRecursionPass(&stats.recursions_to_loops));
     function_pm->addPass(InstCombinePass());
     function_pm->addPass(SimplifyCFGPass());
 }
@@ -113,34 +441,224 @@ void QuillOptimizationManager::addBasicOptimizations() {
 void QuillOptimizationManager::addAdvancedOptimizations() {
     function_pm->addPass(ReassociatePass());
     function_pm->addPass(GVNPass());
+    
+    // Counted loops arrive with a preheader and an i64 induction phi;
+    // canonicalize them so the vectorizer and unroller can compute trip counts
+    LoopPassManager loop_pm;
+    loop_pm.addPass(LoopRotatePass());
+    loop_pm.addPass(IndVarSimplifyPass());
+    function_pm->addPass(LoopSimplifyPass());
+    function_pm->addPass(createFunctionToLoopPassAdaptor(std::move(loop_pm)));
+    
+    // Vector widths and costs come from the host TargetMachine. FP
+    // reductions only vectorize when codegen stamped them reassociable.
+    // These run after the type-directed pass: once FP arithmetic is packed
+    // into vectors it can no longer become integer chains.
+    vectorize_pm->addPass(LoopVectorizePass());
+    vectorize_pm->addPass(InstCombinePass());
+    vectorize_pm->addPass(SLPVectorizerPass());
+    vectorize_pm->addPass(LoopUnrollPass(LoopUnrollOptions(opt_level)));
+    vectorize_pm->addPass(InstCombinePass());
+}
+
+void QuillOptimizationManager::configureForHost(Module& module) {
+    if (!target_machine) {
+        target_machine = createHostTargetMachine();
+        if (!target_machine) return;
+    }
+
+#if LLVM_VERSION_MAJOR >= 21
+    module.setTargetTriple(target_machine->getTargetTriple());
+#else
+    module.setTargetTriple(target_machine->getTargetTriple().str());
+#endif
+    module.setDataLayout(target_machine->createDataLayout());
+    
+    // Record the tuning on each function so llc emits the same vector ISA
+    for (Function &F : module) {
+        if (F.isDeclaration()) continue;
+        F.addFnAttr("target-cpu", target_machine->getTargetCPU());
+        F.addFnAttr("target-features", target_machine->getTargetFeatureString());
+    }
+}
+
+void QuillOptimizationManager::runFunctionPipeline(Function& F, FunctionAnalysisManager& FAM) {
+    function_pm->run(F, FAM);
+    if (type_directed_pass && runInstrumented(*type_directed_pass, F, FAM)) {
+        cleanup_pm->run(F, FAM);
+    }
+    vectorize_pm->run(F, FAM);
+    if (opt_level >= O2) {
+        countCanonicalLoops(F, FAM);
+    }
+    sortUseLists(F);
+}
+
+void QuillOptimizationManager::initializeHost() {
+    hostTarget();
+}
+
+std::unique_ptr<TargetMachine> QuillOptimizationManager::createHostTargetMachine() {
+    const HostTarget &host = hostTarget();
+    if (!host.target) return nullptr;
+    return std::unique_ptr<TargetMachine>(host.target->createTargetMachine(
+        host.triple, host.cpu, host.features, TargetOptions(), Reloc::PIC_));
+}
+
+void QuillOptimizationManager::countCanonicalLoops(Function& F, FunctionAnalysisManager& FAM) {
+    LoopInfo &LI = FAM.getResult<LoopAnalysis>(F);
+    ScalarEvolution &SE = FAM.getResult<ScalarEvolutionAnalysis>(F);
+    for (Loop *L : LI.getLoopsInPreorder()) {
+        if (L->getLoopPreheader() && SE.hasLoopInvariantBackedgeTakenCount(L)) {
+            stats.loops_optimized++;
+        }
+    }
+}
+
+void QuillOptimizationManager::recordPassRun(StringRef pass, int size_before, int size_after, bool changed) {
+    if (isContainerPass(pass)) return;
+    auto activity = std::find_if(stats.passes.begin(), stats.passes.end(),
+                                 [&](const OptimizationStats::PassActivity& known) { return known.name == pass; });
+    if (activity == stats.passes.end()) {
+        stats.passes.push_back({pass.str()});
+        activity = std::prev(stats.passes.end());
+    }
+    activity->runs++;
+    if (changed) activity->runs_changed++;
+    if (size_before >= 0 && size_after >= 0) activity->instructions_added += size_after - size_before;
+}
+
+void QuillOptimizationManager::setTypeInformation(const TypeChecker* type_checker) {
+    type_info = type_checker;
+    if (type_directed_pass) {
+        type_directed_pass->setTypeInformation(type_checker);
+    }
 }
 
 void QuillOptimizationManager::enablePass(const std::string& pass_name) {
-    // For future extensibility - allow enabling specific passes
-    // This would require a registry of available passes
+    enabled_passes.insert(pass_name);
+    disabled_passes.erase(pass_name);
+    setupPassPipeline();
 }
 
 void QuillOptimizationManager::disablePass(const std::string& pass_name) {
-    // For future extensibility - allow disabling specific passes
+    disabled_passes.insert(pass_name);
+    enabled_passes.erase(pass_name);
+    setupPassPipeline();
+}
+
+bool QuillOptimizationManager::isPassEnabled(const std::string& pass_name, bool enabled_by_default) const {
+    if (enabled_passes.count(pass_name)) return true;
+    if (disabled_passes.count(pass_name)) return false;
+    return enabled_by_default;
 }
 
-void QuillOptimizationManager::printOptimizationReport() const {
-    std::cout << "\n=== Quill Optimization Report ===" << std::endl;
-    std::cout << "Optimization Level: O" << (int)opt_level << std::endl;
-    std::cout << "Optimization Time: " << stats.optimization_time_ms << " ms" << std::endl;
-    std::cout << "Instructions Eliminated: " << stats.instructions_eliminated << std::endl;
-    std::cout << "Constants Folded: " << stats.constants_folded << std::endl;
-    std::cout << "Functions Inlined: " << stats.functions_inlined << std::endl;
-    std::cout << "Loops Optimized: " << stats.loops_optimized << std::endl;
+void QuillOptimizationManager::printOptimizationReport(std::ostream& out) const {
+    out << "\n=== Quill Optimization Report ===" << std::endl;
+    out << "Optimization Level: O" << (int)opt_level << std::endl;
+    out << "Optimization Time: " << stats.optimization_time_ms << " ms" << std::endl;
+    out << "Instructions Eliminated: " << stats.instructions_eliminated << std::endl;
+    out << "Constants Folded: " << stats.constants_folded << std::endl;
+    out << "Expressions Simplified: " << stats.expressions_simplified << std::endl;
+    out << "Functions Inlined: " << stats.functions_inlined << std::endl;
+    out << "Loops Optimized: " << stats.loops_optimized << std::endl;
+    out << "Functions Memoized: " << stats.functions_memoized << std::endl;
+    out << "Recursions Turned Into Loops: " << stats.recursions_to_loops << std::endl;
+    if (stats.profile_instrumented) {
+        out << "Profile: instrumented, writing " << profile_generate_path << std::endl;
+    } else if (stats.profile_applied) {
+        out << "Profile: " << profile_use_path << " (" << stats.hot_functions << " hot, "
+                  << stats.cold_functions << " cold functions)" << std::endl;
+    }
+    if (function_cache) {
+        out << "Functions Reused From Cache: " << stats.functions_reused << " of "
+                  << stats.functions_reused + stats.functions_optimized << std::endl;
+    }
+    if (stats.runtime_linked) {
+        out << "Runtime Functions Linked: " << stats.runtime_functions_linked
+                  << " (" << stats.runtime_calls_inlined << " calls inlined)" << std::endl;
+    }
+    
+    if (opt_level >= O2) {
+        out << "\n--- Vectorization ---" << std::endl;
+        out << "Target: " << (target_machine ? target_machine->getTargetTriple().str() + " (" +
+                                    target_machine->getTargetCPU().str() + ")" : "generic") << std::endl;
+        out << "Loops Vectorized: " << stats.loops_vectorized << std::endl;
+        out << "SLP Trees Vectorized: " << stats.slp_trees_vectorized << std::endl;
+        for (const std::string& remark : stats.vectorization_remarks) {
+            out << "  " << remark << std::endl;
+        }
+    }
     
     // Type-directed optimization statistics
     if (opt_level >= O3) {
-        std::cout << "\n--- Type-Directed Optimizations ---" << std::endl;
-        std::cout << "Numeric Operations Optimized: " << stats.numeric_operations_optimized << std::endl;
-        std::cout << "Multiplications → Bit Shifts: " << stats.multiplications_to_shifts << std::endl;
-        std::cout << "Divisions → Bit Shifts: " << stats.divisions_to_shifts << std::endl;
-        std::cout << "Type Casts Eliminated: " << stats.type_casts_eliminated << std::endl;
-        std::cout << "Type Specializations Applied: " << stats.type_specializations << std::endl;
-    }
-    std::cout << "==================================" << std::endl;
+        out << "\n--- Type-Directed Optimizations ---" << std::endl;
+        out << "Numeric Operations Optimized: " << stats.numeric_operations_optimized << std::endl;
+        out << "Multiplications → Bit Shifts: " << stats.multiplications_to_shifts << std::endl;
+        out << "Divisions → Bit Shifts: " << stats.divisions_to_shifts << std::endl;
+        out << "Integer Chains Converted: " << stats.integer_chains_converted << std::endl;
+        out << "Type Casts Eliminated: " << stats.type_casts_eliminated << std::endl;
+        
+        out << "\n--- Function Specialization ---" << std::endl;
+        out << "Functions Specialized: " << stats.functions_specialized
+                  << " (" << stats.specialized_call_sites << " call sites)" << std::endl;
+        out << "Code Growth: " << stats.specialization_growth << " / "
+                  << stats.specialization_budget << " instructions" << std::endl;
+    }
+    out << "==================================" << std::endl;
+}
+
+void QuillOptimizationManager::writeStatisticsJSON(JsonWriter& json) const {
+    json.beginObject();
+    json.field("level", (int)opt_level);
+    json.field("time_ms", stats.optimization_time_ms);
+    json.field("instructions_eliminated", stats.instructions_eliminated);
+    json.field("constants_folded", stats.constants_folded);
+    json.field("expressions_simplified", stats.expressions_simplified);
+    json.field("functions_inlined", stats.functions_inlined);
+    json.field("loops_optimized", stats.loops_optimized);
+    json.field("functions_memoized", stats.functions_memoized);
+    json.field("recursions_to_loops", stats.recursions_to_loops);
+    json.field("loops_vectorized", stats.loops_vectorized);
+    json.field("slp_trees_vectorized", stats.slp_trees_vectorized);
+    json.field("numeric_operations_optimized", stats.numeric_operations_optimized);
+    json.field("multiplications_to_shifts", stats.multiplications_to_shifts);
+    json.field("divisions_to_shifts", stats.divisions_to_shifts);
+    json.field("integer_chains_converted", stats.integer_chains_converted);
+    json.field("type_casts_eliminated", stats.type_casts_eliminated);
+    json.field("functions_specialized", stats.functions_specialized);
+    json.field("specialized_call_sites", stats.specialized_call_sites);
+    json.field("specialization_growth", stats.specialization_growth);
+    json.field("runtime_functions_linked", stats.runtime_functions_linked);
+    json.field("runtime_calls_inlined", stats.runtime_calls_inlined);
+    json.field("hot_functions", stats.hot_functions);
+    json.field("cold_functions", stats.cold_functions);
+    json.field("functions_optimized", stats.functions_optimized);
+    json.field("functions_reused", stats.functions_reused);
+    
+    json.key("functions");
+    json.beginArray();
+    for (const auto& size : stats.function_sizes) {
+        json.beginObject();
+        json.field("name", size.name);
+        json.field("instructions_before", size.instructions_before);
+        json.field("instructions_after", size.instructions_after);
+        json.endObject();
+    }
+    json.endArray();
+    
+    if (detailed_statistics) {
+        json.key("passes");
+        json.beginArray();
+        for (const auto& pass : stats.passes) {
+            json.beginObject();
+            json.field("name", pass.name);
+            json.field("runs", pass.runs);
+            json.field("runs_changed", pass.runs_changed);
+            json.field("instructions_added", pass.instructions_added);
+            json.endObject();
+        }
+        json.endArray();
+    }
+    json.endObject();
 }
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "../include/optimization_passes.h"
+#include <llvm/Analysis/BlockFrequencyInfo.h>
+#include <llvm/Analysis/CGSCCPassManager.h>
+#include <llvm/Analysis/LoopAnalysisManager.h>
+#include <llvm/Analysis/ProfileSummaryInfo.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Transforms/Instrumentation/InstrProfiling.h>
+#include <llvm/Transforms/Instrumentation/PGOInstrumentation.h>
+
+using namespace llvm;
+using namespace quill;
+
+namespace {
+
+// PGO passes query BFI and the profile summary through the proxies, so
+// they need the full set of analysis managers
+struct ProfileAnalyses {
+    LoopAnalysisManager LAM;
+    FunctionAnalysisManager FAM;
+    CGSCCAnalysisManager CGAM;
+    ModuleAnalysisManager MAM;
+    
+    explicit ProfileAnalyses(TargetMachine* target_machine) {
+        PassBuilder PB(target_machine);
+        PB.registerModuleAnalyses(MAM);
+        PB.registerCGSCCAnalyses(CGAM);
+        PB.registerFunctionAnalyses(FAM);
+        PB.registerLoopAnalyses(LAM);
+        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+    }
+};
+
+} // namespace
+
+void QuillOptimizationManager::setProfileGenerate(const std::string& path) {
+    profile_generate_path = path;
+}
+
+void QuillOptimizationManager::setProfileUse(const std::string& path) {
+    profile_use_path = path;
+    setupPassPipeline();
+}
+
+void QuillOptimizationManager::instrumentForProfiling(Module& module) {
+    // The output path is recorded when the counters are lowered
+    ProfileAnalyses analyses(target_machine.get());
+    PGOInstrumentationGen().run(module, analyses.MAM);
+    stats.profile_instrumented = true;
+}
+
+void QuillOptimizationManager::applyProfile(Module& module) {
+    ProfileAnalyses analyses(target_machine.get());
+    PGOInstrumentationUse(profile_use_path).run(module, analyses.MAM);
+    
+    // Branch weights now sit on the terminators and entry counts on the
+    // functions; later passes and llc's block placement read them directly
+    ProfileSummaryInfo &PSI = analyses.MAM.getResult<ProfileSummaryAnalysis>(module);
+    if (!PSI.hasProfileSummary()) return;
+    stats.profile_applied = true;
+    
+    for (Function &F : module) {
+        if (F.isDeclaration()) continue;
+        if (PSI.isFunctionEntryHot(&F)) {
+            stats.hot_functions++;
+        } else if (PSI.isFunctionEntryCold(&F)) {
+            stats.cold_functions++;
+        }
+    }
+}
+
+void QuillOptimizationManager::lowerProfileCounters(Module& module) {
+    InstrProfOptions options;
+    options.InstrProfileOutput = profile_generate_path;
+    
+    ProfileAnalyses analyses(target_machine.get());
+#if LLVM_VERSION_MAJOR >= 18
+    InstrProfilingLoweringPass(options).run(module, analyses.MAM);
+#else
+    InstrProfiling(options).run(module, analyses.MAM);
+#endif
+}
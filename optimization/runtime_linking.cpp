@@ -0,0 +1,147 @@
+#include "../include/optimization_passes.h"
+#include "../include/runtime_bitcode.h"
+#include <llvm/Analysis/AssumptionCache.h>
+#include <llvm/Analysis/BlockFrequencyInfo.h>
+#include <llvm/Analysis/InlineCost.h>
+#include <llvm/Analysis/ProfileSummaryInfo.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Transforms/IPO/GlobalDCE.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <iostream>
+
+using namespace llvm;
+using namespace quill;
+
+bool QuillOptimizationManager::linkRuntime(Module& module) {
+    runtime_functions.clear();
+    if (runtime_bitcode_size == 0) return false;
+    
+    MemoryBufferRef buffer(StringRef(reinterpret_cast<const char*>(runtime_bitcode), runtime_bitcode_size),
+                           "runtime.bc");
+    Expected<std::unique_ptr<Module>> parsed = parseBitcodeFile(buffer, module.getContext());
+    if (!parsed) {
+        // Programs still link against runtime.o, so this only costs performance
+        std::cerr << "warning: embedded runtime not linked: " << toString(parsed.takeError()) << std::endl;
+        return false;
+    }
+    std::unique_ptr<Module> runtime = std::move(*parsed);
+    runtime->setTargetTriple(module.getTargetTriple());
+    runtime->setDataLayout(module.getDataLayout());
+    
+    std::set<std::string> defined;
+    for (Function &F : *runtime) {
+        if (!F.isDeclaration()) defined.insert(F.getName().str());
+    }
+    
+    // Only pull in what the program references, transitively
+    if (Linker::linkModules(module, std::move(runtime), Linker::Flags::LinkOnlyNeeded)) {
+        std::cerr << "warning: embedded runtime failed to link" << std::endl;
+        return false;
+    }
+    
+    // Process-wide state lives in runtime.o (or libquill), so the linked
+    // copy refers to it instead of keeping its own: the error handler a host
+    // installs, the per-thread output buffers a host flushes and the pool of
+    // parallel loop workers. Bodies dropped here become external declarations.
+    if (GlobalVariable *handler = module.getGlobalVariable("quill_runtime_error_handler")) {
+        handler->setInitializer(nullptr);
+        handler->setLinkage(GlobalValue::ExternalLinkage);
+    }
+    for (const char *name : {"quill_thread_output", "quill_parallel_for"}) {
+        Function *shared = module.getFunction(name);
+        if (shared && !shared->isDeclaration()) shared->deleteBody();
+    }
+    
+    // The program is now closed apart from main: runtime internals can be
+    // inlined, specialized or deleted, and never clash with runtime.o
+    internalizeModule(module, [](const GlobalValue &value) {
+        return value.getName() == "main";
+    });
+    
+    for (Function &F : module) {
+        if (!F.isDeclaration() && defined.count(F.getName().str())) {
+            runtime_functions.insert(F.getName().str());
+        }
+    }
+    
+    // Runtime functions take the host tuning too, or the inliner would
+    // refuse them as target-incompatible
+    configureForHost(module);
+    stats.runtime_linked = true;
+    return true;
+}
+
+void QuillOptimizationManager::inlineRuntimeCalls(Module& module) {
+    FunctionAnalysisManager FAM;
+    PassBuilder PB(target_machine.get());
+    PB.registerFunctionAnalyses(FAM);
+    
+    auto get_assumption_cache = [&](Function &F) -> AssumptionCache& {
+        return FAM.getResult<AssumptionAnalysis>(F);
+    };
+    auto get_library_info = [&](Function &F) -> const TargetLibraryInfo& {
+        return FAM.getResult<TargetLibraryAnalysis>(F);
+    };
+    // Profile counts, when loaded, raise the threshold at hot call sites
+    auto get_block_frequency = [&](Function &F) -> BlockFrequencyInfo& {
+        return FAM.getResult<BlockFrequencyAnalysis>(F);
+    };
+    ProfileSummaryInfo PSI(module);
+    InlineParams params = getInlineParams(opt_level, 0);
+    
+    auto is_runtime_call = [&](CallBase *call) {
+        Function *callee = call->getCalledFunction();
+        return callee && !callee->isDeclaration() && runtime_functions.count(callee->getName().str());
+    };
+    
+    std::vector<CallBase*> worklist;
+    for (Function &F : module) {
+        if (F.isDeclaration() || runtime_functions.count(F.getName().str())) continue;
+        for (BasicBlock &BB : F) {
+            for (Instruction &I : BB) {
+                auto *call = dyn_cast<CallBase>(&I);
+                if (call && is_runtime_call(call)) worklist.push_back(call);
+            }
+        }
+    }
+    
+    // Calls exposed by inlining are considered too, so a thin entry point
+    // such as print_double does not hide the helpers behind it
+    while (!worklist.empty()) {
+        CallBase *call = worklist.back();
+        worklist.pop_back();
+        
+        Function *caller = call->getFunction();
+        Function *callee = call->getCalledFunction();
+        if (caller == callee) continue;
+        
+        InlineCost cost = getInlineCost(*call, params, FAM.getResult<TargetIRAnalysis>(*callee),
+                                        get_assumption_cache, get_library_info, get_block_frequency, &PSI);
+        if (!cost) continue;
+        
+        InlineFunctionInfo info;
+        if (!InlineFunction(*call, info).isSuccess()) continue;
+        stats.runtime_calls_inlined++;
+        FAM.invalidate(*caller, PreservedAnalyses::none());
+        
+        for (CallBase *exposed : info.InlinedCallSites) {
+            if (is_runtime_call(exposed)) worklist.push_back(exposed);
+        }
+    }
+    
+    // Drop runtime functions that are now unreferenced
+    ModuleAnalysisManager MAM;
+    PB.registerModuleAnalyses(MAM);
+    GlobalDCEPass().run(module, MAM);
+    
+    for (auto it = runtime_functions.begin(); it != runtime_functions.end();) {
+        it = module.getFunction(*it) ? std::next(it) : runtime_functions.erase(it);
+    }
+    stats.runtime_functions_linked = runtime_functions.size();
+}
@@ -1,16 +1,224 @@
 #include "../include/optimization_passes.h"
+#include "../include/range_analysis.h"
+#include <llvm/ADT/PostOrderIterator.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Metadata.h>
 #include <llvm/Support/Casting.h>
+#include <cmath>
 #include <iostream>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace llvm;
 using namespace quill;
 
+namespace {
+
+// Range codegen attached to an instruction via quill.range metadata
+bool readRangeMetadata(const Value* val, ValueRange& range) {
+    auto *inst = dyn_cast<Instruction>(val);
+    if (!inst) return false;
+    
+    MDNode *node = inst->getMetadata(RANGE_METADATA_KIND);
+    if (!node || node->getNumOperands() != 4) return false;
+    
+    auto *lo = mdconst::dyn_extract<ConstantFP>(node->getOperand(0));
+    auto *hi = mdconst::dyn_extract<ConstantFP>(node->getOperand(1));
+    auto *integral = mdconst::dyn_extract<ConstantInt>(node->getOperand(2));
+    auto *negative_zero = mdconst::dyn_extract<ConstantInt>(node->getOperand(3));
+    if (!lo || !hi || !integral || !negative_zero) return false;
+    
+    range = ValueRange::interval(lo->getValueAPF().convertToDouble(),
+                                 hi->getValueAPF().convertToDouble(),
+                                 integral->isOne());
+    range.negative_zero = negative_zero->isOne();
+    return true;
+}
+
+bool isChainArithmetic(const Instruction* inst) {
+    switch (inst->getOpcode()) {
+        case Instruction::FAdd:
+        case Instruction::FSub:
+        case Instruction::FMul:
+        case Instruction::FRem:
+        case Instruction::FNeg:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool integerPredicate(FCmpInst::Predicate pred, CmpInst::Predicate& out) {
+    // Integers are never NaN, so ordered and unordered forms coincide
+    switch (pred) {
+        case FCmpInst::FCMP_OEQ: case FCmpInst::FCMP_UEQ: out = ICmpInst::ICMP_EQ; return true;
+        case FCmpInst::FCMP_ONE: case FCmpInst::FCMP_UNE: out = ICmpInst::ICMP_NE; return true;
+        case FCmpInst::FCMP_OLT: case FCmpInst::FCMP_ULT: out = ICmpInst::ICMP_SLT; return true;
+        case FCmpInst::FCMP_OLE: case FCmpInst::FCMP_ULE: out = ICmpInst::ICMP_SLE; return true;
+        case FCmpInst::FCMP_OGT: case FCmpInst::FCMP_UGT: out = ICmpInst::ICMP_SGT; return true;
+        case FCmpInst::FCMP_OGE: case FCmpInst::FCMP_UGE: out = ICmpInst::ICMP_SGE; return true;
+        default: return false;
+    }
+}
+
+Instruction* findRoot(std::unordered_map<Instruction*, Instruction*>& parent, Instruction* inst) {
+    while (parent[inst] != inst) {
+        parent[inst] = parent[parent[inst]];
+        inst = parent[inst];
+    }
+    return inst;
+}
+
+// Integer equivalent of a chain operand; conversions are placed right
+// after the definition so one copy serves every use
+Value* integerOperand(Value* val, std::unordered_map<Value*, Value*>& ints, IntegerType* int_type) {
+    auto found = ints.find(val);
+    if (found != ints.end()) return found->second;
+    
+    if (auto *constFP = dyn_cast<ConstantFP>(val)) {
+        double value = constFP->getValueAPF().convertToDouble();
+        return ConstantInt::get(int_type, static_cast<int64_t>(value), true);
+    }
+    
+    auto *inst = cast<Instruction>(val);
+    IRBuilder<> builder(inst->getNextNode());
+    Value *result;
+    if (isa<SIToFPInst>(inst)) {
+        result = builder.CreateSExtOrTrunc(inst->getOperand(0), int_type, "int_src");
+    } else if (isa<UIToFPInst>(inst)) {
+        result = builder.CreateZExtOrTrunc(inst->getOperand(0), int_type, "int_src");
+    } else {
+        result = builder.CreateFPToSI(inst, int_type, "int_entry");
+    }
+    ints[val] = result;
+    return result;
+}
+
+// Range of an integer value feeding an int-to-FP cast. Follows the
+// shapes codegen and InstCombine leave behind after GVN has forwarded
+// narrowed variables through phis.
+bool integerSourceRange(const Value* val, bool is_signed, ValueRange& range,
+                        std::unordered_set<const Value*>& visiting) {
+    if (!val->getType()->isIntegerTy()) return false;
+    unsigned bits = val->getType()->getIntegerBitWidth();
+    
+    if (auto *constInt = dyn_cast<ConstantInt>(val)) {
+        range = ValueRange::constant(is_signed ? static_cast<double>(constInt->getSExtValue())
+                                               : static_cast<double>(constInt->getZExtValue()));
+        return true;
+    }
+    if (readRangeMetadata(val, range) && range.integral) {
+        range.negative_zero = false;
+        return is_signed || range.lo >= 0;
+    }
+    
+    if (auto *binOp = dyn_cast<BinaryOperator>(val)) {
+        auto *divisor = dyn_cast<ConstantInt>(binOp->getOperand(1));
+        if (divisor && !divisor->isNegative() && !divisor->isZero()) {
+            double limit = static_cast<double>(divisor->getSExtValue());
+            switch (binOp->getOpcode()) {
+                case Instruction::URem:
+                    range = ValueRange::interval(0, limit - 1, true);
+                    return true;
+                case Instruction::SRem:
+                    if (!is_signed) break;
+                    range = ValueRange::interval(-(limit - 1), limit - 1, true);
+                    return true;
+                case Instruction::And:
+                    range = ValueRange::interval(0, limit, true);
+                    return true;
+                default:
+                    break;
+            }
+        }
+    }
+    
+    // Codegen's conversion of a tagged FP value into integer storage
+    if (isa<FPToSIInst>(val) && readRangeMetadata(cast<CastInst>(val)->getOperand(0), range) &&
+        range.isExactInteger()) {
+        return is_signed || range.lo >= 0;
+    }
+    
+    if (isa<SExtInst>(val) || isa<ZExtInst>(val)) {
+        if (!is_signed && isa<SExtInst>(val)) return false;
+        return integerSourceRange(cast<CastInst>(val)->getOperand(0), isa<SExtInst>(val), range, visiting);
+    }
+    
+    if (auto *phi = dyn_cast<PHINode>(val)) {
+        if (!visiting.insert(phi).second) return false;
+        bool first = true;
+        for (Value *incoming : phi->incoming_values()) {
+            ValueRange incoming_range;
+            if (!integerSourceRange(incoming, is_signed, incoming_range, visiting)) {
+                first = true;
+                break;
+            }
+            range = first ? incoming_range : range.join(incoming_range);
+            first = false;
+        }
+        visiting.erase(phi);
+        if (!first) return true;
+    }
+    
+    if (bits <= 32) {
+        range = is_signed && bits > 1
+            ? ValueRange::interval(-std::ldexp(1.0, bits - 1), std::ldexp(1.0, bits - 1) - 1, true)
+            : ValueRange::interval(0, std::ldexp(1.0, bits) - 1, true);
+        return true;
+    }
+    return false;
+}
+
+// Widening casts that map every input to a distinct, exact output
+bool isLosslessCast(const CastInst* cast) {
+    switch (cast->getOpcode()) {
+        case Instruction::SExt:
+        case Instruction::ZExt:
+        case Instruction::FPExt:
+            return true;
+        case Instruction::SIToFP:
+        case Instruction::UIToFP:
+            return cast->getSrcTy()->isIntegerTy() && cast->getDestTy()->isFloatingPointTy() &&
+                   static_cast<int>(cast->getSrcTy()->getIntegerBitWidth()) <=
+                       cast->getDestTy()->getFPMantissaWidth();
+        default:
+            return false;
+    }
+}
+
+// Single cast equivalent to outer(inner(x)) for a lossless inner cast, or 0
+unsigned combinedCastOpcode(const CastInst* inner, const CastInst* outer) {
+    bool inner_is_ext = isa<SExtInst>(inner) || isa<ZExtInst>(inner);
+    
+    switch (outer->getOpcode()) {
+        case Instruction::SExt:
+            // zext clears the sign bit, so sext(zext x) is zext x
+            return inner_is_ext ? inner->getOpcode() : 0;
+        case Instruction::ZExt:
+            return isa<ZExtInst>(inner) ? Instruction::ZExt : 0;
+        case Instruction::Trunc:
+            if (!inner_is_ext || !outer->getDestTy()->isIntegerTy()) return 0;
+            return outer->getDestTy()->getIntegerBitWidth() < inner->getSrcTy()->getIntegerBitWidth()
+                ? Instruction::Trunc : inner->getOpcode();
+        case Instruction::SIToFP:
+            if (isa<SExtInst>(inner)) return Instruction::SIToFP;
+            return isa<ZExtInst>(inner) ? Instruction::UIToFP : 0;
+        case Instruction::UIToFP:
+            return isa<ZExtInst>(inner) ? Instruction::UIToFP : 0;
+        case Instruction::FPExt:
+            return inner_is_ext ? 0 : inner->getOpcode();
+        default:
+            return 0;
+    }
+}
+
+} // anonymous namespace
+
 QuillTypeDirectedOptimizationPass::QuillTypeDirectedOptimizationPass() {
     resetStats();
 }
@@ -18,10 +226,15 @@ QuillTypeDirectedOptimizationPass::QuillTypeDirectedOptimizationPass() {
 PreservedAnalyses QuillTypeDirectedOptimizationPass::run(Function &F, FunctionAnalysisManager &AM) {
     bool changed = false;
     
+    // Range facts from the type checker come first; they subsume the
+    // constant-only rewrites below for the values they cover
+    if (type_info) {
+        changed |= optimizeIntegerArithmetic(F);
+    }
+    
     // Run various type-directed optimizations
     changed |= optimizeNumericOperations(F);
     changed |= eliminateUnnecessaryTypeCasts(F);
-    changed |= specializeGenericFunctions(F);
     changed |= optimizePolymorphicCalls(F);
     changed |= inlineMonomorphicFunctions(F);
     
@@ -108,7 +321,7 @@ bool QuillTypeDirectedOptimizationPass::optimizeNumericOperations(Function &F) {
                                 toErase.push_back(binOp);
                                 changed = true;
                                 stats.numeric_optimizations++;
-                                stats.divisions_to_shifts++;
+                                stats.division_to_shifts++;
                             }
                             break;
                         }
@@ -183,8 +396,11 @@ bool QuillTypeDirectedOptimizationPass::eliminateUnnecessaryTypeCasts(Function &
                     continue;
                 }
                 
-                // Check for cast chains (cast(cast(x)))
+                // Check for cast chains (cast(cast(x))); folding is only
+                // sound when the inner cast loses no information
                 if (auto *innerCast = dyn_cast<CastInst>(operand)) {
+                    if (!isLosslessCast(innerCast)) continue;
+                    
                     // If we're casting back to the original type, eliminate both casts
                     if (innerCast->getSrcTy() == cast->getDestTy()) {
                         cast->replaceAllUsesWith(innerCast->getOperand(0));
@@ -193,20 +409,16 @@ bool QuillTypeDirectedOptimizationPass::eliminateUnnecessaryTypeCasts(Function &
                         stats.type_casts_eliminated++;
                     }
                     // If the intermediate type is not needed, combine the casts  
-                    else {
-                        auto opcode = CastInst::getCastOpcode(innerCast->getOperand(0), false,
-                                                            cast->getDestTy(), false);
-                        if (CastInst::castIsValid(opcode, innerCast->getSrcTy(), cast->getDestTy())) {
-                            IRBuilder<> builder(cast);
-                            auto *newCast = builder.CreateCast(opcode, 
-                                                             innerCast->getOperand(0),
-                                                             cast->getDestTy(),
-                                                             "combined_cast");
-                            cast->replaceAllUsesWith(newCast);
-                            toErase.push_back(cast);
-                            changed = true;
-                            stats.type_casts_eliminated++;
-                        }
+                    else if (unsigned opcode = combinedCastOpcode(innerCast, cast)) {
+                        IRBuilder<> builder(cast);
+                        auto *newCast = builder.CreateCast(static_cast<Instruction::CastOps>(opcode),
+                                                         innerCast->getOperand(0),
+                                                         cast->getDestTy(),
+                                                         "combined_cast");
+                        cast->replaceAllUsesWith(newCast);
+                        toErase.push_back(cast);
+                        changed = true;
+                        stats.type_casts_eliminated++;
                     }
                 }
             }
@@ -221,25 +433,6 @@ bool QuillTypeDirectedOptimizationPass::eliminateUnnecessaryTypeCasts(Function &
     return changed;
 }
 
-bool QuillTypeDirectedOptimizationPass::specializeGenericFunctions(Function &F) {
-    bool changed = false;
-    
-    for (BasicBlock &BB : F) {
-        for (Instruction &I : BB) {
-            if (auto *call = dyn_cast<CallInst>(&I)) {
-                Function *calledFunc = call->getCalledFunction();
-                if (!calledFunc) continue;
-                
-                if (canSpecializeFunction(calledFunc)) {
-                    stats.specializations_applied++;
-                }
-            }
-        }
-    }
-    
-    return changed;
-}
-
 bool QuillTypeDirectedOptimizationPass::optimizePolymorphicCalls(Function &F) {
     bool changed = false;
     
@@ -278,7 +471,8 @@ bool QuillTypeDirectedOptimizationPass::inlineMonomorphicFunctions(Function &F)
 bool QuillTypeDirectedOptimizationPass::isIntegerConstant(Value* val, int64_t& out_value) {
     if (auto *constFP = dyn_cast<ConstantFP>(val)) {
         double fpVal = constFP->getValueAPF().convertToDouble();
-        if (fpVal == std::floor(fpVal) && 
+        // -0.0 has no integer counterpart
+        if (fpVal == std::floor(fpVal) && !(fpVal == 0.0 && std::signbit(fpVal)) &&
             fpVal >= INT64_MIN && fpVal <= INT64_MAX) {
             out_value = static_cast<int64_t>(fpVal);
             return true;
@@ -295,14 +489,6 @@ bool QuillTypeDirectedOptimizationPass::isFloatConstant(Value* val, double& out_
     return false;
 }
 
-bool QuillTypeDirectedOptimizationPass::canSpecializeFunction(Function* func) {
-    if (!func || func->isVarArg() || func->isDeclaration()) {
-        return false;
-    }
-    
-    return func->arg_size() > 0 && func->size() <= 10;
-}
-
 bool QuillTypeDirectedOptimizationPass::isPowerOfTwo(int64_t value) {
     return value > 0 && (value & (value - 1)) == 0;
 }
@@ -317,10 +503,300 @@ int QuillTypeDirectedOptimizationPass::getShiftAmount(int64_t power_of_two) {
     return shift_amount;
 }
 
-bool QuillTypeDirectedOptimizationPass::optimizeIntegerArithmetic(Function &F) {
+bool QuillTypeDirectedOptimizationPass::isExactIntegerOperand(Value* val, double& lo, double& hi) {
+    int64_t int_value;
+    if (isIntegerConstant(val, int_value)) {
+        lo = hi = static_cast<double>(int_value);
+        return ValueRange::constant(lo).isExactInteger();
+    }
+    
+    if (isa<SIToFPInst>(val) || isa<UIToFPInst>(val)) {
+        Value *src = cast<CastInst>(val)->getOperand(0);
+        std::unordered_set<const Value*> visiting;
+        ValueRange range;
+        if (!integerSourceRange(src, isa<SIToFPInst>(val), range, visiting)) return false;
+        lo = range.lo;
+        hi = range.hi;
+        return range.isExactInteger();
+    }
+    
+    ValueRange range;
+    if (val->getType()->isDoubleTy() && readRangeMetadata(val, range) && range.isExactInteger()) {
+        lo = range.lo;
+        hi = range.hi;
+        return true;
+    }
     return false;
 }
 
+bool QuillTypeDirectedOptimizationPass::optimizeIntegerArithmetic(Function &F) {
+    std::vector<Instruction*> order;
+    ReversePostOrderTraversal<Function*> rpo(&F);
+    for (BasicBlock *BB : rpo) {
+        for (Instruction &I : *BB) {
+            order.push_back(&I);
+        }
+    }
+    
+    // InstCombine rebuilds some instructions without their tags; recover
+    // the range from exact operands with the analysis' own arithmetic
+    for (Instruction *I : order) {
+        ValueRange range;
+        if (!isChainArithmetic(I) || readRangeMetadata(I, range)) continue;
+        
+        double lhs_lo, lhs_hi, rhs_lo = 0, rhs_hi = 0;
+        if (!isExactIntegerOperand(I->getOperand(0), lhs_lo, lhs_hi)) continue;
+        if (I->getNumOperands() > 1 && !isExactIntegerOperand(I->getOperand(1), rhs_lo, rhs_hi)) continue;
+        
+        ValueRange lhs = ValueRange::interval(lhs_lo, lhs_hi, true);
+        ValueRange rhs = ValueRange::interval(rhs_lo, rhs_hi, true);
+        switch (I->getOpcode()) {
+            case Instruction::FAdd: range = RangeArithmetic::add(lhs, rhs); break;
+            case Instruction::FSub: range = RangeArithmetic::sub(lhs, rhs); break;
+            case Instruction::FMul: range = RangeArithmetic::mul(lhs, rhs); break;
+            case Instruction::FRem: range = RangeArithmetic::rem(lhs, rhs); break;
+            default: range = RangeArithmetic::neg(lhs); break;
+        }
+        if (!range.isExactInteger()) continue;
+        
+        LLVMContext &ctx = F.getContext();
+        Metadata *operands[] = {
+            ConstantAsMetadata::get(ConstantFP::get(llvm::Type::getDoubleTy(ctx), range.lo)),
+            ConstantAsMetadata::get(ConstantFP::get(llvm::Type::getDoubleTy(ctx), range.hi)),
+            ConstantAsMetadata::get(ConstantInt::getTrue(ctx)),
+            ConstantAsMetadata::get(ConstantInt::getFalse(ctx))
+        };
+        I->setMetadata(RANGE_METADATA_KIND, MDNode::get(ctx, operands));
+    }
+    
+    // Candidates: tagged FP arithmetic, double phis and FP comparisons
+    std::unordered_set<Instruction*> chain;
+    for (Instruction *I : order) {
+        double lo, hi;
+        if (isa<PHINode>(I) && I->getType()->isDoubleTy()) {
+            chain.insert(I);
+        } else if (isa<FCmpInst>(I)) {
+            CmpInst::Predicate pred;
+            if (integerPredicate(cast<FCmpInst>(I)->getPredicate(), pred)) chain.insert(I);
+        } else if (isChainArithmetic(I) && isExactIntegerOperand(I, lo, hi)) {
+            chain.insert(I);
+        }
+    }
+    
+    // Drop candidates with an operand that has no exact integer form
+    bool pruned = true;
+    while (pruned) {
+        pruned = false;
+        for (Instruction *I : order) {
+            if (!chain.count(I)) continue;
+            
+            bool convertible = true;
+            for (Value *operand : I->operands()) {
+                double lo, hi;
+                auto *operand_inst = dyn_cast<Instruction>(operand);
+                if (!(operand_inst && chain.count(operand_inst)) && !isExactIntegerOperand(operand, lo, hi)) {
+                    convertible = false;
+                    break;
+                }
+            }
+            
+            // frem by zero yields NaN but srem by zero is undefined
+            double lo, hi;
+            if (convertible && I->getOpcode() == Instruction::FRem &&
+                !(isExactIntegerOperand(I->getOperand(1), lo, hi) && (lo > 0 || hi < 0))) {
+                convertible = false;
+            }
+            
+            if (!convertible) {
+                chain.erase(I);
+                pruned = true;
+            }
+        }
+    }
+    if (chain.empty()) return false;
+    
+    // Group candidates into connected dataflow chains
+    std::unordered_map<Instruction*, Instruction*> parent;
+    for (Instruction *I : chain) parent[I] = I;
+    for (Instruction *I : chain) {
+        for (Value *operand : I->operands()) {
+            auto *operand_inst = dyn_cast<Instruction>(operand);
+            if (operand_inst && chain.count(operand_inst)) {
+                parent[findRoot(parent, operand_inst)] = findRoot(parent, I);
+            }
+        }
+    }
+    
+    // Each chain pays for the conversions at its edges: fptosi on FP
+    // entries and sitofp on results that escape. It earns one per FP op
+    // replaced, one per int-to-FP cast it absorbs, and more for frem,
+    // which is a libcall on most targets.
+    struct ChainCost {
+        int benefit = 0;
+        int conversions = 0;
+        std::unordered_set<Value*> entries;
+    };
+    std::unordered_map<Instruction*, ChainCost> costs;
+    for (Instruction *I : chain) {
+        ChainCost &cost = costs[findRoot(parent, I)];
+        if (!isa<PHINode>(I)) cost.benefit += I->getOpcode() == Instruction::FRem ? 8 : 1;
+        
+        for (Value *operand : I->operands()) {
+            auto *operand_inst = dyn_cast<Instruction>(operand);
+            if (!operand_inst || chain.count(operand_inst)) continue;
+            if (isa<SIToFPInst>(operand_inst) || isa<UIToFPInst>(operand_inst)) {
+                if (cost.entries.insert(operand_inst).second) cost.benefit++;
+            } else if (cost.entries.insert(operand_inst).second) {
+                cost.conversions++;
+            }
+        }
+        if (isa<FCmpInst>(I)) continue;
+        for (User *user : I->users()) {
+            auto *user_inst = dyn_cast<Instruction>(user);
+            if (!user_inst || !chain.count(user_inst)) {
+                cost.conversions++;
+                break;
+            }
+        }
+    }
+    
+    std::unordered_set<Instruction*> converted;
+    for (Instruction *I : chain) {
+        const ChainCost &cost = costs[findRoot(parent, I)];
+        if (cost.benefit > cost.conversions) converted.insert(I);
+    }
+    if (converted.empty()) return false;
+    
+    IntegerType *int_type = llvm::Type::getInt64Ty(F.getContext());
+    std::unordered_map<Value*, Value*> ints;
+    
+    // Phis first so loop-carried operands have an integer counterpart
+    for (Instruction *I : order) {
+        if (!converted.count(I) || !isa<PHINode>(I)) continue;
+        auto *phi = cast<PHINode>(I);
+        ints[phi] = PHINode::Create(int_type, phi->getNumIncomingValues(), phi->getName(), phi);
+    }
+    
+    for (Instruction *I : order) {
+        if (!converted.count(I) || isa<PHINode>(I)) continue;
+        
+        IRBuilder<> builder(I);
+        Value *lhs = integerOperand(I->getOperand(0), ints, int_type);
+        Value *result = nullptr;
+        
+        // Exact ranges keep every value below 2^53, so nothing can wrap
+        switch (I->getOpcode()) {
+            case Instruction::FAdd:
+                result = builder.CreateNSWAdd(lhs, integerOperand(I->getOperand(1), ints, int_type));
+                break;
+            case Instruction::FSub:
+                result = builder.CreateNSWSub(lhs, integerOperand(I->getOperand(1), ints, int_type));
+                break;
+            case Instruction::FMul:
+                result = builder.CreateNSWMul(lhs, integerOperand(I->getOperand(1), ints, int_type));
+                break;
+            case Instruction::FNeg:
+                result = builder.CreateNSWNeg(lhs);
+                break;
+            case Instruction::FRem: {
+                // fmod takes the sign of the dividend, exactly like srem
+                double lhs_lo, lhs_hi, rhs_lo, rhs_hi;
+                Value *rhs = integerOperand(I->getOperand(1), ints, int_type);
+                bool non_negative = isExactIntegerOperand(I->getOperand(0), lhs_lo, lhs_hi) && lhs_lo >= 0 &&
+                                    isExactIntegerOperand(I->getOperand(1), rhs_lo, rhs_hi) && rhs_lo > 0;
+                result = non_negative ? builder.CreateURem(lhs, rhs) : builder.CreateSRem(lhs, rhs);
+                break;
+            }
+            case Instruction::FCmp: {
+                CmpInst::Predicate pred;
+                integerPredicate(cast<FCmpInst>(I)->getPredicate(), pred);
+                result = builder.CreateICmp(pred, lhs, integerOperand(I->getOperand(1), ints, int_type));
+                break;
+            }
+            default:
+                break;
+        }
+        result->takeName(I);
+        ints[I] = result;
+        stats.integer_arithmetic_optimized++;
+    }
+    
+    for (Instruction *I : order) {
+        if (!converted.count(I) || !isa<PHINode>(I)) continue;
+        auto *phi = cast<PHINode>(I);
+        auto *int_phi = cast<PHINode>(ints[phi]);
+        for (unsigned i = 0; i < phi->getNumIncomingValues(); ++i) {
+            int_phi->addIncoming(integerOperand(phi->getIncomingValue(i), ints, int_type),
+                                 phi->getIncomingBlock(i));
+        }
+    }
+    
+    // Convert back only where a result leaves the chain
+    std::vector<Instruction*> dead_conversions;
+    for (Instruction *I : converted) {
+        Value *int_value = ints[I];
+        if (isa<FCmpInst>(I)) {
+            I->replaceAllUsesWith(int_value);
+            continue;
+        }
+        
+        Value *fp_value = nullptr;
+        for (Use &use : make_early_inc_range(I->uses())) {
+            auto *user_inst = dyn_cast<Instruction>(use.getUser());
+            if (user_inst && converted.count(user_inst)) continue;
+            
+            // An exact value survives the FP round trip, so resize directly
+            if (user_inst && isa<FPToSIInst>(user_inst)) {
+                IRBuilder<> builder(user_inst);
+                Value *resized = builder.CreateSExtOrTrunc(int_value, user_inst->getType());
+                resized->takeName(user_inst);
+                user_inst->replaceAllUsesWith(resized);
+                dead_conversions.push_back(user_inst);
+                stats.type_casts_eliminated++;
+                continue;
+            }
+            // The rebuilt operation may have folded to a constant
+            if (!fp_value) {
+                if (auto *int_constant = dyn_cast<Constant>(int_value)) {
+                    fp_value = ConstantExpr::getSIToFP(int_constant, I->getType());
+                } else {
+                    auto *int_inst = cast<Instruction>(int_value);
+                    Instruction *insert_point = isa<PHINode>(int_inst)
+                        ? &*int_inst->getParent()->getFirstInsertionPt()
+                        : int_inst->getNextNode();
+                    fp_value = IRBuilder<>(insert_point).CreateSIToFP(int_value, I->getType(), "int_exit");
+                }
+            }
+            use.set(fp_value);
+        }
+    }
+    
+    std::unordered_set<Instruction*> roots;
+    std::unordered_set<Instruction*> absorbed_casts;
+    for (Instruction *I : converted) {
+        roots.insert(findRoot(parent, I));
+        for (Value *operand : I->operands()) {
+            if (isa<SIToFPInst>(operand) || isa<UIToFPInst>(operand)) {
+                absorbed_casts.insert(cast<Instruction>(operand));
+            }
+        }
+    }
+    
+    for (Instruction *I : dead_conversions) I->eraseFromParent();
+    for (Instruction *I : converted) I->dropAllReferences();
+    for (Instruction *I : converted) I->eraseFromParent();
+    for (Instruction *I : absorbed_casts) {
+        if (I->use_empty()) {
+            I->eraseFromParent();
+            stats.type_casts_eliminated++;
+        }
+    }
+    
+    stats.integer_chains_converted += roots.size();
+    stats.numeric_optimizations += converted.size();
+    return true;
+}
+
 bool QuillTypeDirectedOptimizationPass::optimizeDivisionToShifts(Function &F) {
     return false;
 }
@@ -32,8 +32,8 @@ if [ ! -f "build/quill" ]; then
 fi
 
 # Build runtime if needed
-if [ ! -f "runtime.o" ]; then
-    gcc -c runtime.c -o runtime.o
+if [ ! -f "runtime.o" ] || [ runtime.c -nt runtime.o ]; then
+    gcc -O2 -c -pthread runtime.c -o runtime.o
 fi
 
 # Initialize report
@@ -78,7 +78,7 @@ for OPT_LEVEL in "-O0" "-O1" "-O2" "-O3"; do
         
         # Create executable for runtime testing
         if [ -f "${BENCHMARK_FILE%.quill}_${OPT_LEVEL}.s" ]; then
-            gcc "${BENCHMARK_FILE%.quill}_${OPT_LEVEL}.s" runtime.o -o "test_${OPT_LEVEL#-}" 2>/dev/null || true
+            gcc "${BENCHMARK_FILE%.quill}_${OPT_LEVEL}.s" runtime.o -pthread -o "test_${OPT_LEVEL#-}" 2>/dev/null || true
         fi
     fi
 done
@@ -1,10 +1,741 @@
+#include "include/runtime.h"
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
-void print_double(double value) {
-    // For integer-like values, print without decimal places
-    if (value == (long long)value) {
-        printf("%.0f\n", value);
+// Runtime errors. The host's handler, if any, sees the message before
+// the process exits.
+quill_error_handler quill_runtime_error_handler;
+
+void quill_set_error_handler(quill_error_handler handler) {
+    __atomic_store_n(&quill_runtime_error_handler, handler, __ATOMIC_RELEASE);
+}
+
+__attribute__((noreturn, format(printf, 1, 2)))
+static void quill_fatal(const char* format, ...) {
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    quill_error_handler handler = __atomic_load_n(&quill_runtime_error_handler, __ATOMIC_ACQUIRE);
+    if (handler) handler(message);
+    fprintf(stderr, "%s\n", message);
+    exit(1);
+}
+
+// Program output. Every thread appends formatted lines to its own buffer,
+// which goes to stdout in a single write() when it fills up, when a
+// parallel loop starts or a worker finishes its share of one, and at exit
+// (generated modules register quill_flush_output as a destructor).
+// Interactive output is written line by line.
+#define QUILL_OUTPUT_BUFFER_SIZE 65536
+#define QUILL_MAX_NUMBER_LENGTH 32
+
+struct quill_output {
+    size_t len;
+    int interactive;
+    char data[QUILL_OUTPUT_BUFFER_SIZE];
+};
+typedef struct quill_output quill_output;
+
+static pthread_key_t quill_output_key;
+static pthread_once_t quill_output_once = PTHREAD_ONCE_INIT;
+static int quill_output_interactive;
+
+static void quill_output_write(quill_output* out) {
+    size_t written = 0;
+    while (written < out->len) {
+        ssize_t n = write(STDOUT_FILENO, out->data + written, out->len - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += (size_t)n;
+    }
+    out->len = 0;
+}
+
+static void quill_output_release(void* buffer) {
+    quill_output_write((quill_output*)buffer);
+    free(buffer);
+}
+
+static void quill_output_init(void) {
+    pthread_key_create(&quill_output_key, quill_output_release);
+    quill_output_interactive = isatty(STDOUT_FILENO);
+}
+
+quill_output* quill_thread_output(void) {
+    pthread_once(&quill_output_once, quill_output_init);
+    quill_output* out = pthread_getspecific(quill_output_key);
+    if (!out) {
+        out = malloc(sizeof(quill_output));
+        if (!out) quill_fatal("MemoryError: cannot allocate output buffer");
+        out->len = 0;
+        out->interactive = quill_output_interactive;
+        pthread_setspecific(quill_output_key, out);
+    }
+    return out;
+}
+
+void quill_flush_output(void) {
+    quill_output_write(quill_thread_output());
+}
+
+// Room for `length` more bytes, flushing first if necessary
+static char* quill_output_reserve(quill_output* out, size_t length) {
+    if (out->len + length > QUILL_OUTPUT_BUFFER_SIZE) {
+        quill_output_write(out);
+    }
+    return out->data + out->len;
+}
+
+static void quill_output_line_done(quill_output* out, char* end) {
+    *end++ = '\n';
+    out->len = (size_t)(end - out->data);
+    if (out->interactive) {
+        quill_output_write(out);
+    }
+}
+
+static const char quill_digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Decimal digits of `value`, exactly `width` of them when width > 0
+// (zero-padded); returns the end of the written text
+static char* quill_format_digits(char* out, uint64_t value, int width) {
+    char digits[20];
+    int pos = 20;
+    while (value >= 100) {
+        const char* pair = quill_digit_pairs + (value % 100) * 2;
+        value /= 100;
+        digits[--pos] = pair[1];
+        digits[--pos] = pair[0];
+    }
+    if (value >= 10) {
+        digits[--pos] = quill_digit_pairs[value * 2 + 1];
+        digits[--pos] = quill_digit_pairs[value * 2];
+    } else {
+        digits[--pos] = (char)('0' + value);
+    }
+    while (20 - pos < width) {
+        digits[--pos] = '0';
+    }
+    memcpy(out, digits + pos, (size_t)(20 - pos));
+    return out + (20 - pos);
+}
+
+static char* quill_format_int(char* out, int64_t value) {
+    if (value < 0) {
+        *out++ = '-';
+        return quill_format_digits(out, 0 - (uint64_t)value, 0);
+    }
+    return quill_format_digits(out, (uint64_t)value, 0);
+}
+
+static const uint64_t quill_powers_of_ten[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+    10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull,
+};
+
+#define QUILL_MAX_FRACTION_DIGITS 19
+
+// value = mantissa / 2^shift. The decimal with k fraction digits closest
+// to value is c / 10^k, with c = mantissa * 10^k / 2^shift rounded half
+// to even; it reads back as value iff it lies inside value's rounding
+// interval. All of this is exact in 128-bit integers: mantissa < 2^53
+// and 10^k < 2^64.
+static int quill_decimal_at(uint64_t mantissa, int shift, int k, uint64_t* digits) {
+    typedef unsigned __int128 u128;
+    u128 unit = quill_powers_of_ten[k];
+    u128 scaled = (u128)mantissa * unit;
+    u128 c = scaled >> shift;
+    u128 remainder = scaled - (c << shift);
+    u128 half = (u128)1 << (shift - 1);
+    if (remainder > half || (remainder == half && (c & 1))) c++;
+    if (c >> 64) return 0;
+
+    // Distance from value in units of 2^-(shift + 2) / 10^k. The interval
+    // is half as wide below a power of two; ties round to even mantissas.
+    u128 decimal = c << (shift + 2);
+    u128 exact = scaled << 2;
+    u128 below = mantissa == ((uint64_t)1 << 52) ? unit : unit << 1;
+    u128 above = unit << 1;
+    int inclusive = (mantissa & 1) == 0;
+    int inside = decimal >= exact ? (inclusive ? decimal - exact <= above : decimal - exact < above)
+                                  : (inclusive ? exact - decimal <= below : exact - decimal < below);
+    if (!inside) return 0;
+    *digits = (uint64_t)c;
+    return 1;
+}
+
+// Shortest decimal that reads back as `value`. Whole numbers print without
+// a fraction. Otherwise the fraction gets the fewest digits k that round
+// trip. If k digits do, so do k + 1: computed values usually need all 17
+// significant digits, so that length is probed first, and short decimals
+// such as 0.37 are found by binary search below it. Tiny and subnormal
+// values fall back to trying printf precisions.
+static char* quill_format_double(char* out, double value) {
+    if (isnan(value)) {
+        memcpy(out, signbit(value) ? "-nan" : "nan", 4);
+        return out + (signbit(value) ? 4 : 3);
+    }
+    if (signbit(value)) {
+        *out++ = '-';
+        value = -value;
+    }
+    if (isinf(value)) {
+        memcpy(out, "inf", 3);
+        return out + 3;
+    }
+
+    const double two_pow_53 = 9007199254740992.0;
+    if (value < two_pow_53 && value == (double)(uint64_t)value) {
+        return quill_format_digits(out, (uint64_t)value, 0);
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof bits);
+    int biased_exponent = (int)((bits >> 52) & 0x7FF);
+    uint64_t mantissa = (bits & (((uint64_t)1 << 52) - 1)) | ((uint64_t)1 << 52);
+    int shift = 1075 - biased_exponent;
+
+    // 17 significant digits always round trip; floor(log10(value)) is
+    // estimated from the binary exponent (log10(2) ~ 1233/4096) and may
+    // be one low, which only costs an extra digit
+    int decimal_exponent = ((biased_exponent - 1023) * 1233) >> 12;
+    int k = 17 - decimal_exponent;
+    if (k < 1) k = 1;
+
+    uint64_t digits;
+    if (value < two_pow_53 && biased_exponent > 0 && k <= QUILL_MAX_FRACTION_DIGITS &&
+        quill_decimal_at(mantissa, shift, k, &digits)) {
+        uint64_t shorter;
+        if (k > 1 && quill_decimal_at(mantissa, shift, k - 1, &shorter)) {
+            digits = shorter;
+            int lo = 1;
+            int hi = k - 1;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (quill_decimal_at(mantissa, shift, mid, &shorter)) {
+                    hi = mid;
+                    digits = shorter;
+                } else {
+                    lo = mid + 1;
+                }
+            }
+            k = hi;
+        }
+        uint64_t unit = quill_powers_of_ten[k];
+        out = quill_format_digits(out, digits / unit, 0);
+        *out++ = '.';
+        return quill_format_digits(out, digits % unit, k);
+    }
+
+    // Huge whole numbers, tiny fractions, and the odd value too close to
+    // a power of ten boundary for the fast path
+    char text[QUILL_MAX_NUMBER_LENGTH];
+    if (value >= two_pow_53 && value < 1e21) {
+        snprintf(text, sizeof text, "%.0f", value);
     } else {
-        printf("%.6f\n", value);
+        for (int precision = 1; precision <= 17; precision++) {
+            snprintf(text, sizeof text, "%.*g", precision, value);
+            if (strtod(text, NULL) == value) break;
+        }
+    }
+    size_t length = strlen(text);
+    memcpy(out, text, length);
+    return out + length;
+}
+
+void print_double(double value) {
+    quill_output* out = quill_thread_output();
+    char* start = quill_output_reserve(out, QUILL_MAX_NUMBER_LENGTH + 1);
+    quill_output_line_done(out, quill_format_double(start, value));
+}
+
+// Strings arrive with their length; nothing scans for a terminator
+void print_str(const char* chars, int64_t length) {
+    quill_output* out = quill_thread_output();
+    size_t remaining = (size_t)length;
+
+    // Longer than the free space (newline included): fill and flush
+    while (remaining >= QUILL_OUTPUT_BUFFER_SIZE - out->len) {
+        size_t piece = QUILL_OUTPUT_BUFFER_SIZE - out->len;
+        memcpy(out->data + out->len, chars, piece);
+        out->len += piece;
+        chars += piece;
+        remaining -= piece;
+        quill_output_write(out);
+    }
+    memcpy(out->data + out->len, chars, remaining);
+    quill_output_line_done(out, out->data + out->len + remaining);
+}
+
+void print_int(int64_t value) {
+    quill_output* out = quill_thread_output();
+    char* start = quill_output_reserve(out, QUILL_MAX_NUMBER_LENGTH + 1);
+    quill_output_line_done(out, quill_format_int(start, value));
+}
+
+// Memo tables for functions the optimizer proved pure. Every memoized
+// function owns one table handle, created on first store. Keys and
+// values are raw 64-bit patterns of the (double or int) arguments.
+typedef struct {
+    uint64_t* slots;      // capacity rows of: arity key words, then the value
+    unsigned char* used;
+    size_t capacity;
+    size_t count;
+    int arity;
+} quill_memo_table;
+
+#define QUILL_MEMO_INITIAL_CAPACITY 64
+#define QUILL_MEMO_MAX_ENTRIES ((size_t)1 << 22)
+
+static uint64_t quill_memo_hash(const uint64_t* key, int arity) {
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+    for (int i = 0; i < arity; i++) {
+        hash ^= key[i] + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+    }
+    // splitmix64 finalizer spreads consecutive integers across buckets
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EBull;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+static size_t quill_memo_find(const quill_memo_table* table, const uint64_t* key) {
+    size_t row = (size_t)table->arity + 1;
+    size_t mask = table->capacity - 1;
+    size_t index = quill_memo_hash(key, table->arity) & mask;
+
+    while (table->used[index]) {
+        const uint64_t* slot = table->slots + index * row;
+        int match = 1;
+        for (int i = 0; i < table->arity; i++) {
+            if (slot[i] != key[i]) {
+                match = 0;
+                break;
+            }
+        }
+        if (match) return index;
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+static int quill_memo_allocate(quill_memo_table* table, size_t capacity) {
+    table->slots = malloc(capacity * ((size_t)table->arity + 1) * sizeof(uint64_t));
+    table->used = calloc(capacity, 1);
+    table->capacity = capacity;
+    table->count = 0;
+    return table->slots && table->used;
+}
+
+static void quill_memo_grow(quill_memo_table* table) {
+    quill_memo_table old = *table;
+    size_t row = (size_t)table->arity + 1;
+
+    if (!quill_memo_allocate(table, old.capacity * 2)) {
+        free(table->slots);
+        free(table->used);
+        *table = old;
+        return;
+    }
+
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (!old.used[i]) continue;
+        size_t index = quill_memo_find(table, old.slots + i * row);
+        for (size_t word = 0; word < row; word++) {
+            table->slots[index * row + word] = old.slots[i * row + word];
+        }
+        table->used[index] = 1;
+        table->count++;
+    }
+
+    free(old.slots);
+    free(old.used);
+}
+
+int quill_memo_lookup(void** handle, const uint64_t* key, int arity, uint64_t* value) {
+    quill_memo_table* table = (quill_memo_table*)*handle;
+    if (!table) return 0;
+
+    size_t index = quill_memo_find(table, key);
+    if (!table->used[index]) return 0;
+
+    *value = table->slots[index * ((size_t)arity + 1) + arity];
+    return 1;
+}
+
+void quill_memo_store(void** handle, const uint64_t* key, int arity, uint64_t value) {
+    quill_memo_table* table = (quill_memo_table*)*handle;
+    if (!table) {
+        table = calloc(1, sizeof(quill_memo_table));
+        if (!table) return;
+        table->arity = arity;
+        if (!quill_memo_allocate(table, QUILL_MEMO_INITIAL_CAPACITY)) {
+            free(table->slots);
+            free(table->used);
+            free(table);
+            return;
+        }
+        *handle = table;
+    }
+
+    // Past the cap the cache stops growing; calls simply recompute
+    if (table->count >= QUILL_MEMO_MAX_ENTRIES) return;
+    if ((table->count + 1) * 2 > table->capacity) {
+        quill_memo_grow(table);
+        if (table->count + 1 >= table->capacity) return;
+    }
+
+    size_t row = (size_t)arity + 1;
+    size_t index = quill_memo_find(table, key);
+    if (!table->used[index]) {
+        table->used[index] = 1;
+        table->count++;
+    }
+    for (int i = 0; i < arity; i++) {
+        table->slots[index * row + i] = key[i];
+    }
+    table->slots[index * row + arity] = value;
+}
+
+// Pending operands of `return x op f(...)` recursion that the optimizer
+// turned into a loop: one 8-byte word per level (quill_pending), pushed on
+// the way down and folded back in reverse on the way up. Generated code
+// pushes inline and only calls in here to grow the buffer and to free it.
+
+#define QUILL_PENDING_MIN_CAPACITY 64
+
+void quill_pending_reserve(quill_pending* pending, int64_t depth) {
+    int64_t cap = pending->cap ? pending->cap * 2 : QUILL_PENDING_MIN_CAPACITY;
+    while (cap <= depth) cap *= 2;
+    uint64_t* data = realloc(pending->data, (size_t)cap * sizeof(uint64_t));
+    if (!data) {
+        quill_flush_output();
+        quill_fatal("MemoryError: recursion too deep (%lld levels)", (long long)depth);
+    }
+    pending->data = data;
+    pending->cap = cap;
+}
+
+void quill_pending_release(quill_pending* pending) {
+    free(pending->data);
+}
+
+// Lists: a header with a contiguous buffer of unboxed 8-byte elements
+// (double or int64_t). Generated code reads and writes elements inline and
+// only calls in here to allocate, grow, or report a bad index. Lists live
+// until the program exits.
+typedef struct {
+    void* data;
+    int64_t len;
+    int64_t cap;
+} quill_list;
+
+#define QUILL_LIST_MIN_CAPACITY 4
+
+void* quill_list_new(int64_t len, int64_t element_size) {
+    quill_list* list = malloc(sizeof(quill_list));
+    int64_t cap = len > QUILL_LIST_MIN_CAPACITY ? len : QUILL_LIST_MIN_CAPACITY;
+    if (!list) {
+        quill_flush_output();
+        quill_fatal("MemoryError: cannot allocate list");
+    }
+
+    list->data = calloc((size_t)cap, (size_t)element_size);
+    if (!list->data) {
+        quill_flush_output();
+        quill_fatal("MemoryError: cannot allocate list of %lld elements", (long long)len);
+    }
+    list->len = len;
+    list->cap = cap;
+    return list;
+}
+
+void quill_list_grow(void* handle, int64_t element_size) {
+    quill_list* list = (quill_list*)handle;
+    int64_t cap = list->cap * 2;
+    void* data = realloc(list->data, (size_t)cap * (size_t)element_size);
+    if (!data) {
+        quill_flush_output();
+        quill_fatal("MemoryError: cannot grow list to %lld elements", (long long)cap);
+    }
+    list->data = data;
+    list->cap = cap;
+}
+
+void quill_index_error(int64_t index, int64_t len) {
+    quill_flush_output();
+    quill_fatal("IndexError: list index %lld out of range for list of length %lld",
+                (long long)index, (long long)len);
+}
+
+void quill_zero_division_error(void) {
+    quill_flush_output();
+    quill_fatal("ZeroDivisionError: integer modulo by zero");
+}
+
+// Parallel for. Generated code outlines a loop body into a function that
+// runs iterations [begin, end) and folds its reductions into `partials`,
+// one 64-bit word per reduction. The iteration space is cut into chunks
+// that depend only on the trip count, and each chunk has its own partials,
+// combined in chunk order once all iterations are done. Floating-point
+// sums are therefore the same on every run, whichever thread ran a chunk.
+// A persistent pool of workers executes the chunks with work stealing:
+// every worker owns a contiguous range of chunks, takes them from its
+// front, and when it runs dry steals the back half of another worker's
+// range. The body has type quill_parallel_body.
+
+// Reduction operators; must match ParallelReduction in src/ast.cpp
+enum quill_reduction_op {
+    QUILL_REDUCE_ADD_F64 = 0,
+    QUILL_REDUCE_MIN_F64 = 1,
+    QUILL_REDUCE_MAX_F64 = 2,
+    QUILL_REDUCE_ADD_I64 = 3,
+    QUILL_REDUCE_MIN_I64 = 4,
+    QUILL_REDUCE_MAX_I64 = 5,
+};
+
+#define QUILL_MAX_WORKERS 256
+#define QUILL_CHUNKS_PER_WORKER 16
+#define QUILL_MAX_CHUNKS (QUILL_MAX_WORKERS * QUILL_CHUNKS_PER_WORKER)
+
+typedef struct {
+    pthread_mutex_t lock;
+    int64_t begin;    // owner takes chunks from here
+    int64_t end;      // thieves take halves from here
+} __attribute__((aligned(64))) quill_worker_range;
+
+typedef struct {
+    quill_parallel_body body;
+    void* env;
+    int64_t count;
+    int64_t chunks;
+    int num_reductions;
+    int64_t* partials;    // chunks rows of num_reductions words
+} quill_parallel_job;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t finish;
+    int num_workers;              // including the calling thread
+    unsigned long generation;     // bumped for every job
+    int running;                  // helper threads still working on the job
+    quill_parallel_job* job;
+    quill_worker_range ranges[QUILL_MAX_WORKERS];
+} quill_pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .start = PTHREAD_COND_INITIALIZER,
+    .finish = PTHREAD_COND_INITIALIZER,
+};
+
+static pthread_once_t quill_pool_once = PTHREAD_ONCE_INIT;
+
+// Set while a job owns the pool; parallel loops started meanwhile (nested
+// inside a body, or from another thread) run serially on their caller
+static int quill_pool_busy;
+
+// First iteration of a chunk; chunk sizes differ by at most one
+static int64_t quill_chunk_begin(int64_t count, int64_t chunks, int64_t chunk) {
+    int64_t size = count / chunks;
+    int64_t extra = count % chunks;
+    return size * chunk + (chunk < extra ? chunk : extra);
+}
+
+static int quill_take_chunk(quill_worker_range* range, int64_t* chunk) {
+    pthread_mutex_lock(&range->lock);
+    int found = range->begin < range->end;
+    if (found) {
+        *chunk = range->begin++;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return found;
+}
+
+static int quill_steal(int self, int64_t* begin, int64_t* end) {
+    for (int i = 1; i < quill_pool.num_workers; i++) {
+        quill_worker_range* victim = &quill_pool.ranges[(self + i) % quill_pool.num_workers];
+        pthread_mutex_lock(&victim->lock);
+        int64_t remaining = victim->end - victim->begin;
+        if (remaining > 0) {
+            *end = victim->end;
+            *begin = victim->end - (remaining + 1) / 2;
+            victim->end = *begin;
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (remaining > 0) return 1;
+    }
+    return 0;
+}
+
+static void quill_run_worker(int self, quill_parallel_job* job) {
+    quill_worker_range* own = &quill_pool.ranges[self];
+    int64_t chunk;
+
+    for (;;) {
+        if (!quill_take_chunk(own, &chunk)) {
+            int64_t stolen_begin, stolen_end;
+            if (!quill_steal(self, &stolen_begin, &stolen_end)) return;
+
+            // Keep the stolen range in our own slot so others can steal back
+            pthread_mutex_lock(&own->lock);
+            own->begin = stolen_begin;
+            own->end = stolen_end;
+            pthread_mutex_unlock(&own->lock);
+            continue;
+        }
+        job->body(job->env, quill_chunk_begin(job->count, job->chunks, chunk),
+                  quill_chunk_begin(job->count, job->chunks, chunk + 1),
+                  job->partials + (size_t)chunk * job->num_reductions);
+    }
+}
+
+static void* quill_worker_main(void* arg) {
+    int self = (int)(intptr_t)arg;
+    unsigned long seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&quill_pool.lock);
+        while (quill_pool.generation == seen) {
+            pthread_cond_wait(&quill_pool.start, &quill_pool.lock);
+        }
+        seen = quill_pool.generation;
+        quill_parallel_job* job = quill_pool.job;
+        pthread_mutex_unlock(&quill_pool.lock);
+
+        quill_run_worker(self, job);
+        quill_flush_output();
+
+        pthread_mutex_lock(&quill_pool.lock);
+        if (--quill_pool.running == 0) {
+            pthread_cond_signal(&quill_pool.finish);
+        }
+        pthread_mutex_unlock(&quill_pool.lock);
+    }
+    return NULL;
+}
+
+static void quill_pool_init(void) {
+    long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    const char* requested = getenv("QUILL_NUM_THREADS");
+    if (requested && atol(requested) > 0) workers = atol(requested);
+    if (workers < 1) workers = 1;
+    if (workers > QUILL_MAX_WORKERS) workers = QUILL_MAX_WORKERS;
+
+    quill_pool.num_workers = 1;
+    pthread_mutex_init(&quill_pool.ranges[0].lock, NULL);
+    for (int i = 1; i < workers; i++) {
+        pthread_mutex_init(&quill_pool.ranges[i].lock, NULL);
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, quill_worker_main, (void*)(intptr_t)i) != 0) break;
+        pthread_detach(thread);
+        quill_pool.num_workers++;
+    }
+}
+
+static void quill_reduction_identity(const int32_t* ops, const int64_t* values, int count, int64_t* partials) {
+    for (int r = 0; r < count; r++) {
+        // min and max start from the incoming value; sums from zero
+        int is_sum = ops[r] == QUILL_REDUCE_ADD_F64 || ops[r] == QUILL_REDUCE_ADD_I64;
+        partials[r] = is_sum ? 0 : values[r];
+    }
+}
+
+static void quill_reduction_combine(const int32_t* ops, const int64_t* partials, int count, int64_t* values) {
+    for (int r = 0; r < count; r++) {
+        double a, b;
+        memcpy(&a, &values[r], sizeof a);
+        memcpy(&b, &partials[r], sizeof b);
+        switch (ops[r]) {
+            case QUILL_REDUCE_ADD_F64: a += b; break;
+            case QUILL_REDUCE_MIN_F64: if (b < a) a = b; break;
+            case QUILL_REDUCE_MAX_F64: if (b > a) a = b; break;
+            case QUILL_REDUCE_ADD_I64: values[r] = (int64_t)((uint64_t)values[r] + (uint64_t)partials[r]); continue;
+            case QUILL_REDUCE_MIN_I64: if (partials[r] < values[r]) values[r] = partials[r]; continue;
+            case QUILL_REDUCE_MAX_I64: if (partials[r] > values[r]) values[r] = partials[r]; continue;
+        }
+        memcpy(&values[r], &a, sizeof a);
+    }
+}
+
+void quill_parallel_for(int64_t count, quill_parallel_body body, void* env,
+                        int32_t num_reductions, const int32_t* ops, int64_t* values) {
+    if (count <= 0) return;
+    pthread_once(&quill_pool_once, quill_pool_init);
+
+    int64_t chunks = count < QUILL_MAX_CHUNKS ? count : QUILL_MAX_CHUNKS;
+    int workers = quill_pool.num_workers;
+    if (workers == 1 || count == 1 || __atomic_exchange_n(&quill_pool_busy, 1, __ATOMIC_ACQUIRE)) {
+        // The same chunks in the same order as the pool, so the result matches
+        int64_t identity[num_reductions > 0 ? num_reductions : 1];
+        int64_t partials[num_reductions > 0 ? num_reductions : 1];
+        quill_reduction_identity(ops, values, num_reductions, identity);
+        for (int64_t chunk = 0; chunk < chunks; chunk++) {
+            memcpy(partials, identity, sizeof(int64_t) * (size_t)num_reductions);
+            body(env, quill_chunk_begin(count, chunks, chunk), quill_chunk_begin(count, chunks, chunk + 1), partials);
+            quill_reduction_combine(ops, partials, num_reductions, values);
+        }
+        return;
+    }
+
+    if (chunks < workers) workers = (int)chunks;
+    int64_t* partials = malloc(sizeof(int64_t) * (size_t)chunks * (num_reductions > 0 ? num_reductions : 1));
+    if (!partials) {
+        quill_flush_output();
+        quill_fatal("MemoryError: cannot allocate parallel reductions");
+    }
+    for (int64_t chunk = 0; chunk < chunks; chunk++) {
+        quill_reduction_identity(ops, values, num_reductions, partials + (size_t)chunk * num_reductions);
+    }
+
+    quill_parallel_job job = {body, env, count, chunks, num_reductions, partials};
+
+    // Even initial split; workers beyond the chunk count start empty and steal
+    for (int w = 0; w < quill_pool.num_workers; w++) {
+        quill_worker_range* range = &quill_pool.ranges[w];
+        pthread_mutex_lock(&range->lock);
+        range->begin = w < workers ? chunks * w / workers : chunks;
+        range->end = w < workers ? chunks * (w + 1) / workers : chunks;
+        pthread_mutex_unlock(&range->lock);
+    }
+
+    // Output printed before the loop must not trail the workers' output
+    quill_flush_output();
+
+    pthread_mutex_lock(&quill_pool.lock);
+    quill_pool.job = &job;
+    quill_pool.running = quill_pool.num_workers - 1;
+    quill_pool.generation++;
+    pthread_cond_broadcast(&quill_pool.start);
+    pthread_mutex_unlock(&quill_pool.lock);
+
+    quill_run_worker(0, &job);
+
+    pthread_mutex_lock(&quill_pool.lock);
+    while (quill_pool.running > 0) {
+        pthread_cond_wait(&quill_pool.finish, &quill_pool.lock);
+    }
+    pthread_mutex_unlock(&quill_pool.lock);
+
+    for (int64_t chunk = 0; chunk < chunks; chunk++) {
+        quill_reduction_combine(ops, partials + (size_t)chunk * num_reductions, num_reductions, values);
     }
-}
\ No newline at end of file
+    free(partials);
+    __atomic_store_n(&quill_pool_busy, 0, __ATOMIC_RELEASE);
+}
@@ -1,19 +1,377 @@
 #include "ast.h"
 #include "codegen.h"
+#include "builtins.h"
+#include <llvm/Analysis/ConstantFolding.h>
 #include <llvm/IR/Value.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Function.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Support/TimeProfiler.h>
 #include <iostream>
+#include <map>
+#include <set>
+
+// Width for an integer binary operation, or nullptr when range analysis cannot
+// prove every operand and result is an exactly representable integer.
+static llvm::IntegerType* integer_operation_type(CodeGen& gen, const BinaryExprAST* expr) {
+    if (!gen.narrow_integers) return nullptr;
+    if (expr->op == '/' || expr->op == '&' || expr->op == '|') return nullptr;
+    
+    const quill::ValueRange* lhs_range = gen.expression_range(expr->lhs.get());
+    const quill::ValueRange* rhs_range = gen.expression_range(expr->rhs.get());
+    const quill::ValueRange* result_range = gen.expression_range(expr);
+    if (!lhs_range || !rhs_range || !result_range) return nullptr;
+    if (!lhs_range->isExactInteger() || !rhs_range->isExactInteger() ||
+        !result_range->isExactInteger()) {
+        return nullptr;
+    }
+    
+    quill::ValueRange span = lhs_range->join(*rhs_range).join(*result_range);
+    return gen.integer_type_for(span);
+}
+
+// Declared ints compute in wrapping 64-bit integer arithmetic
+static bool is_native_integer_operation(CodeGen& gen, const BinaryExprAST* expr) {
+    if (expr->op == '/' || expr->op == '&' || expr->op == '|') return false;
+    
+    const quill::ValueRange* lhs_range = gen.expression_range(expr->lhs.get());
+    const quill::ValueRange* rhs_range = gen.expression_range(expr->rhs.get());
+    if (!lhs_range || !rhs_range) return false;
+    
+    return lhs_range->integral && rhs_range->integral && !lhs_range->nan && !rhs_range->nan &&
+           (lhs_range->native_int || rhs_range->native_int);
+}
+
+static llvm::Value* codegen_integer_binary(CodeGen& gen, const BinaryExprAST* expr,
+                                           llvm::Value* l, llvm::Value* r,
+                                           llvm::IntegerType* int_type, bool no_wrap) {
+    l = gen.to_integer(l, int_type);
+    r = gen.to_integer(r, int_type);
+    llvm::Type* double_type = llvm::Type::getDoubleTy(*gen.context);
+    
+    // When operands and results are proven in range no operation can wrap
+    switch (expr->op) {
+        case '+':
+            return gen.builder->CreateAdd(l, r, "addtmp", false, no_wrap);
+        case '-':
+            return gen.builder->CreateSub(l, r, "subtmp", false, no_wrap);
+        case '*':
+            return gen.builder->CreateMul(l, r, "multmp", false, no_wrap);
+        case '%': {
+            const quill::ValueRange* lhs_range = gen.expression_range(expr->lhs.get());
+            const quill::ValueRange* rhs_range = gen.expression_range(expr->rhs.get());
+            if (lhs_range && rhs_range && lhs_range->lo >= 0 && rhs_range->lo > 0) {
+                return gen.builder->CreateURem(l, r, "remtmp");
+            }
+            // srem is undefined for a zero divisor and for INT64_MIN % -1.
+            // A zero divisor raises like a bad index; x % -1 is x % 1, zero.
+            if (!rhs_range || rhs_range->contains(0.0)) {
+                llvm::Value* nonzero = gen.builder->CreateICmpNE(r, llvm::ConstantInt::get(int_type, 0), "nonzero");
+                llvm::Function* function = gen.builder->GetInsertBlock()->getParent();
+                llvm::BasicBlock* ok_bb = llvm::BasicBlock::Create(*gen.context, "rem.ok", function);
+                llvm::BasicBlock* fail_bb = llvm::BasicBlock::Create(*gen.context, "rem.fail", function);
+                
+                llvm::MDNode* weights = llvm::MDBuilder(*gen.context).createBranchWeights(1 << 20, 1);
+                gen.builder->CreateCondBr(nonzero, ok_bb, fail_bb, weights);
+                
+                gen.builder->SetInsertPoint(fail_bb);
+                gen.builder->CreateCall(gen.get_zero_division_error_function());
+                gen.builder->CreateUnreachable();
+                
+                gen.builder->SetInsertPoint(ok_bb);
+            }
+            if (!rhs_range || rhs_range->contains(-1.0)) {
+                llvm::Value* minus_one = gen.builder->CreateICmpEQ(r, llvm::ConstantInt::getSigned(int_type, -1),
+                                                                   "minusone");
+                r = gen.builder->CreateSelect(minus_one, llvm::ConstantInt::get(int_type, 1), r, "divisor");
+            }
+            return gen.builder->CreateSRem(l, r, "remtmp");
+        }
+        case '<':
+            l = gen.builder->CreateICmpSLT(l, r, "cmptmp");
+            return gen.builder->CreateUIToFP(l, double_type, "booltmp");
+        case 'L': // <=
+            l = gen.builder->CreateICmpSLE(l, r, "cmptmp");
+            return gen.builder->CreateUIToFP(l, double_type, "booltmp");
+        case '>':
+            l = gen.builder->CreateICmpSGT(l, r, "cmptmp");
+            return gen.builder->CreateUIToFP(l, double_type, "booltmp");
+        case 'G': // >=
+            l = gen.builder->CreateICmpSGE(l, r, "cmptmp");
+            return gen.builder->CreateUIToFP(l, double_type, "booltmp");
+        case '=': // ==
+            l = gen.builder->CreateICmpEQ(l, r, "cmptmp");
+            return gen.builder->CreateUIToFP(l, double_type, "booltmp");
+        case '!': // !=
+            l = gen.builder->CreateICmpNE(l, r, "cmptmp");
+            return gen.builder->CreateUIToFP(l, double_type, "booltmp");
+        default:
+            return nullptr;
+    }
+}
+
+// Address of a field of a list header: 0 = elements, 1 = length, 2 = capacity
+static llvm::Value* list_field(CodeGen& gen, llvm::Value* list, llvm::Type* element_type,
+                               unsigned field, const char* name) {
+    return gen.builder->CreateStructGEP(gen.list_type(element_type), list, field, name);
+}
+
+template <typename AccessInst>
+static AccessInst* tag_list_access(CodeGen& gen, AccessInst* access, const std::string& kind) {
+    access->setMetadata(llvm::LLVMContext::MD_tbaa, gen.list_access_tag(kind));
+    return access;
+}
+
+static const char* element_kind(llvm::Type* element_type) {
+    return element_type->isDoubleTy() ? "f64" : "i64";
+}
+
+static llvm::Value* load_list_length(CodeGen& gen, llvm::Value* list, llvm::Type* element_type) {
+    return tag_list_access(gen, gen.builder->CreateLoad(llvm::Type::getInt64Ty(*gen.context),
+                                                        list_field(gen, list, element_type, 1, "lenptr"), "len"),
+                           "length");
+}
+
+static llvm::Value* load_list_elements(CodeGen& gen, llvm::Value* list, llvm::Type* element_type) {
+    return tag_list_access(gen, gen.builder->CreateLoad(llvm::PointerType::getUnqual(element_type),
+                                                        list_field(gen, list, element_type, 0, "elemsptr"), "elems"),
+                           "elements");
+}
+
+// Address of list[index], bounds checked unless range analysis proved the
+// access safe. The failure path is a cold noreturn call, so the check is a
+// single well-predicted compare and branch the optimizer can hoist.
+static llvm::Value* element_address(CodeGen& gen, IndexExprAST* expr, llvm::Type*& element_type) {
+    element_type = gen.list_element_type(expr->list.get());
+    if (!element_type) {
+        return gen.log_error_v("Only lists can be indexed");
+    }
+    
+    llvm::Value* list = expr->list->codegen(gen);
+    llvm::Value* index = expr->index->codegen(gen);
+    if (!list || !index) return nullptr;
+    
+    bool proven_safe = gen.elide_bounds_checks && gen.range_info && gen.range_info->isIndexSafe(expr);
+    llvm::IntegerType* int64_type = llvm::Type::getInt64Ty(*gen.context);
+    if (!proven_safe && index->getType()->isFloatingPointTy()) {
+        // fptosi of NaN or of a double beyond i64 is poison, which the check
+        // cannot reject; saturate instead and send NaN to -1, out of bounds
+        llvm::Value* saturated = gen.builder->CreateIntrinsic(llvm::Intrinsic::fptosi_sat,
+                                                              {int64_type, index->getType()}, {index},
+                                                              nullptr, "fptoi");
+        llvm::Value* is_number = gen.builder->CreateFCmpORD(index, index, "isnumber");
+        index = gen.builder->CreateSelect(is_number, saturated, llvm::ConstantInt::getSigned(int64_type, -1),
+                                          "index");
+    } else {
+        index = gen.to_integer(index, int64_type);
+        if (!index) return nullptr;
+    }
+    
+    if (!proven_safe) {
+        // Unsigned compare also rejects negative indices
+        llvm::Value* length = load_list_length(gen, list, element_type);
+        llvm::Value* in_bounds = gen.builder->CreateICmpULT(index, length, "inbounds");
+        
+        llvm::Function* function = gen.builder->GetInsertBlock()->getParent();
+        llvm::BasicBlock* ok_bb = llvm::BasicBlock::Create(*gen.context, "index.ok", function);
+        llvm::BasicBlock* fail_bb = llvm::BasicBlock::Create(*gen.context, "index.fail", function);
+        
+        llvm::MDNode* weights = llvm::MDBuilder(*gen.context).createBranchWeights(1 << 20, 1);
+        gen.builder->CreateCondBr(in_bounds, ok_bb, fail_bb, weights);
+        
+        gen.builder->SetInsertPoint(fail_bb);
+        gen.builder->CreateCall(gen.get_index_error_function(), {index, length});
+        gen.builder->CreateUnreachable();
+        
+        gen.builder->SetInsertPoint(ok_bb);
+    }
+    
+    llvm::Value* elements = load_list_elements(gen, list, element_type);
+    return gen.builder->CreateInBoundsGEP(element_type, elements, index, "elemptr");
+}
+
+// len(xs) and append(xs, value), unless the program defines its own
+static llvm::Value* codegen_list_builtin(CodeGen& gen, CallExprAST* expr) {
+    size_t expected_args = expr->callee == "len" ? 1 : 2;
+    if (expr->args.size() != expected_args) {
+        return gen.log_error_v("Incorrect number of arguments passed");
+    }
+    
+    llvm::Type* element_type = gen.list_element_type(expr->args[0].get());
+    if (!element_type) {
+        return gen.log_error_v((expr->callee + " expects a list").c_str());
+    }
+    
+    llvm::Value* list = expr->args[0]->codegen(gen);
+    if (!list) return nullptr;
+    
+    if (expr->callee == "len") {
+        return load_list_length(gen, list, element_type);
+    }
+    
+    llvm::Value* value = expr->args[1]->codegen(gen);
+    if (!value) return nullptr;
+    value = gen.convert_operand(expr->args[1].get(), value, element_type, nullptr);
+    if (!value) return nullptr;
+    
+    // Grow in the runtime only when full; the common case is a store
+    llvm::Value* length_ptr = list_field(gen, list, element_type, 1, "lenptr");
+    llvm::Value* length = tag_list_access(gen, gen.builder->CreateLoad(llvm::Type::getInt64Ty(*gen.context),
+                                                                       length_ptr, "len"), "length");
+    llvm::Value* capacity = tag_list_access(gen, gen.builder->CreateLoad(llvm::Type::getInt64Ty(*gen.context),
+                                                    list_field(gen, list, element_type, 2, "capptr"), "cap"),
+                                            "capacity");
+    
+    llvm::Function* function = gen.builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock* grow_bb = llvm::BasicBlock::Create(*gen.context, "append.grow", function);
+    llvm::BasicBlock* store_bb = llvm::BasicBlock::Create(*gen.context, "append.store", function);
+    
+    llvm::Value* full = gen.builder->CreateICmpUGE(length, capacity, "full");
+    gen.builder->CreateCondBr(full, grow_bb, store_bb);
+    
+    gen.builder->SetInsertPoint(grow_bb);
+    llvm::Type* byte_ptr_type = llvm::PointerType::getUnqual(llvm::Type::getInt8Ty(*gen.context));
+    gen.builder->CreateCall(gen.get_list_grow_function(),
+                            {gen.builder->CreatePointerCast(list, byte_ptr_type),
+                             llvm::ConstantInt::get(llvm::Type::getInt64Ty(*gen.context), 8)});
+    gen.builder->CreateBr(store_bb);
+    
+    gen.builder->SetInsertPoint(store_bb);
+    llvm::Value* elements = load_list_elements(gen, list, element_type);
+    tag_list_access(gen, gen.builder->CreateStore(value, gen.builder->CreateInBoundsGEP(element_type, elements,
+                                                                                        length, "elemptr")),
+                    element_kind(element_type));
+    tag_list_access(gen, gen.builder->CreateStore(gen.builder->CreateNUWAdd(length,
+                                                      llvm::ConstantInt::get(length->getType(), 1)), length_ptr),
+                    "length");
+    
+    // Like assignment, the statement's value is the value stored
+    return value;
+}
+
+// True when a builtin's operands should be combined as integers: both are
+// ints, or range analysis proved them integral with at least one native int
+static bool integer_operands(CodeGen& gen, CallExprAST* expr, const std::vector<llvm::Value*>& args, bool& native) {
+    native = true;
+    bool all_ints = true;
+    bool any_native = false;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const quill::ValueRange* range = gen.expression_range(expr->args[i].get());
+        native = native && range && range->integral && !range->nan;
+        any_native = any_native || (range && range->native_int);
+        all_ints = all_ints && args[i]->getType()->isIntegerTy();
+    }
+    native = native && any_native;
+    return native || all_ints;
+}
+
+// Integer type for integer operands: i64 for native ints, else their shared width
+static llvm::IntegerType* operand_int_type(CodeGen& gen, const std::vector<llvm::Value*>& args, bool native) {
+    llvm::Type* type = args[0]->getType();
+    for (llvm::Value* arg : args) {
+        if (arg->getType() != type) native = true;
+    }
+    if (native || !type->isIntegerTy()) return llvm::Type::getInt64Ty(*gen.context);
+    return llvm::cast<llvm::IntegerType>(type);
+}
+
+// min(a, b) and max(a, b) as compare and select. Ties and NaNs keep the
+// first argument, as in Python; ints stay ints.
+static llvm::Value* codegen_min_max(CodeGen& gen, CallExprAST* expr, std::vector<llvm::Value*> args) {
+    bool is_min = expr->callee == "min";
+    bool native;
+    llvm::Value* pick_b;
+    if (integer_operands(gen, expr, args, native)) {
+        llvm::IntegerType* int_type = operand_int_type(gen, args, native);
+        for (llvm::Value*& arg : args) {
+            arg = gen.to_integer(arg, int_type);
+            if (!arg) return nullptr;
+        }
+        pick_b = is_min ? gen.builder->CreateICmpSLT(args[1], args[0]) : gen.builder->CreateICmpSGT(args[1], args[0]);
+    } else {
+        for (llvm::Value*& arg : args) {
+            arg = gen.to_double(arg);
+        }
+        pick_b = is_min ? gen.builder->CreateFCmpOLT(args[1], args[0]) : gen.builder->CreateFCmpOGT(args[1], args[0]);
+    }
+    return gen.builder->CreateSelect(pick_b, args[1], args[0], expr->callee);
+}
+
+static llvm::Intrinsic::ID math_intrinsic(const std::string& name) {
+    if (name == "sqrt") return llvm::Intrinsic::sqrt;
+    if (name == "abs") return llvm::Intrinsic::fabs;
+    if (name == "exp") return llvm::Intrinsic::exp;
+    if (name == "log") return llvm::Intrinsic::log;
+    if (name == "pow") return llvm::Intrinsic::pow;
+    if (name == "floor") return llvm::Intrinsic::floor;
+    if (name == "fma") return llvm::Intrinsic::fma;
+    return llvm::Intrinsic::not_intrinsic;
+}
+
+// Math builtins lower to LLVM intrinsics, which the optimizer understands
+// (llvm.sqrt.f64 rather than an opaque call to sqrt). Calls with constant
+// arguments fold at compile time, so sqrt(252) costs nothing even at -O0.
+static llvm::Value* codegen_math_builtin(CodeGen& gen, CallExprAST* expr, const quill::MathBuiltin& builtin) {
+    if (expr->args.size() != builtin.arity) {
+        return gen.log_error_v("Incorrect number of arguments passed");
+    }
+    
+    std::vector<llvm::Value*> args;
+    for (auto& arg : expr->args) {
+        llvm::Value* val = arg->codegen(gen);
+        if (!val) return nullptr;
+        if (val->getType()->isPointerTy()) {
+            return gen.log_error_v((expr->callee + " expects numbers").c_str());
+        }
+        args.push_back(val);
+    }
+    
+    if (expr->callee == "min" || expr->callee == "max") {
+        return codegen_min_max(gen, expr, args);
+    }
+    
+    llvm::Type* type = llvm::Type::getDoubleTy(*gen.context);
+    llvm::Intrinsic::ID id = math_intrinsic(expr->callee);
+    bool native;
+    if (expr->callee == "abs" && integer_operands(gen, expr, args, native)) {
+        // INT_MIN wraps to itself rather than being poison
+        type = operand_int_type(gen, args, native);
+        args[0] = gen.to_integer(args[0], llvm::cast<llvm::IntegerType>(type));
+        if (!args[0]) return nullptr;
+        args.push_back(llvm::ConstantInt::getFalse(*gen.context));
+        id = llvm::Intrinsic::abs;
+    } else {
+        for (llvm::Value*& arg : args) {
+            arg = gen.to_double(arg);
+        }
+    }
+    
+    llvm::CallInst* call = gen.builder->CreateIntrinsic(id, {type}, args, nullptr, expr->callee);
+    
+    std::vector<llvm::Constant*> constants;
+    for (llvm::Value* arg : args) {
+        if (auto constant = llvm::dyn_cast<llvm::Constant>(arg)) constants.push_back(constant);
+    }
+    if (constants.size() == args.size()) {
+        llvm::Function* intrinsic = call->getCalledFunction();
+        if (llvm::Constant* folded = llvm::ConstantFoldCall(call, intrinsic, constants)) {
+            call->eraseFromParent();
+            if (intrinsic->use_empty()) intrinsic->eraseFromParent();
+            return folded;
+        }
+    }
+    return call;
+}
 
 llvm::Value* NumberExprAST::codegen(CodeGen& gen) {
     return llvm::ConstantFP::get(*gen.context, llvm::APFloat(value));
 }
 
 llvm::Value* StringExprAST::codegen(CodeGen& gen) {
-    return gen.builder->CreateGlobalString(value);
+    return gen.string_constant(value);
 }
 
 llvm::Value* VariableExprAST::codegen(CodeGen& gen) {
@@ -22,15 +380,35 @@ llvm::Value* VariableExprAST::codegen(CodeGen& gen) {
         return gen.log_error_v(("Unknown variable name: " + name).c_str());
     }
     
-    return gen.builder->CreateLoad(alloca->getAllocatedType(), alloca, name.c_str());
+    return gen.annotate_range(gen.builder->CreateLoad(alloca->getAllocatedType(), alloca, name.c_str()), this);
 }
 
-llvm::Value* BinaryExprAST::codegen(CodeGen& gen) {
-    llvm::Value* l = lhs->codegen(gen);
-    llvm::Value* r = rhs->codegen(gen);
+static llvm::Value* codegen_binary(CodeGen& gen, BinaryExprAST* expr) {
+    llvm::Value* l = expr->lhs->codegen(gen);
+    llvm::Value* r = expr->rhs->codegen(gen);
     if (!l || !r) return nullptr;
+    if (l->getType()->isPointerTy() || r->getType()->isPointerTy()) {
+        return gen.log_error_v("Operators apply to numbers only");
+    }
+    
+    // Integer fast path when range analysis proves exact integer values
+    if (llvm::IntegerType* int_type = integer_operation_type(gen, expr)) {
+        if (llvm::Value* result = codegen_integer_binary(gen, expr, l, r, int_type, true)) {
+            return result;
+        }
+    }
+    
+    if (is_native_integer_operation(gen, expr)) {
+        llvm::IntegerType* int64_type = llvm::Type::getInt64Ty(*gen.context);
+        if (llvm::Value* result = codegen_integer_binary(gen, expr, l, r, int64_type, false)) {
+            return result;
+        }
+    }
+    
+    l = gen.to_double(l);
+    r = gen.to_double(r);
     
-    switch (op) {
+    switch (expr->op) {
         case '+':
             return gen.builder->CreateFAdd(l, r, "addtmp");
         case '-':
@@ -74,11 +452,34 @@ llvm::Value* BinaryExprAST::codegen(CodeGen& gen) {
     }
 }
 
-llvm::Value* UnaryExprAST::codegen(CodeGen& gen) {
-    llvm::Value* operand_val = operand->codegen(gen);
+llvm::Value* BinaryExprAST::codegen(CodeGen& gen) {
+    return gen.annotate_range(codegen_binary(gen, this), this);
+}
+
+static llvm::Value* codegen_unary(CodeGen& gen, UnaryExprAST* expr) {
+    llvm::Value* operand_val = expr->operand->codegen(gen);
     if (!operand_val) return nullptr;
+    if (operand_val->getType()->isPointerTy()) {
+        return gen.log_error_v("Operators apply to numbers only");
+    }
+    
+    if (expr->op == '-' && operand_val->getType()->isIntegerTy()) {
+        const quill::ValueRange* range = gen.expression_range(expr);
+        const quill::ValueRange* operand_range = gen.expression_range(expr->operand.get());
+        if (gen.narrow_integers && range && operand_range &&
+            range->isExactInteger() && operand_range->isExactInteger()) {
+            llvm::IntegerType* int_type = gen.integer_type_for(range->join(*operand_range));
+            return gen.builder->CreateNSWNeg(gen.to_integer(operand_val, int_type), "negtmp");
+        }
+        if (range && range->native_int) {
+            llvm::IntegerType* int64_type = llvm::Type::getInt64Ty(*gen.context);
+            return gen.builder->CreateNeg(gen.to_integer(operand_val, int64_type), "negtmp");
+        }
+    }
+    
+    operand_val = gen.to_double(operand_val);
     
-    switch (op) {
+    switch (expr->op) {
         case '-':
             return gen.builder->CreateFNeg(operand_val, "negtmp");
         case '!': // not
@@ -90,8 +491,19 @@ llvm::Value* UnaryExprAST::codegen(CodeGen& gen) {
     }
 }
 
+llvm::Value* UnaryExprAST::codegen(CodeGen& gen) {
+    return gen.annotate_range(codegen_unary(gen, this), this);
+}
+
 llvm::Value* CallExprAST::codegen(CodeGen& gen) {
     llvm::Function* callee_func = gen.module->getFunction(callee);
+    if (!callee_func && (callee == "len" || callee == "append")) {
+        return gen.annotate_range(codegen_list_builtin(gen, this), this);
+    }
+    const quill::MathBuiltin* builtin = callee_func ? nullptr : quill::findMathBuiltin(callee);
+    if (builtin) {
+        return gen.annotate_range(codegen_math_builtin(gen, this, *builtin), this);
+    }
     if (!callee_func) {
         return gen.log_error_v(("Unknown function referenced: " + callee).c_str());
     }
@@ -100,13 +512,23 @@ llvm::Value* CallExprAST::codegen(CodeGen& gen) {
         return gen.log_error_v("Incorrect number of arguments passed");
     }
     
+    auto decl = gen.function_decls.find(callee);
     std::vector<llvm::Value*> args_v;
-    for (auto& arg : args) {
-        args_v.push_back(arg->codegen(gen));
-        if (!args_v.back()) return nullptr;
+    llvm::FunctionType* callee_type = callee_func->getFunctionType();
+    for (size_t i = 0; i < args.size(); ++i) {
+        llvm::Value* arg_val = args[i]->codegen(gen);
+        if (!arg_val) return nullptr;
+        
+        llvm::Type* element_type = nullptr;
+        if (decl != gen.function_decls.end()) {
+            element_type = gen.annotation_element_type(decl->second->getArgAnnotation(i));
+        }
+        arg_val = gen.convert_operand(args[i].get(), arg_val, callee_type->getParamType(i), element_type);
+        if (!arg_val) return nullptr;
+        args_v.push_back(arg_val);
     }
     
-    return gen.builder->CreateCall(callee_func, args_v, "calltmp");
+    return gen.annotate_range(gen.builder->CreateCall(callee_func, args_v, "calltmp"), this);
 }
 
 llvm::Value* AssignmentStmtAST::codegen(CodeGen& gen) {
@@ -115,15 +537,89 @@ llvm::Value* AssignmentStmtAST::codegen(CodeGen& gen) {
     
     llvm::AllocaInst* alloca = gen.named_values[name];
     if (!alloca) {
-        // Create new variable
-        alloca = gen.create_entry_block_alloca(gen.current_function, name);
+        // Create new variable: a list header or string pointer, or a number
+        // narrowed to an integer when its range allows
+        llvm::Type* var_type = gen.variable_type(name);
+        if (llvm::Type* element_type = gen.list_element_type(value.get())) {
+            var_type = gen.list_pointer_type(element_type);
+            gen.list_elements[name] = element_type;
+        } else if (gen.is_string(value.get())) {
+            var_type = gen.string_pointer_type();
+            gen.string_variables.insert(name);
+        }
+        alloca = gen.create_entry_block_alloca(gen.current_function, name, var_type);
         gen.named_values[name] = alloca;
     }
     
+    if (gen.string_variables.count(name)) {
+        if (!gen.is_string(value.get())) {
+            return gen.log_error_v(("Variable '" + name + "' holds a string").c_str());
+        }
+        gen.builder->CreateStore(val, alloca);
+        return val;
+    }
+    
+    auto element = gen.list_elements.find(name);
+    val = gen.convert_operand(value.get(), val, alloca->getAllocatedType(),
+                              element != gen.list_elements.end() ? element->second : nullptr);
+    if (!val) return nullptr;
     gen.builder->CreateStore(val, alloca);
     return val;
 }
 
+llvm::Value* ListExprAST::codegen(CodeGen& gen) {
+    llvm::Type* element_type = gen.list_element_type(this);
+    
+    std::vector<llvm::Value*> values;
+    for (auto& element : elements) {
+        llvm::Value* val = element->codegen(gen);
+        if (!val) return nullptr;
+        val = gen.convert_operand(element.get(), val, element_type, nullptr);
+        if (!val) return nullptr;
+        values.push_back(val);
+    }
+    
+    // The runtime allocates the header and a buffer of unboxed elements
+    llvm::Type* int64_type = llvm::Type::getInt64Ty(*gen.context);
+    llvm::Value* raw = gen.builder->CreateCall(gen.get_list_new_function(),
+        {llvm::ConstantInt::get(int64_type, values.size()), llvm::ConstantInt::get(int64_type, 8)}, "listraw");
+    llvm::Value* list = gen.builder->CreatePointerCast(raw, gen.list_pointer_type(element_type), "list");
+    
+    if (!values.empty()) {
+        llvm::Value* storage = load_list_elements(gen, list, element_type);
+        for (size_t i = 0; i < values.size(); ++i) {
+            tag_list_access(gen, gen.builder->CreateStore(values[i],
+                                gen.builder->CreateConstInBoundsGEP1_64(element_type, storage, i)),
+                            element_kind(element_type));
+        }
+    }
+    return list;
+}
+
+llvm::Value* IndexExprAST::codegen(CodeGen& gen) {
+    llvm::Type* element_type = nullptr;
+    llvm::Value* address = element_address(gen, this, element_type);
+    if (!address) return nullptr;
+    
+    llvm::LoadInst* element = gen.builder->CreateLoad(element_type, address, "elem");
+    return gen.annotate_range(tag_list_access(gen, element, element_kind(element_type)), this);
+}
+
+llvm::Value* IndexAssignmentStmtAST::codegen(CodeGen& gen) {
+    // Value first, then the target, as in Python
+    llvm::Value* val = value->codegen(gen);
+    if (!val) return nullptr;
+    
+    llvm::Type* element_type = nullptr;
+    llvm::Value* address = element_address(gen, target.get(), element_type);
+    if (!address) return nullptr;
+    
+    val = gen.convert_operand(value.get(), val, element_type, nullptr);
+    if (!val) return nullptr;
+    tag_list_access(gen, gen.builder->CreateStore(val, address), element_kind(element_type));
+    return val;
+}
+
 llvm::Value* ExprStmtAST::codegen(CodeGen& gen) {
     return expression->codegen(gen);
 }
@@ -140,6 +636,8 @@ llvm::Value* BlockStmtAST::codegen(CodeGen& gen) {
 llvm::Value* IfStmtAST::codegen(CodeGen& gen) {
     llvm::Value* cond_val = condition->codegen(gen);
     if (!cond_val) return nullptr;
+    cond_val = gen.to_double(cond_val);
+    if (!cond_val) return nullptr;
     
     // Convert condition to a bool by comparing non-equal to 0.0
     cond_val = gen.builder->CreateFCmpONE(
@@ -209,19 +707,31 @@ llvm::Value* IfStmtAST::codegen(CodeGen& gen) {
 llvm::Value* WhileStmtAST::codegen(CodeGen& gen) {
     llvm::Function* function = gen.builder->GetInsertBlock()->getParent();
     
+    // Test once before entering, so a loop whose condition starts false runs
+    // its body zero times as in Python (this used to emit a do-while, which
+    // always ran the body once). Facts from the condition (like i < len(xs))
+    // then hold throughout the body.
+    llvm::Value* entry_cond = condition->codegen(gen);
+    if (!entry_cond) return nullptr;
+    entry_cond = gen.to_double(entry_cond);
+    if (!entry_cond) return nullptr;
+    entry_cond = gen.builder->CreateFCmpONE(
+        entry_cond, llvm::ConstantFP::get(*gen.context, llvm::APFloat(0.0)), "loopentry");
+    
     llvm::BasicBlock* loop_bb = llvm::BasicBlock::Create(*gen.context, "loop", function);
     llvm::BasicBlock* after_bb = llvm::BasicBlock::Create(*gen.context, "afterloop", function);
     
-    // Fall into the loop.
-    gen.builder->CreateBr(loop_bb);
+    gen.builder->CreateCondBr(entry_cond, loop_bb, after_bb);
     gen.builder->SetInsertPoint(loop_bb);
     
     // Emit the body of the loop.
     if (!body->codegen(gen)) return nullptr;
     
-    // Emit the step value.
+    // Test again before the next iteration.
     llvm::Value* cond_val = condition->codegen(gen);
     if (!cond_val) return nullptr;
+    cond_val = gen.to_double(cond_val);
+    if (!cond_val) return nullptr;
     
     // Convert condition to a bool by comparing non-equal to 0.0.
     cond_val = gen.builder->CreateFCmpONE(
@@ -234,13 +744,421 @@ llvm::Value* WhileStmtAST::codegen(CodeGen& gen) {
     return llvm::Constant::getNullValue(llvm::Type::getDoubleTy(*gen.context));
 }
 
+// Reduction operators quill_parallel_for combines; integer variants follow
+// the floating-point ones (see quill_reduction_op in runtime.c)
+enum ParallelReduction { REDUCE_ADD = 0, REDUCE_MIN = 1, REDUCE_MAX = 2, REDUCE_INTEGER_OFFSET = 3 };
+
+// What a parallel loop body reads, assigns, and does that cannot run concurrently
+struct ParallelBodyUses {
+    std::map<std::string, int> reads;
+    std::map<std::string, std::vector<const AssignmentStmtAST*>> assignments;
+    std::set<std::string> loop_vars;
+    std::set<std::string> appended;
+    bool has_return = false;
+};
+
+static void collect_uses(const ExprAST* expr, ParallelBodyUses& uses) {
+    if (!expr) return;
+    
+    if (auto var = dynamic_cast<const VariableExprAST*>(expr)) {
+        uses.reads[var->name]++;
+    } else if (auto binary = dynamic_cast<const BinaryExprAST*>(expr)) {
+        collect_uses(binary->lhs.get(), uses);
+        collect_uses(binary->rhs.get(), uses);
+    } else if (auto unary = dynamic_cast<const UnaryExprAST*>(expr)) {
+        collect_uses(unary->operand.get(), uses);
+    } else if (auto call = dynamic_cast<const CallExprAST*>(expr)) {
+        for (const auto& arg : call->args) {
+            collect_uses(arg.get(), uses);
+        }
+        auto list = call->args.empty() ? nullptr : dynamic_cast<const VariableExprAST*>(call->args[0].get());
+        if (call->callee == "append" && list) {
+            uses.appended.insert(list->name);
+        }
+    } else if (auto list = dynamic_cast<const ListExprAST*>(expr)) {
+        for (const auto& element : list->elements) {
+            collect_uses(element.get(), uses);
+        }
+    } else if (auto index = dynamic_cast<const IndexExprAST*>(expr)) {
+        collect_uses(index->list.get(), uses);
+        collect_uses(index->index.get(), uses);
+    }
+}
+
+static void collect_uses(const StmtAST* stmt, ParallelBodyUses& uses) {
+    if (!stmt) return;
+    
+    if (auto assign = dynamic_cast<const AssignmentStmtAST*>(stmt)) {
+        uses.assignments[assign->name].push_back(assign);
+        collect_uses(assign->value.get(), uses);
+    } else if (auto index_assign = dynamic_cast<const IndexAssignmentStmtAST*>(stmt)) {
+        collect_uses(index_assign->target.get(), uses);
+        collect_uses(index_assign->value.get(), uses);
+    } else if (auto expr_stmt = dynamic_cast<const ExprStmtAST*>(stmt)) {
+        collect_uses(expr_stmt->expression.get(), uses);
+    } else if (auto block = dynamic_cast<const BlockStmtAST*>(stmt)) {
+        for (const auto& child : block->statements) {
+            collect_uses(child.get(), uses);
+        }
+    } else if (auto if_stmt = dynamic_cast<const IfStmtAST*>(stmt)) {
+        collect_uses(if_stmt->condition.get(), uses);
+        collect_uses(if_stmt->then_stmt.get(), uses);
+        collect_uses(if_stmt->else_stmt.get(), uses);
+    } else if (auto while_stmt = dynamic_cast<const WhileStmtAST*>(stmt)) {
+        collect_uses(while_stmt->condition.get(), uses);
+        collect_uses(while_stmt->body.get(), uses);
+    } else if (auto for_stmt = dynamic_cast<const ForRangeStmtAST*>(stmt)) {
+        uses.loop_vars.insert(for_stmt->var);
+        collect_uses(for_stmt->start.get(), uses);
+        collect_uses(for_stmt->stop.get(), uses);
+        collect_uses(for_stmt->body.get(), uses);
+    } else if (auto ret = dynamic_cast<const ReturnStmtAST*>(stmt)) {
+        uses.has_return = true;
+        collect_uses(ret->value.get(), uses);
+    } else if (auto print = dynamic_cast<const PrintStmtAST*>(stmt)) {
+        collect_uses(print->expression.get(), uses);
+    }
+}
+
+// The reduction an assignment performs: v = v + e, v = e + v, v = v - e,
+// v = min(v, e) or v = max(v, e), with the arguments in either order; -1
+// for anything else
+static int reduction_kind(CodeGen& gen, const AssignmentStmtAST* assign) {
+    auto is_target = [&](const ExprAST* expr) {
+        auto var = dynamic_cast<const VariableExprAST*>(expr);
+        return var && var->name == assign->name;
+    };
+    
+    if (auto binary = dynamic_cast<const BinaryExprAST*>(assign->value.get())) {
+        if (binary->op == '+' && (is_target(binary->lhs.get()) || is_target(binary->rhs.get()))) return REDUCE_ADD;
+        if (binary->op == '-' && is_target(binary->lhs.get())) return REDUCE_ADD;
+    }
+    if (auto call = dynamic_cast<const CallExprAST*>(assign->value.get())) {
+        bool builtin = !gen.module->getFunction(call->callee);
+        if (builtin && call->args.size() == 2 && (is_target(call->args[0].get()) || is_target(call->args[1].get()))) {
+            if (call->callee == "min") return REDUCE_MIN;
+            if (call->callee == "max") return REDUCE_MAX;
+        }
+    }
+    return -1;
+}
+
+// Reductions travel through the runtime as raw 64-bit words
+static llvm::Value* to_reduction_word(CodeGen& gen, llvm::Value* val) {
+    llvm::IntegerType* int64_type = llvm::Type::getInt64Ty(*gen.context);
+    if (val->getType()->isDoubleTy()) return gen.builder->CreateBitCast(val, int64_type);
+    return gen.builder->CreateSExtOrTrunc(val, int64_type);
+}
+
+static llvm::Value* from_reduction_word(CodeGen& gen, llvm::Value* word, llvm::Type* type) {
+    if (type->isDoubleTy()) return gen.builder->CreateBitCast(word, type);
+    return gen.builder->CreateSExtOrTrunc(word, type);
+}
+
+// Parallel for: the body is outlined into `<function>.parallel`, which runs
+// the iterations numbered [begin, end) of the range. quill_parallel_for
+// hands chunks of that space to its workers. Enclosing variables the body
+// reads are copied into an environment struct; each reduction accumulates
+// into a per-worker partial that the runtime combines after the loop.
+static llvm::Value* codegen_parallel_for(CodeGen& gen, ForRangeStmtAST* stmt,
+                                         llvm::Value* start_val, llvm::Value* stop_val) {
+    ParallelBodyUses uses;
+    collect_uses(stmt->body.get(), uses);
+    if (uses.has_return) {
+        return gen.log_error_v("return is not allowed inside a parallel for");
+    }
+    
+    auto is_enclosing = [&](const std::string& name) {
+        auto it = gen.named_values.find(name);
+        return name != stmt->var && it != gen.named_values.end() && it->second;
+    };
+    auto shared_error = [&](const std::string& name) {
+        return gen.log_error_v(("Variable '" + name + "' is shared by all iterations of a parallel for; "
+                                "only v = v + e, v = min(v, e) and v = max(v, e) may update it").c_str());
+    };
+    
+    // Enclosing variables the body updates must be reductions that read
+    // the variable nowhere else
+    std::map<std::string, int> reductions;
+    for (const auto& pair : uses.assignments) {
+        const std::string& name = pair.first;
+        if (!is_enclosing(name)) continue;
+        
+        int kind = reduction_kind(gen, pair.second.front());
+        bool valid = kind >= 0 && !uses.loop_vars.count(name) &&
+                     uses.reads[name] == static_cast<int>(pair.second.size()) &&
+                     !gen.named_values[name]->getAllocatedType()->isPointerTy();
+        for (const AssignmentStmtAST* assign : pair.second) {
+            valid = valid && reduction_kind(gen, assign) == kind;
+        }
+        if (!valid) return shared_error(name);
+        reductions[name] = kind;
+    }
+    for (const std::string& name : uses.loop_vars) {
+        if (is_enclosing(name)) return shared_error(name);
+    }
+    for (const std::string& name : uses.appended) {
+        if (is_enclosing(name)) {
+            return gen.log_error_v(("append() to enclosing list '" + name +
+                                    "' inside a parallel for would race; preallocate it instead").c_str());
+        }
+    }
+    
+    // Everything else the body reads from the enclosing function is captured by value
+    std::vector<std::string> captured;
+    for (const auto& pair : uses.reads) {
+        if (is_enclosing(pair.first) && !reductions.count(pair.first)) {
+            captured.push_back(pair.first);
+        }
+    }
+    
+    llvm::IntegerType* int32_type = llvm::Type::getInt32Ty(*gen.context);
+    llvm::IntegerType* int64_type = llvm::Type::getInt64Ty(*gen.context);
+    llvm::Function* parent = gen.current_function;
+    
+    // ceil(distance / |step|) iterations, none for an empty range
+    llvm::Value* distance = stmt->step > 0 ? gen.builder->CreateSub(stop_val, start_val)
+                                           : gen.builder->CreateSub(start_val, stop_val);
+    long long magnitude = stmt->step > 0 ? stmt->step : -stmt->step;
+    llvm::Value* count = gen.builder->CreateSDiv(
+        gen.builder->CreateAdd(distance, llvm::ConstantInt::get(int64_type, magnitude - 1)),
+        llvm::ConstantInt::get(int64_type, magnitude));
+    count = gen.builder->CreateSelect(gen.builder->CreateICmpSGT(distance, llvm::ConstantInt::get(int64_type, 0)),
+                                      count, llvm::ConstantInt::get(int64_type, 0), "parallel.count");
+    
+    // Environment: the range start, then the captured values
+    std::vector<llvm::Type*> env_fields = {int64_type};
+    for (const std::string& name : captured) {
+        env_fields.push_back(gen.named_values[name]->getAllocatedType());
+    }
+    llvm::StructType* env_type = llvm::StructType::get(*gen.context, env_fields);
+    llvm::AllocaInst* env = gen.create_entry_block_alloca(parent, "parallel.env", env_type);
+    gen.builder->CreateStore(start_val, gen.builder->CreateStructGEP(env_type, env, 0));
+    for (size_t i = 0; i < captured.size(); ++i) {
+        llvm::AllocaInst* alloca = gen.named_values[captured[i]];
+        llvm::Value* val = gen.builder->CreateLoad(alloca->getAllocatedType(), alloca, captured[i]);
+        gen.builder->CreateStore(val, gen.builder->CreateStructGEP(env_type, env, i + 1));
+    }
+    
+    // Reduction operators and the variables' values going in and coming out
+    llvm::Value* ops = llvm::ConstantPointerNull::get(llvm::PointerType::getUnqual(int32_type));
+    llvm::Value* values = llvm::ConstantPointerNull::get(llvm::PointerType::getUnqual(int64_type));
+    if (!reductions.empty()) {
+        std::vector<llvm::Constant*> op_codes;
+        for (const auto& pair : reductions) {
+            bool integer = gen.named_values[pair.first]->getAllocatedType()->isIntegerTy();
+            op_codes.push_back(llvm::ConstantInt::get(int32_type,
+                                                      pair.second + (integer ? REDUCE_INTEGER_OFFSET : 0)));
+        }
+        llvm::ArrayType* ops_type = llvm::ArrayType::get(int32_type, op_codes.size());
+        auto* ops_global = new llvm::GlobalVariable(*gen.module, ops_type, true, llvm::GlobalValue::PrivateLinkage,
+                                                    llvm::ConstantArray::get(ops_type, op_codes), "parallel.ops");
+        ops_global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+        ops = gen.builder->CreateConstInBoundsGEP2_32(ops_type, ops_global, 0, 0);
+        
+        llvm::ArrayType* values_type = llvm::ArrayType::get(int64_type, reductions.size());
+        llvm::AllocaInst* slots = gen.create_entry_block_alloca(parent, "parallel.reductions", values_type);
+        values = gen.builder->CreateConstInBoundsGEP2_32(values_type, slots, 0, 0);
+        unsigned slot = 0;
+        for (const auto& pair : reductions) {
+            llvm::AllocaInst* alloca = gen.named_values[pair.first];
+            llvm::Value* val = gen.builder->CreateLoad(alloca->getAllocatedType(), alloca, pair.first);
+            gen.builder->CreateStore(to_reduction_word(gen, val),
+                                     gen.builder->CreateConstInBoundsGEP1_32(int64_type, values, slot++));
+        }
+    }
+    
+    // Outline the body; the enclosing function's state is restored below
+    llvm::Function* body_fn = llvm::Function::Create(gen.get_parallel_body_type(), llvm::Function::InternalLinkage,
+                                                     parent->getName() + ".parallel", gen.module.get());
+    auto saved_values = gen.named_values;
+    auto saved_lists = gen.list_elements;
+    auto saved_strings = gen.string_variables;
+    llvm::BasicBlock* saved_block = gen.builder->GetInsertBlock();
+    auto restore = [&]() {
+        gen.current_function = parent;
+        gen.named_values = saved_values;
+        gen.list_elements = saved_lists;
+        gen.string_variables = saved_strings;
+        gen.builder->SetInsertPoint(saved_block);
+    };
+    
+    gen.current_function = body_fn;
+    gen.named_values.clear();
+    llvm::BasicBlock* entry_bb = llvm::BasicBlock::Create(*gen.context, "entry", body_fn);
+    gen.builder->SetInsertPoint(entry_bb);
+    
+    auto arg = body_fn->arg_begin();
+    llvm::Value* env_arg = &*arg++;
+    llvm::Value* begin = &*arg++;
+    llvm::Value* end = &*arg++;
+    llvm::Value* partials = &*arg;
+    env_arg->setName("env");
+    begin->setName("begin");
+    end->setName("end");
+    partials->setName("partials");
+    
+    llvm::Value* env_ptr = gen.builder->CreatePointerCast(env_arg, llvm::PointerType::getUnqual(env_type));
+    llvm::Value* start = gen.builder->CreateLoad(int64_type, gen.builder->CreateStructGEP(env_type, env_ptr, 0),
+                                                 "start");
+    for (size_t i = 0; i < captured.size(); ++i) {
+        llvm::Type* type = env_fields[i + 1];
+        llvm::AllocaInst* alloca = gen.create_entry_block_alloca(body_fn, captured[i], type);
+        gen.builder->CreateStore(gen.builder->CreateLoad(type, gen.builder->CreateStructGEP(env_type, env_ptr, i + 1)),
+                                 alloca);
+        gen.named_values[captured[i]] = alloca;
+    }
+    
+    // Reductions accumulate in locals seeded from this worker's partials
+    std::vector<std::pair<llvm::AllocaInst*, llvm::Value*>> accumulators;
+    unsigned slot = 0;
+    for (const auto& pair : reductions) {
+        llvm::Type* type = saved_values[pair.first]->getAllocatedType();
+        llvm::AllocaInst* alloca = gen.create_entry_block_alloca(body_fn, pair.first, type);
+        llvm::Value* partial = gen.builder->CreateConstInBoundsGEP1_32(int64_type, partials, slot++);
+        gen.builder->CreateStore(from_reduction_word(gen, gen.builder->CreateLoad(int64_type, partial), type), alloca);
+        gen.named_values[pair.first] = alloca;
+        accumulators.push_back({alloca, partial});
+    }
+    
+    llvm::AllocaInst* var_alloca = gen.create_entry_block_alloca(body_fn, stmt->var, gen.variable_type(stmt->var));
+    gen.named_values[stmt->var] = var_alloca;
+    
+    llvm::BasicBlock* loop_bb = llvm::BasicBlock::Create(*gen.context, "parallel.body", body_fn);
+    llvm::BasicBlock* after_bb = llvm::BasicBlock::Create(*gen.context, "parallel.end", body_fn);
+    gen.builder->CreateCondBr(gen.builder->CreateICmpSLT(begin, end), loop_bb, after_bb);
+    
+    gen.builder->SetInsertPoint(loop_bb);
+    llvm::PHINode* iteration = gen.builder->CreatePHI(int64_type, 2, "iteration");
+    iteration->addIncoming(begin, entry_bb);
+    llvm::Value* offset = gen.builder->CreateMul(iteration, llvm::ConstantInt::get(int64_type, stmt->step, true),
+                                                 "offset", false, true);
+    llvm::Value* induction = gen.builder->CreateAdd(start, offset, stmt->var + ".iv", false, true);
+    gen.builder->CreateStore(gen.convert_to(induction, var_alloca->getAllocatedType()), var_alloca);
+    
+    if (!stmt->body->codegen(gen)) {
+        body_fn->eraseFromParent();
+        restore();
+        return nullptr;
+    }
+    
+    llvm::BasicBlock* latch_bb = gen.builder->GetInsertBlock();
+    llvm::Value* next = gen.builder->CreateAdd(iteration, llvm::ConstantInt::get(int64_type, 1), "iteration.next",
+                                               false, true);
+    gen.builder->CreateCondBr(gen.builder->CreateICmpSLT(next, end), loop_bb, after_bb);
+    iteration->addIncoming(next, latch_bb);
+    
+    gen.builder->SetInsertPoint(after_bb);
+    for (const auto& accumulator : accumulators) {
+        llvm::AllocaInst* alloca = accumulator.first;
+        gen.builder->CreateStore(to_reduction_word(gen, gen.builder->CreateLoad(alloca->getAllocatedType(), alloca)),
+                                 accumulator.second);
+    }
+    gen.builder->CreateRetVoid();
+    verifyFunction(*body_fn);
+    restore();
+    
+    llvm::Type* byte_ptr_type = llvm::PointerType::getUnqual(llvm::Type::getInt8Ty(*gen.context));
+    gen.builder->CreateCall(gen.get_parallel_for_function(),
+                            {count, body_fn, gen.builder->CreatePointerCast(env, byte_ptr_type),
+                             llvm::ConstantInt::get(int32_type, reductions.size()), ops, values});
+    
+    // Combined reductions flow back into the enclosing variables
+    slot = 0;
+    for (const auto& pair : reductions) {
+        llvm::AllocaInst* alloca = gen.named_values[pair.first];
+        llvm::Value* word = gen.builder->CreateLoad(int64_type,
+                                                    gen.builder->CreateConstInBoundsGEP1_32(int64_type, values, slot++));
+        gen.builder->CreateStore(from_reduction_word(gen, word, alloca->getAllocatedType()), alloca);
+    }
+    
+    return llvm::Constant::getNullValue(llvm::Type::getDoubleTy(*gen.context));
+}
+
+llvm::Value* ForRangeStmtAST::codegen(CodeGen& gen) {
+    llvm::IntegerType* int64_type = llvm::Type::getInt64Ty(*gen.context);
+    
+    // Bounds are evaluated once and truncated to integers
+    llvm::Value* start_val = llvm::ConstantInt::get(int64_type, 0);
+    if (start) {
+        start_val = start->codegen(gen);
+        if (!start_val) return nullptr;
+        start_val = gen.to_integer(start_val, int64_type);
+        if (!start_val) return nullptr;
+    }
+    llvm::Value* stop_val = stop->codegen(gen);
+    if (!stop_val) return nullptr;
+    stop_val = gen.to_integer(stop_val, int64_type);
+    if (!stop_val) return nullptr;
+    
+    if (parallel) {
+        return codegen_parallel_for(gen, this, start_val, stop_val);
+    }
+    
+    llvm::AllocaInst* alloca = gen.named_values[var];
+    if (!alloca) {
+        alloca = gen.create_entry_block_alloca(gen.current_function, var, gen.variable_type(var));
+        gen.named_values[var] = alloca;
+    } else if (alloca->getAllocatedType()->isPointerTy()) {
+        return gen.log_error_v(("Loop variable is a list: " + var).c_str());
+    }
+    
+    // Canonical rotated loop: a guard in the preheader, the induction
+    // variable as a phi in the header, and a single latch that steps and
+    // tests it. SCEV sees the trip count directly.
+    llvm::Function* function = gen.builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock* preheader_bb = gen.builder->GetInsertBlock();
+    llvm::BasicBlock* loop_bb = llvm::BasicBlock::Create(*gen.context, "for.body", function);
+    llvm::BasicBlock* after_bb = llvm::BasicBlock::Create(*gen.context, "for.end", function);
+    
+    llvm::ConstantInt* step_val = llvm::ConstantInt::get(int64_type, step, true);
+    llvm::Value* enter = step > 0 ? gen.builder->CreateICmpSLT(start_val, stop_val, "for.enter")
+                                  : gen.builder->CreateICmpSGT(start_val, stop_val, "for.enter");
+    gen.builder->CreateCondBr(enter, loop_bb, after_bb);
+    
+    gen.builder->SetInsertPoint(loop_bb);
+    llvm::PHINode* induction = gen.builder->CreatePHI(int64_type, 2, var + ".iv");
+    induction->addIncoming(start_val, preheader_bb);
+    
+    // The body sees the induction value through the ordinary variable
+    gen.builder->CreateStore(gen.convert_to(induction, alloca->getAllocatedType()), alloca);
+    if (!body->codegen(gen)) return nullptr;
+    
+    // A body ending in return has no back edge
+    if (!gen.builder->GetInsertBlock()->getTerminator()) {
+        llvm::BasicBlock* latch_bb = gen.builder->GetInsertBlock();
+        llvm::Value* next = gen.builder->CreateAdd(induction, step_val, var + ".next", false, true);
+        llvm::Value* again = step > 0 ? gen.builder->CreateICmpSLT(next, stop_val, "for.cond")
+                                      : gen.builder->CreateICmpSGT(next, stop_val, "for.cond");
+        gen.builder->CreateCondBr(again, loop_bb, after_bb);
+        induction->addIncoming(next, latch_bb);
+    }
+    
+    gen.builder->SetInsertPoint(after_bb);
+    return llvm::Constant::getNullValue(llvm::Type::getDoubleTy(*gen.context));
+}
+
 llvm::Value* ReturnStmtAST::codegen(CodeGen& gen) {
     llvm::Value* ret_val = nullptr;
     if (value) {
         ret_val = value->codegen(gen);
         if (!ret_val) return nullptr;
+        
+        auto decl = gen.function_decls.find(std::string(gen.current_function->getName()));
+        llvm::Type* element_type = nullptr;
+        if (decl != gen.function_decls.end()) {
+            element_type = gen.annotation_element_type(decl->second->return_type);
+        }
+        ret_val = gen.convert_operand(value.get(), ret_val, gen.current_function->getReturnType(), element_type);
+        if (!ret_val) return nullptr;
+        
+        // A call whose result is returned unchanged is in tail position;
+        // arguments never point into this frame, so the callee may reuse it
+        if (auto* call = llvm::dyn_cast<llvm::CallInst>(ret_val)) {
+            call->setTailCall();
+        }
     } else {
-        ret_val = llvm::Constant::getNullValue(llvm::Type::getDoubleTy(*gen.context));
+        ret_val = llvm::Constant::getNullValue(gen.current_function->getReturnType());
     }
     
     gen.builder->CreateRet(ret_val);
@@ -251,18 +1169,44 @@ llvm::Value* PrintStmtAST::codegen(CodeGen& gen) {
     llvm::Value* val = expression->codegen(gen);
     if (!val) return nullptr;
     
-    // For now, just print numbers. In a full implementation, you'd handle strings too.
-    llvm::Function* print_func = gen.get_print_double_function();
-    gen.builder->CreateCall(print_func, val);
+    // Strings carry their length, so the runtime copies the characters
+    // straight into its output buffer
+    if (gen.is_string(expression.get())) {
+        llvm::StructType* string_type = gen.string_type();
+        llvm::Value* length = gen.builder->CreateLoad(llvm::Type::getInt64Ty(*gen.context),
+                                                      gen.builder->CreateStructGEP(string_type, val, 0), "length");
+        llvm::Value* chars = gen.builder->CreateConstInBoundsGEP2_32(string_type, val, 0, 1, "chars");
+        chars = gen.builder->CreatePointerCast(chars, llvm::PointerType::getUnqual(llvm::Type::getInt8Ty(*gen.context)));
+        gen.builder->CreateCall(gen.get_print_str_function(), {chars, length});
+        return val;
+    }
+    
+    // Ints print through the integer formatter without a round trip via double
+    if (val->getType()->isIntegerTy()) {
+        val = gen.to_integer(val, llvm::Type::getInt64Ty(*gen.context));
+        gen.builder->CreateCall(gen.get_print_int_function(), val);
+        return val;
+    }
+    
+    val = gen.to_double(val);
+    if (!val) return nullptr;
+    gen.builder->CreateCall(gen.get_print_double_function(), val);
     
     // Return the value that was printed
     return val;
 }
 
 llvm::Value* FunctionAST::codegen(CodeGen& gen) {
-    // Create function type
-    std::vector<llvm::Type*> doubles(args.size(), llvm::Type::getDoubleTy(*gen.context));
-    llvm::FunctionType* ft = llvm::FunctionType::get(llvm::Type::getDoubleTy(*gen.context), doubles, false);
+    // Registered first so recursive calls see list parameter and return types
+    gen.function_decls[name] = this;
+    
+    // Create function type; annotated ints become native i64, lists header
+    // pointers, the rest double
+    std::vector<llvm::Type*> param_types;
+    for (size_t i = 0; i < args.size(); ++i) {
+        param_types.push_back(gen.annotation_type(getArgAnnotation(i)));
+    }
+    llvm::FunctionType* ft = llvm::FunctionType::get(gen.annotation_type(return_type), param_types, false);
     
     llvm::Function* function = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, gen.module.get());
     
@@ -278,23 +1222,44 @@ llvm::Value* FunctionAST::codegen(CodeGen& gen) {
     
     // Record the function arguments in the NamedValues map.
     gen.named_values.clear();
+    gen.list_elements.clear();
+    gen.string_variables.clear();
     gen.current_function = function;
+    gen.current_scope = name;
     
     for (auto& arg : function->args()) {
         // Create an alloca for this variable.
-        llvm::AllocaInst* alloca = gen.create_entry_block_alloca(function, std::string(arg.getName()));
+        llvm::AllocaInst* alloca = gen.create_entry_block_alloca(function, std::string(arg.getName()),
+                                                                 arg.getType());
         
         // Store the initial value into the alloca.
         gen.builder->CreateStore(&arg, alloca);
         
         // Add arguments to variable symbol table.
         gen.named_values[std::string(arg.getName())] = alloca;
+        if (llvm::Type* element_type = gen.annotation_element_type(getArgAnnotation(arg.getArgNo()))) {
+            gen.list_elements[std::string(arg.getName())] = element_type;
+        }
     }
     
     if (llvm::Value* ret_val = body->codegen(gen)) {
         // Only add return if the current block doesn't already have a terminator
         if (!gen.builder->GetInsertBlock()->getTerminator()) {
-            gen.builder->CreateRet(ret_val);
+            // A trailing list statement has no numeric value, and falling off
+            // the end of a list function returns a null list
+            llvm::Type* return_type = function->getReturnType();
+            bool has_list = return_type->isPointerTy() || ret_val->getType()->isPointerTy();
+            // Declared ints only take the value of a trailing loop or branch
+            // (a constant zero); a computed double would be truncated
+            if (!has_list && return_type->isIntegerTy() && ret_val->getType()->isFloatingPointTy() &&
+                !llvm::isa<llvm::Constant>(ret_val)) {
+                std::string error = "Type error in return value of function '" + name + "': expected int, got float";
+                gen.log_error_v(error.c_str());
+                function->eraseFromParent();
+                return nullptr;
+            }
+            gen.builder->CreateRet(has_list ? llvm::Constant::getNullValue(return_type)
+                                            : gen.convert_to(ret_val, return_type));
         }
         
         // Validate the generated code, checking for consistency.
@@ -310,6 +1275,7 @@ llvm::Value* FunctionAST::codegen(CodeGen& gen) {
 
 llvm::Value* ProgramAST::codegen(CodeGen& gen) {
     for (auto& func : functions) {
+        llvm::TimeTraceScope scope("CodeGenFunction", func->name);
         func->codegen(gen);
     }
     return nullptr;
@@ -3,9 +3,12 @@
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/Metadata.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
 #include <iostream>
 
 CodeGen::CodeGen() {
@@ -13,20 +16,235 @@ CodeGen::CodeGen() {
     module = std::make_unique<llvm::Module>("quill", *context);
     builder = std::make_unique<llvm::IRBuilder<>>(*context);
     current_function = nullptr;
+    range_info = nullptr;
+    narrow_integers = false;
+    elide_bounds_checks = false;
 }
 
 void CodeGen::generate(ProgramAST& program) {
+    builder->setFastMathFlags(fast_math_flags);
     program.codegen(*this);
 }
 
 llvm::Value* CodeGen::log_error_v(const char* str) {
-    std::cerr << "Error: " << str << std::endl;
+    errors.push_back(str);
     return nullptr;
 }
 
-llvm::AllocaInst* CodeGen::create_entry_block_alloca(llvm::Function* function, const std::string& var_name) {
+llvm::AllocaInst* CodeGen::create_entry_block_alloca(llvm::Function* function, const std::string& var_name,
+                                                     llvm::Type* type) {
     llvm::IRBuilder<> tmp_builder(&function->getEntryBlock(), function->getEntryBlock().begin());
-    return tmp_builder.CreateAlloca(llvm::Type::getDoubleTy(*context), 0, var_name.c_str());
+    if (!type) type = llvm::Type::getDoubleTy(*context);
+    return tmp_builder.CreateAlloca(type, 0, var_name.c_str());
+}
+
+const quill::ValueRange* CodeGen::expression_range(const ExprAST* expr) const {
+    if (!range_info) return nullptr;
+    return range_info->getExpressionRange(expr);
+}
+
+llvm::Type* CodeGen::variable_type(const std::string& var_name) {
+    if (range_info && current_function) {
+        const quill::ValueRange* range = range_info->getVariableRange(current_scope, var_name);
+        if (range && narrow_integers && range->isExactInteger()) {
+            return integer_type_for(*range);
+        }
+        if (range && range->native_int) {
+            return llvm::Type::getInt64Ty(*context);
+        }
+    }
+    return llvm::Type::getDoubleTy(*context);
+}
+
+llvm::Type* CodeGen::annotation_type(const std::string& annotation) {
+    // Declared ints are native 64-bit integers, lists are header pointers,
+    // everything else is a double
+    if (annotation == "int") {
+        return llvm::Type::getInt64Ty(*context);
+    }
+    if (llvm::Type* element_type = annotation_element_type(annotation)) {
+        return list_pointer_type(element_type);
+    }
+    return llvm::Type::getDoubleTy(*context);
+}
+
+llvm::IntegerType* CodeGen::integer_type_for(const quill::ValueRange& range) {
+    return range.fitsInt32() ? llvm::Type::getInt32Ty(*context) : llvm::Type::getInt64Ty(*context);
+}
+
+llvm::Value* CodeGen::to_double(llvm::Value* val) {
+    if (val->getType()->isPointerTy()) {
+        return log_error_v("Lists and strings cannot be used as numbers");
+    }
+    if (val->getType()->isIntegerTy()) {
+        return builder->CreateSIToFP(val, llvm::Type::getDoubleTy(*context), "itofp");
+    }
+    return val;
+}
+
+llvm::Value* CodeGen::to_integer(llvm::Value* val, llvm::IntegerType* type) {
+    if (val->getType()->isPointerTy()) {
+        return log_error_v("Lists and strings cannot be used as numbers");
+    }
+    if (val->getType()->isIntegerTy()) {
+        // Range analysis guarantees the value fits, so truncation is exact
+        return builder->CreateSExtOrTrunc(val, type, "iresize");
+    }
+    return builder->CreateFPToSI(val, type, "fptoi");
+}
+
+llvm::Value* CodeGen::convert_to(llvm::Value* val, llvm::Type* type) {
+    if (val->getType() == type) return val;
+    if (type->isPointerTy()) {
+        return log_error_v("Expected a list");
+    }
+    if (auto* int_type = llvm::dyn_cast<llvm::IntegerType>(type)) {
+        return to_integer(val, int_type);
+    }
+    return to_double(val);
+}
+
+llvm::StructType* CodeGen::list_type(llvm::Type* element_type) {
+    // Matches quill_list in runtime.c
+    std::string name = element_type->isIntegerTy() ? "quill.list.i64" : "quill.list.f64";
+    if (llvm::StructType* existing = llvm::StructType::getTypeByName(*context, name)) {
+        return existing;
+    }
+    llvm::Type* int64_type = llvm::Type::getInt64Ty(*context);
+    return llvm::StructType::create(*context, {llvm::PointerType::getUnqual(element_type), int64_type, int64_type},
+                                    name);
+}
+
+llvm::PointerType* CodeGen::list_pointer_type(llvm::Type* element_type) {
+    return llvm::PointerType::getUnqual(list_type(element_type));
+}
+
+llvm::StructType* CodeGen::string_type() {
+    // Characters follow the length inline; the array is sized per literal
+    const char* name = "quill.string";
+    if (llvm::StructType* existing = llvm::StructType::getTypeByName(*context, name)) {
+        return existing;
+    }
+    llvm::Type* chars_type = llvm::ArrayType::get(llvm::Type::getInt8Ty(*context), 0);
+    return llvm::StructType::create(*context, {llvm::Type::getInt64Ty(*context), chars_type}, name);
+}
+
+llvm::PointerType* CodeGen::string_pointer_type() {
+    return llvm::PointerType::getUnqual(string_type());
+}
+
+llvm::Constant* CodeGen::string_constant(const std::string& value) {
+    auto found = string_constants.find(value);
+    if (found != string_constants.end()) return found->second;
+    
+    // NUL-terminated so the characters can also be handed to C as they are
+    llvm::Constant* fields[] = {
+        llvm::ConstantInt::get(llvm::Type::getInt64Ty(*context), value.size()),
+        llvm::ConstantDataArray::getString(*context, value, true)
+    };
+    llvm::Constant* record = llvm::ConstantStruct::getAnon(*context, fields);
+    auto* global = new llvm::GlobalVariable(*module, record->getType(), true, llvm::GlobalValue::PrivateLinkage,
+                                            record, ".str");
+    global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    global->setAlignment(llvm::Align(8));
+    
+    llvm::Constant* str = llvm::ConstantExpr::getPointerCast(global, string_pointer_type());
+    string_constants[value] = str;
+    return str;
+}
+
+bool CodeGen::is_string(const ExprAST* expr) const {
+    if (dynamic_cast<const StringExprAST*>(expr)) return true;
+    auto var = dynamic_cast<const VariableExprAST*>(expr);
+    return var && string_variables.count(var->name);
+}
+
+llvm::MDNode* CodeGen::list_access_tag(const std::string& kind) {
+    auto found = list_access_tags.find(kind);
+    if (found != list_access_tags.end()) return found->second;
+    
+    llvm::MDBuilder md(*context);
+    llvm::MDNode* root = md.createTBAARoot("quill.list");
+    llvm::MDNode* type = md.createTBAAScalarTypeNode("quill.list." + kind, root);
+    llvm::MDNode* tag = md.createTBAAStructTagNode(type, type, 0);
+    list_access_tags[kind] = tag;
+    return tag;
+}
+
+llvm::Type* CodeGen::annotation_element_type(const std::string& annotation) {
+    if (quill::RangeAnalysis::isIntegerListAnnotation(annotation)) {
+        return llvm::Type::getInt64Ty(*context);
+    }
+    if (quill::RangeAnalysis::isListAnnotation(annotation)) {
+        return llvm::Type::getDoubleTy(*context);
+    }
+    return nullptr;
+}
+
+llvm::Type* CodeGen::list_element_type(const ExprAST* expr) {
+    // Opaque pointers carry no element type, so it is recovered from the AST
+    if (auto list = dynamic_cast<const ListExprAST*>(expr)) {
+        bool integer = range_info && range_info->hasIntegerElements(list);
+        return integer ? llvm::Type::getInt64Ty(*context) : llvm::Type::getDoubleTy(*context);
+    }
+    if (auto var = dynamic_cast<const VariableExprAST*>(expr)) {
+        auto it = list_elements.find(var->name);
+        return (it != list_elements.end()) ? it->second : nullptr;
+    }
+    if (auto call = dynamic_cast<const CallExprAST*>(expr)) {
+        auto it = function_decls.find(call->callee);
+        return (it != function_decls.end()) ? annotation_element_type(it->second->return_type) : nullptr;
+    }
+    return nullptr;
+}
+
+llvm::Value* CodeGen::convert_operand(const ExprAST* expr, llvm::Value* val, llvm::Type* type,
+                                      llvm::Type* element_type) {
+    llvm::Type* actual = list_element_type(expr);
+    if (actual != element_type) {
+        if (!element_type) return log_error_v("Expected a number, got a list");
+        if (!actual) return log_error_v("Expected a list, got a number");
+        return log_error_v("List element types do not match");
+    }
+    // A double only enters an integer slot when range analysis proved it
+    // integral, so the conversion is exact rather than a truncation. Without
+    // type checking there are no range facts and annotations are trusted.
+    if (range_info && type->isIntegerTy() && val->getType()->isFloatingPointTy()) {
+        const quill::ValueRange* range = expression_range(expr);
+        if (!range) {
+            // The analysis never reached this value, so neither does the
+            // program. A variable narrowed at -O1 and above must not turn
+            // a dead float store into an error that -O0 never reports.
+            builder->CreateUnreachable();
+            builder->SetInsertPoint(llvm::BasicBlock::Create(*context, "dead",
+                                                             builder->GetInsertBlock()->getParent()));
+            return llvm::UndefValue::get(type);
+        }
+        if (!range->integral) return log_error_v("Type error: expected int, got float");
+    }
+    return convert_to(val, type);
+}
+
+llvm::Value* CodeGen::annotate_range(llvm::Value* val, const ExprAST* expr) {
+    // Range facts are only consumed by the optimizer
+    if (!val || !narrow_integers) return val;
+    
+    auto* inst = llvm::dyn_cast<llvm::Instruction>(val);
+    const quill::ValueRange* range = expression_range(expr);
+    if (!inst || !range || range->isEmpty() || range->nan) return val;
+    if (!range->integral && !range->isBounded()) return val;
+    
+    llvm::Type* double_type = llvm::Type::getDoubleTy(*context);
+    llvm::Metadata* operands[] = {
+        llvm::ConstantAsMetadata::get(llvm::ConstantFP::get(double_type, range->lo)),
+        llvm::ConstantAsMetadata::get(llvm::ConstantFP::get(double_type, range->hi)),
+        llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(llvm::Type::getInt1Ty(*context),
+                                                             range->integral)),
+        llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(llvm::Type::getInt1Ty(*context),
+                                                             range->negative_zero))
+    };
+    inst->setMetadata(quill::RANGE_METADATA_KIND, llvm::MDNode::get(*context, operands));
+    return val;
 }
 
 llvm::Function* CodeGen::get_printf_function() {
@@ -51,27 +269,169 @@ llvm::Function* CodeGen::get_print_double_function() {
             false);
         print_func = llvm::Function::Create(print_type,
             llvm::Function::ExternalLinkage, "print_double", module.get());
+        print_func->addFnAttr(llvm::Attribute::NoUnwind);
+        register_output_flush();
+    }
+    return print_func;
+}
+
+llvm::Function* CodeGen::get_print_int_function() {
+    llvm::Function* print_func = module->getFunction("print_int");
+    if (!print_func) {
+        llvm::FunctionType* print_type = llvm::FunctionType::get(
+            llvm::Type::getVoidTy(*context),
+            {llvm::Type::getInt64Ty(*context)},
+            false);
+        print_func = llvm::Function::Create(print_type,
+            llvm::Function::ExternalLinkage, "print_int", module.get());
+        print_func->addFnAttr(llvm::Attribute::NoUnwind);
+        register_output_flush();
+    }
+    return print_func;
+}
+
+llvm::Function* CodeGen::get_print_str_function() {
+    llvm::Function* print_func = module->getFunction("print_str");
+    if (!print_func) {
+        llvm::FunctionType* print_type = llvm::FunctionType::get(
+            llvm::Type::getVoidTy(*context),
+            {llvm::PointerType::getUnqual(llvm::Type::getInt8Ty(*context)), llvm::Type::getInt64Ty(*context)},
+            false);
+        print_func = llvm::Function::Create(print_type,
+            llvm::Function::ExternalLinkage, "print_str", module.get());
+        print_func->addFnAttr(llvm::Attribute::NoUnwind);
+        print_func->addParamAttr(0, llvm::Attribute::NoCapture);
+        print_func->addParamAttr(0, llvm::Attribute::ReadOnly);
+        register_output_flush();
     }
     return print_func;
 }
 
+void CodeGen::register_output_flush() {
+    if (module->getFunction("quill_flush_output")) return;
+    
+    llvm::FunctionType* flush_type = llvm::FunctionType::get(llvm::Type::getVoidTy(*context), false);
+    llvm::Function* flush_func = llvm::Function::Create(flush_type,
+        llvm::Function::ExternalLinkage, "quill_flush_output", module.get());
+    flush_func->addFnAttr(llvm::Attribute::NoUnwind);
+    
+    // Runs on return from main and on exit(); lli honours it too, unlike atexit
+    llvm::appendToGlobalDtors(*module, flush_func, 65535);
+}
+
+llvm::Function* CodeGen::get_list_new_function() {
+    llvm::Function* new_func = module->getFunction("quill_list_new");
+    if (!new_func) {
+        llvm::Type* int64_type = llvm::Type::getInt64Ty(*context);
+        llvm::FunctionType* new_type = llvm::FunctionType::get(
+            llvm::PointerType::getUnqual(llvm::Type::getInt8Ty(*context)),
+            {int64_type, int64_type},
+            false);
+        new_func = llvm::Function::Create(new_type,
+            llvm::Function::ExternalLinkage, "quill_list_new", module.get());
+        new_func->addFnAttr(llvm::Attribute::NoUnwind);
+    }
+    return new_func;
+}
+
+llvm::Function* CodeGen::get_list_grow_function() {
+    llvm::Function* grow_func = module->getFunction("quill_list_grow");
+    if (!grow_func) {
+        llvm::FunctionType* grow_type = llvm::FunctionType::get(
+            llvm::Type::getVoidTy(*context),
+            {llvm::PointerType::getUnqual(llvm::Type::getInt8Ty(*context)), llvm::Type::getInt64Ty(*context)},
+            false);
+        grow_func = llvm::Function::Create(grow_type,
+            llvm::Function::ExternalLinkage, "quill_list_grow", module.get());
+        grow_func->addFnAttr(llvm::Attribute::NoUnwind);
+    }
+    return grow_func;
+}
+
+llvm::Function* CodeGen::get_index_error_function() {
+    llvm::Function* error_func = module->getFunction("quill_index_error");
+    if (!error_func) {
+        llvm::Type* int64_type = llvm::Type::getInt64Ty(*context);
+        llvm::FunctionType* error_type = llvm::FunctionType::get(
+            llvm::Type::getVoidTy(*context),
+            {int64_type, int64_type},
+            false);
+        error_func = llvm::Function::Create(error_type,
+            llvm::Function::ExternalLinkage, "quill_index_error", module.get());
+        
+        // Failure path: keeps check blocks out of the hot layout
+        error_func->addFnAttr(llvm::Attribute::NoReturn);
+        error_func->addFnAttr(llvm::Attribute::Cold);
+        error_func->addFnAttr(llvm::Attribute::NoUnwind);
+    }
+    return error_func;
+}
+
+llvm::Function* CodeGen::get_zero_division_error_function() {
+    llvm::Function* error_func = module->getFunction("quill_zero_division_error");
+    if (!error_func) {
+        llvm::FunctionType* error_type = llvm::FunctionType::get(llvm::Type::getVoidTy(*context), false);
+        error_func = llvm::Function::Create(error_type,
+            llvm::Function::ExternalLinkage, "quill_zero_division_error", module.get());
+        
+        error_func->addFnAttr(llvm::Attribute::NoReturn);
+        error_func->addFnAttr(llvm::Attribute::Cold);
+        error_func->addFnAttr(llvm::Attribute::NoUnwind);
+    }
+    return error_func;
+}
+
+llvm::FunctionType* CodeGen::get_parallel_body_type() {
+    llvm::Type* int64_type = llvm::Type::getInt64Ty(*context);
+    return llvm::FunctionType::get(llvm::Type::getVoidTy(*context),
+        {llvm::PointerType::getUnqual(llvm::Type::getInt8Ty(*context)), int64_type, int64_type,
+         llvm::PointerType::getUnqual(int64_type)},
+        false);
+}
+
+llvm::Function* CodeGen::get_parallel_for_function() {
+    llvm::Function* parallel_func = module->getFunction("quill_parallel_for");
+    if (!parallel_func) {
+        llvm::Type* int32_type = llvm::Type::getInt32Ty(*context);
+        llvm::Type* int64_type = llvm::Type::getInt64Ty(*context);
+        llvm::FunctionType* parallel_type = llvm::FunctionType::get(
+            llvm::Type::getVoidTy(*context),
+            {int64_type, llvm::PointerType::getUnqual(get_parallel_body_type()),
+             llvm::PointerType::getUnqual(llvm::Type::getInt8Ty(*context)), int32_type,
+             llvm::PointerType::getUnqual(int32_type), llvm::PointerType::getUnqual(int64_type)},
+            false);
+        parallel_func = llvm::Function::Create(parallel_type,
+            llvm::Function::ExternalLinkage, "quill_parallel_for", module.get());
+        parallel_func->addFnAttr(llvm::Attribute::NoUnwind);
+    }
+    return parallel_func;
+}
+
 void CodeGen::print_ir() {
     module->print(llvm::outs(), nullptr);
 }
 
-void CodeGen::write_object_file(const std::string& filename) {
+std::string CodeGen::ir_text() const {
+    std::string text;
+    llvm::raw_string_ostream out(text);
+    module->print(out, nullptr);
+    out.flush();
+    return text;
+}
+
+void CodeGen::write_object_file(const std::string& filename, std::ostream& log) {
     std::error_code ec;
     llvm::raw_fd_ostream dest(filename, ec, llvm::sys::fs::OF_None);
-
+    
     if (ec) {
         std::cerr << "Could not open file: " << ec.message() << std::endl;
         return;
     }
-
+    
     // For now, just write LLVM IR to the file
     module->print(dest, nullptr);
     dest.flush();
     
-    std::cout << "Note: Generated LLVM IR instead of object file. " << std::endl;
-    std::cout << "To compile to object: llc " << filename << " -o " << filename << ".o" << std::endl;
+    log << "Note: Generated LLVM IR instead of object file. " << std::endl;
+    log << "To compile to object: llc " << filename << " -o " << filename << ".o" << std::endl;
 }
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "compile_cache.h"
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/CachePruning.h>
+#include <llvm/Support/FileSystem.h>
+#if LLVM_VERSION_MAJOR >= 17
+#include <llvm/TargetParser/Host.h>
+#else
+#include <llvm/Support/Host.h>
+#endif
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/raw_ostream.h>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace quill;
+
+namespace {
+
+// pruneCache only considers files with this prefix
+const char* ENTRY_PREFIX = "llvmcache-";
+
+bool readFile(const std::string& path, std::string& contents) {
+    auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+    if (!buffer) return false;
+    contents = (*buffer)->getBuffer().str();
+    return true;
+}
+
+} // namespace
+
+CompileCache::KeyBuilder& CompileCache::KeyBuilder::add(const std::string& name, const std::string& value) {
+    material += name;
+    material += '=';
+    material += std::to_string(value.size());
+    material += ':';
+    material += value;
+    material += '\n';
+    return *this;
+}
+
+CompileCache::KeyBuilder& CompileCache::KeyBuilder::addFile(const std::string& name, const std::string& path) {
+    std::string contents;
+    if (!readFile(path, contents)) contents = "<missing " + path + ">";
+    return add(name, contents);
+}
+
+std::string CompileCache::KeyBuilder::finish() const {
+    auto digest = llvm::SHA1::hash(llvm::arrayRefFromStringRef(material));
+    return llvm::toHex(digest, /*LowerCase=*/true);
+}
+
+CompileCache::CompileCache(std::string directory, uint64_t max_bytes)
+    : directory(std::move(directory)), max_bytes(max_bytes) {
+    llvm::sys::fs::create_directories(this->directory);
+}
+
+CompileCache::~CompileCache() {
+    flush();
+}
+
+std::string CompileCache::defaultDirectory() {
+    if (const char* configured = std::getenv("QUILL_CACHE_DIR")) {
+        if (*configured) return configured;
+    }
+    llvm::SmallString<256> path;
+    if (!llvm::sys::path::cache_directory(path)) {
+        llvm::sys::fs::current_path(path);
+        llvm::sys::path::append(path, ".quill-cache");
+        return std::string(path);
+    }
+    llvm::sys::path::append(path, "quill");
+    return std::string(path);
+}
+
+std::string CompileCache::compilerIdentity(const char* argv0) {
+    static int anchor;
+    // Optimized modules are tuned for the host CPU
+    std::string identity = "LLVM " LLVM_VERSION_STRING "; " + llvm::sys::getDefaultTargetTriple() + "; " +
+                           llvm::sys::getHostCPUName().str();
+    std::string executable = llvm::sys::fs::getMainExecutable(argv0, &anchor);
+    llvm::sys::fs::file_status status;
+    if (!executable.empty() && !llvm::sys::fs::status(executable, status)) {
+        auto modified = status.getLastModificationTime().time_since_epoch();
+        identity += "; " + std::to_string(status.getSize()) + " bytes; " +
+                    std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(modified).count());
+    }
+    return identity;
+}
+
+std::string CompileCache::entryPath(const std::string& key) const {
+    llvm::SmallString<256> path(directory);
+    llvm::sys::path::append(path, ENTRY_PREFIX + key);
+    return std::string(path);
+}
+
+std::string CompileCache::statsPath() const {
+    llvm::SmallString<256> path(directory);
+    llvm::sys::path::append(path, "stats");
+    return std::string(path);
+}
+
+bool CompileCache::lookup(const std::string& key, std::string& artifact) {
+    std::string path = entryPath(key);
+    if (!readFile(path, artifact)) {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pending_misses++;
+        return false;
+    }
+    
+    // Pruning evicts by access time, so a hit marks the entry as recent
+    int fd;
+    if (!llvm::sys::fs::openFileForWrite(path, fd, llvm::sys::fs::CD_OpenExisting, llvm::sys::fs::OF_Append)) {
+        llvm::sys::fs::setLastAccessAndModificationTime(fd, std::chrono::system_clock::now());
+        llvm::sys::fs::closeFile(fd);
+    }
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    pending_hits++;
+    return true;
+}
+
+void CompileCache::store(const std::string& key, const std::string& artifact) {
+    // Write to a unique temporary and rename, so a concurrent lookup never
+    // reads a partial entry
+    llvm::SmallString<256> model(directory);
+    llvm::sys::path::append(model, "tmp-%%%%%%%%");
+    int fd;
+    llvm::SmallString<256> temporary;
+    if (llvm::sys::fs::createUniqueFile(model, fd, temporary)) return;
+    {
+        llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+        out << artifact;
+        out.close();
+        if (out.has_error()) {
+            out.clear_error();
+            llvm::sys::fs::remove(temporary);
+            return;
+        }
+    }
+    if (llvm::sys::fs::rename(temporary, entryPath(key))) {
+        llvm::sys::fs::remove(temporary);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    needs_prune = true;
+}
+
+void CompileCache::flush() {
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    if (pending_hits || pending_misses) {
+        recordCounters(pending_hits, pending_misses, 0);
+        pending_hits = pending_misses = 0;
+    }
+    if (needs_prune) {
+        needs_prune = false;
+        prune();
+    }
+}
+
+void CompileCache::prune() {
+    llvm::CachePruningPolicy policy;
+    policy.Interval = std::chrono::seconds(0);
+    policy.Expiration = std::chrono::seconds(0);
+    policy.MaxSizeBytes = max_bytes;
+    
+    uint64_t before = countEntries();
+    llvm::pruneCache(directory, policy);
+    uint64_t after = countEntries();
+    if (after < before) recordCounters(0, 0, before - after);
+}
+
+void CompileCache::recordCounters(uint64_t hits, uint64_t misses, uint64_t evictions) const {
+    int fd;
+    if (llvm::sys::fs::openFileForReadWrite(statsPath(), fd, llvm::sys::fs::CD_OpenAlways, llvm::sys::fs::OF_None)) {
+        return;
+    }
+    if (llvm::sys::fs::lockFile(fd)) {
+        llvm::sys::fs::closeFile(fd);
+        return;
+    }
+    
+    Stats stats;
+    std::string contents;
+    if (readFile(statsPath(), contents)) {
+        std::istringstream in(contents);
+        in >> stats.hits >> stats.misses >> stats.evictions;
+    }
+    stats.hits += hits;
+    stats.misses += misses;
+    stats.evictions += evictions;
+    
+    // Rewrite in place through the locked descriptor
+    std::string updated = std::to_string(stats.hits) + " " + std::to_string(stats.misses) + " " +
+                          std::to_string(stats.evictions) + "\n";
+    llvm::sys::fs::resize_file(fd, 0);
+    {
+        llvm::raw_fd_ostream out(fd, /*shouldClose=*/false);
+        out.seek(0);
+        out << updated;
+    }
+    llvm::sys::fs::unlockFile(fd);
+    llvm::sys::fs::closeFile(fd);
+}
+
+uint64_t CompileCache::countEntries(uint64_t* bytes) const {
+    uint64_t entries = 0;
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(directory, ec), end; it != end && !ec; it.increment(ec)) {
+        if (llvm::sys::path::filename(it->path()).str().rfind(ENTRY_PREFIX, 0) != 0) continue;
+        llvm::sys::fs::file_status status;
+        if (llvm::sys::fs::status(it->path(), status)) continue;
+        entries++;
+        if (bytes) *bytes += status.getSize();
+    }
+    return entries;
+}
+
+CompileCache::Stats CompileCache::getStats() {
+    flush();
+    Stats stats;
+    std::string contents;
+    if (readFile(statsPath(), contents)) {
+        std::istringstream in(contents);
+        in >> stats.hits >> stats.misses >> stats.evictions;
+    }
+    stats.entries = countEntries(&stats.bytes);
+    return stats;
+}
+
+void CompileCache::printStats() {
+    Stats stats = getStats();
+    uint64_t lookups = stats.hits + stats.misses;
+    auto mib = [](uint64_t bytes) { return bytes / (1024.0 * 1024.0); };
+    
+    std::cout << "=== Quill Compile Cache ===" << std::endl;
+    std::cout << "Directory: " << directory << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Entries: " << stats.entries << " (" << mib(stats.bytes) << " of "
+              << mib(max_bytes) << " MiB)" << std::endl;
+    std::cout << "Hits: " << stats.hits << std::endl;
+    std::cout << "Misses: " << stats.misses << std::endl;
+    std::cout << "Hit Rate: " << (lookups ? 100.0 * stats.hits / lookups : 0.0) << "%" << std::endl;
+    std::cout << "Evictions: " << stats.evictions << std::endl;
+    std::cout << std::defaultfloat;
+}
@@ -0,0 +1,338 @@
+#include "compile_server.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+extern char** environ;
+
+using namespace quill;
+
+namespace {
+
+// Requests are a length-prefixed run of NUL-terminated fields: working
+// directory, argument count, arguments, then QUILL_* environment entries.
+// The client's stdin, stdout and stderr ride along with the length.
+const int FORWARDED_FDS = 3;
+
+// For the signal handler, which cannot touch std::string
+char listening_path[sizeof(sockaddr_un::sun_path)];
+
+void stopServing(int) {
+    unlink(listening_path);
+    _exit(0);
+}
+
+bool makeAddress(const std::string& path, sockaddr_un& address) {
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Whether the process at the other end of a connected socket runs as this
+// user. Requests carry file descriptors and run with the server's rights, so
+// neither end talks to anyone else.
+bool peerIsSameUser(int fd) {
+#ifdef __linux__
+    ucred credentials;
+    socklen_t size = sizeof(credentials);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0) return false;
+    return credentials.uid == getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    if (getpeereid(fd, &uid, &gid) != 0) return false;
+    return uid == getuid();
+#endif
+}
+
+// Creates `path` as a 0700 directory if missing; false unless it is then a
+// real directory (not a symlink) owned by this user and closed to others
+bool ensurePrivateDirectory(const std::string& path) {
+    if (mkdir(path.c_str(), S_IRWXU) != 0 && errno != EEXIST) return false;
+    struct stat info;
+    if (lstat(path.c_str(), &info) != 0) return false;
+    return S_ISDIR(info.st_mode) && info.st_uid == getuid() && (info.st_mode & (S_IRWXG | S_IRWXO)) == 0;
+}
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool readAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t received = read(fd, data, size);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+bool sendHeader(int fd, uint32_t length, const int (&fds)[FORWARDED_FDS]) {
+    iovec data = {&length, sizeof(length)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    
+    cmsghdr* rights = CMSG_FIRSTHDR(&message);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(rights), fds, sizeof(fds));
+    
+    ssize_t sent;
+    do {
+        sent = sendmsg(fd, &message, 0);
+    } while (sent < 0 && errno == EINTR);
+    return sent == sizeof(length);
+}
+
+bool receiveHeader(int fd, uint32_t& length, int (&fds)[FORWARDED_FDS]) {
+    iovec data = {&length, sizeof(length)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    
+    ssize_t received;
+    do {
+        received = recvmsg(fd, &message, 0);
+    } while (received < 0 && errno == EINTR);
+    
+    cmsghdr* rights = CMSG_FIRSTHDR(&message);
+    if (received != sizeof(length) || !rights || rights->cmsg_type != SCM_RIGHTS ||
+        rights->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        return false;
+    }
+    std::memcpy(fds, CMSG_DATA(rights), sizeof(fds));
+    return true;
+}
+
+} // namespace
+
+CompileServer::CompileServer(std::string socket_path) : socket_path(std::move(socket_path)) {}
+
+std::string CompileServer::defaultSocketPath() {
+    if (const char* configured = std::getenv("QUILL_SERVER_SOCKET")) {
+        if (*configured) return configured;
+    }
+    const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir && *runtime_dir && ensurePrivateDirectory(runtime_dir)) {
+        return std::string(runtime_dir) + "/quill-" + std::to_string(getuid()) + ".sock";
+    }
+    // Anyone can create names in /tmp, so the socket goes in a directory of
+    // our own rather than at a predictable path next to everyone else's
+    std::string directory = "/tmp/quill-" + std::to_string(getuid());
+    if (!ensurePrivateDirectory(directory)) {
+        std::cerr << "Error: " << directory << " is not a private directory of this user; "
+                  << "set QUILL_SERVER_SOCKET or XDG_RUNTIME_DIR" << std::endl;
+        return "";
+    }
+    return directory + "/server.sock";
+}
+
+int CompileServer::serve(const Compiler& compile) {
+    sockaddr_un address;
+    if (socket_path.empty()) return 1;
+    if (!makeAddress(socket_path, address)) {
+        std::cerr << "Error: socket path too long: " << socket_path << std::endl;
+        return 1;
+    }
+    
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        std::cerr << "Error: could not create socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    // Requests run with the server's privileges, so the socket is created
+    // owner-only; changing its mode after bind would leave a window open
+    mode_t previous_umask = umask(S_IXUSR | S_IRWXG | S_IRWXO);
+    int bound = bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    if (bound != 0 && errno == EADDRINUSE) {
+        // A socket left behind by a server that died can be replaced; a
+        // live one cannot
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool live = connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        close(probe);
+        if (live) {
+            umask(previous_umask);
+            std::cerr << "Error: a compile server is already listening on " << socket_path << std::endl;
+            close(listener);
+            return 1;
+        }
+        unlink(socket_path.c_str());
+        bound = bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    }
+    umask(previous_umask);
+    if (bound != 0 || listen(listener, SOMAXCONN) != 0) {
+        std::cerr << "Error: could not listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        close(listener);
+        return 1;
+    }
+    
+    std::memcpy(listening_path, address.sun_path, sizeof(listening_path));
+    std::signal(SIGINT, stopServing);
+    std::signal(SIGTERM, stopServing);
+    // Children are never waited for
+    std::signal(SIGCHLD, SIG_IGN);
+    
+    std::cout << "Quill compile server listening on " << socket_path << std::endl;
+    
+    while (true) {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::cerr << "Error: accept failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (!peerIsSameUser(connection)) {
+            std::cerr << "Warning: refused a connection from another user" << std::endl;
+            close(connection);
+            continue;
+        }
+        
+        pid_t child = fork();
+        if (child == 0) {
+            close(listener);
+            handle(connection, compile);
+        }
+        if (child < 0) {
+            std::cerr << "Error: fork failed: " << std::strerror(errno) << std::endl;
+        }
+        close(connection);
+    }
+    
+    unlink(socket_path.c_str());
+    close(listener);
+    return 1;
+}
+
+void CompileServer::handle(int connection, const Compiler& compile) {
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    std::signal(SIGCHLD, SIG_DFL);
+    // Writes to a client that went away fail instead of killing the child
+    std::signal(SIGPIPE, SIG_IGN);
+    
+    uint32_t length;
+    int fds[FORWARDED_FDS];
+    std::string payload;
+    if (!receiveHeader(connection, length, fds)) _exit(1);
+    payload.resize(length);
+    if (!readAll(connection, &payload[0], length)) _exit(1);
+    
+    std::vector<std::string> fields;
+    for (size_t begin = 0; begin < payload.size();) {
+        size_t end = payload.find('\0', begin);
+        if (end == std::string::npos) _exit(1);
+        fields.push_back(payload.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    if (fields.size() < 2) _exit(1);
+    size_t arg_count = std::strtoul(fields[1].c_str(), nullptr, 10);
+    if (fields.size() < 2 + arg_count) _exit(1);
+    
+    for (int fd = 0; fd < FORWARDED_FDS; fd++) {
+        if (fds[fd] == fd) continue;
+        dup2(fds[fd], fd);
+        close(fds[fd]);
+    }
+    for (size_t i = 2 + arg_count; i < fields.size(); i++) {
+        putenv(&fields[i][0]);
+    }
+    
+    int status = 1;
+    if (chdir(fields[0].c_str()) != 0) {
+        std::cerr << "Error: could not enter " << fields[0] << ": " << std::strerror(errno) << std::endl;
+    } else {
+        std::vector<char*> argv;
+        char program_name[] = "quill";
+        argv.push_back(program_name);
+        for (size_t i = 0; i < arg_count; i++) {
+            argv.push_back(&fields[2 + i][0]);
+        }
+        argv.push_back(nullptr);
+        status = compile((int)arg_count + 1, argv.data());
+    }
+    
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+    
+    int32_t reply = status;
+    writeAll(connection, reinterpret_cast<const char*>(&reply), sizeof(reply));
+    _exit(0);
+}
+
+bool CompileServer::forward(const std::string& socket_path, const std::vector<std::string>& args, int& status) {
+    sockaddr_un address;
+    if (!makeAddress(socket_path, address)) return false;
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0) return false;
+    if (connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(connection);
+        return false;
+    }
+    // Our descriptors and environment only go to a server of our own
+    if (!peerIsSameUser(connection)) {
+        std::cerr << "Warning: the compile server at " << socket_path << " belongs to another user; not using it"
+                  << std::endl;
+        close(connection);
+        return false;
+    }
+    
+    char cwd[4096];
+    std::string payload = getcwd(cwd, sizeof(cwd)) ? cwd : ".";
+    payload += '\0';
+    payload += std::to_string(args.size());
+    payload += '\0';
+    for (const std::string& arg : args) {
+        payload += arg;
+        payload += '\0';
+    }
+    for (char** entry = environ; *entry; entry++) {
+        if (std::strncmp(*entry, "QUILL_", 6) == 0) {
+            payload += *entry;
+            payload += '\0';
+        }
+    }
+    
+    const int fds[FORWARDED_FDS] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    std::signal(SIGPIPE, SIG_IGN);
+    int32_t reply;
+    bool answered = sendHeader(connection, payload.size(), fds) &&
+                    writeAll(connection, payload.data(), payload.size()) &&
+                    readAll(connection, reinterpret_cast<char*>(&reply), sizeof(reply));
+    close(connection);
+    
+    if (!answered) {
+        std::cerr << "Error: compile server at " << socket_path << " dropped the request" << std::endl;
+        status = 1;
+        return true;
+    }
+    status = reply;
+    return true;
+}
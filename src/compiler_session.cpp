@@ -0,0 +1,249 @@
+#include "compiler_session.h"
+#include "codegen.h"
+#include "lexer.h"
+#include "parser.h"
+#include "runtime.h"
+#include "timer.h"
+#include "type_checker.h"
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <stdexcept>
+
+using namespace quill;
+
+namespace {
+
+[[noreturn]] void fail(const std::string& what, llvm::Error error) {
+    throw std::runtime_error(what + ": " + llvm::toString(std::move(error)));
+}
+
+void setHostTarget(llvm::Module& module, llvm::TargetMachine& target_machine) {
+#if LLVM_VERSION_MAJOR >= 21
+    module.setTargetTriple(target_machine.getTargetTriple());
+#else
+    module.setTargetTriple(target_machine.getTargetTriple().str());
+#endif
+    module.setDataLayout(target_machine.createDataLayout());
+}
+
+} // namespace
+
+std::string CompileResult::irText() const {
+    std::string text;
+    llvm::raw_string_ostream out(text);
+    module->print(out, nullptr);
+    out.flush();
+    return text;
+}
+
+CompilerSession::CompilerSession(SessionOptions options) : options(std::move(options)) {}
+
+CompilerSession::~CompilerSession() = default;
+
+CompileResult CompilerSession::compile(const std::string& source, const std::string& name) {
+    CompileResult result;
+    
+    // Trace spans are scoped so a syntax error cannot leave one open
+    BenchmarkTimer lex_timer("Lexical Analysis");
+    lex_timer.start();
+    std::vector<Token> tokens;
+    {
+        llvm::TimeTraceScope scope("Lex", name);
+        Lexer lexer(source);
+        tokens = lexer.tokenize();
+    }
+    lex_timer.stop();
+    result.lexing_ms = lex_timer.get_last_measurement_ms();
+    result.tokens = tokens.size();
+    
+    BenchmarkTimer parse_timer("Parsing");
+    parse_timer.start();
+    std::unique_ptr<ProgramAST> program;
+    {
+        llvm::TimeTraceScope scope("Parse", name);
+        Parser parser(std::move(tokens));
+        program = parser.parse();
+    }
+    parse_timer.stop();
+    result.parsing_ms = parse_timer.get_last_measurement_ms();
+    
+    TypeChecker type_checker;
+    if (options.type_checking) {
+        BenchmarkTimer typecheck_timer("Type Checking");
+        typecheck_timer.start();
+        llvm::TimeTraceScope scope("TypeCheck", name);
+        auto type_result = type_checker.checkProgram(program.get());
+        typecheck_timer.stop();
+        result.type_checking_ms = typecheck_timer.get_last_measurement_ms();
+        
+        result.errors = type_checker.getErrors();
+        result.warnings = type_checker.getWarnings();
+        result.type_errors = type_result.hasErrors() || !result.errors.empty();
+        
+        // Codegen cannot honour a declared int that receives a float
+        const std::vector<std::string>& annotation_errors = type_checker.getAnnotationErrors();
+        if (!annotation_errors.empty()) throw std::runtime_error(annotation_errors.front());
+    }
+    
+    BenchmarkTimer codegen_timer("Code Generation");
+    codegen_timer.start();
+    CodeGen codegen;
+    codegen.module->setModuleIdentifier(name);
+    if (options.type_checking) {
+        // Range facts type declared ints and, above -O0, narrow proven
+        // integer variables and arithmetic to i32/i64
+        codegen.set_range_info(&type_checker.getRangeAnalysis(),
+                               options.opt_level != QuillOptimizationManager::O0);
+        codegen.elide_bounds_checks = options.opt_level != QuillOptimizationManager::O0;
+    }
+    if (options.fast_math) codegen.fast_math_flags.setFast();
+    if (options.associative_math) codegen.fast_math_flags.setAllowReassoc();
+    if (options.no_signed_zeros) codegen.fast_math_flags.setNoSignedZeros();
+    {
+        llvm::TimeTraceScope scope("CodeGen", name);
+        codegen.generate(*program);
+    }
+    // A function that failed to generate was dropped from the module
+    if (!codegen.errors.empty()) throw std::runtime_error(codegen.errors.front());
+    codegen_timer.stop();
+    result.codegen_ms = codegen_timer.get_last_measurement_ms();
+    
+    result.optimizer = std::make_unique<QuillOptimizationManager>(options.opt_level);
+    QuillOptimizationManager &optimizer = *result.optimizer;
+    if (options.type_checking) optimizer.setTypeInformation(&type_checker);
+    if (options.memoize) optimizer.enablePass("memoize");
+    if (options.no_memoize) optimizer.disablePass("memoize");
+    if (!options.link_runtime) optimizer.disablePass("link-runtime");
+    if (!options.profile_generate.empty()) optimizer.setProfileGenerate(options.profile_generate);
+    if (!options.profile_use.empty()) optimizer.setProfileUse(options.profile_use);
+    optimizer.setDetailedStatistics(options.detailed_statistics);
+    // A changed program still reuses the optimized bodies of unchanged functions
+    if (options.cache) optimizer.setFunctionCache(options.cache, options.cache_salt);
+    if (options.opt_level != QuillOptimizationManager::O0 || options.memoize ||
+        !options.profile_generate.empty() || !options.profile_use.empty()) {
+        BenchmarkTimer opt_timer("Optimization");
+        opt_timer.start();
+        llvm::TimeTraceScope scope("Optimize", name);
+        optimizer.runOptimizations(*codegen.module);
+        opt_timer.stop();
+        result.optimization_ms = opt_timer.get_last_measurement_ms();
+    }
+    optimizer.setTypeInformation(nullptr);
+    
+    result.context = std::move(codegen.context);
+    result.module = std::move(codegen.module);
+    return result;
+}
+
+std::string CompilerSession::emitIR(const std::string& source) {
+    return compile(source).irText();
+}
+
+std::string CompilerSession::emitBitcode(const std::string& source) {
+    CompileResult result = compile(source);
+    std::string bitcode;
+    llvm::raw_string_ostream out(bitcode);
+    llvm::WriteBitcodeToFile(*result.module, out);
+    out.flush();
+    return bitcode;
+}
+
+std::string CompilerSession::emitObject(const std::string& source) {
+    CompileResult result = compile(source);
+    llvm::TargetMachine &target_machine = hostTargetMachine();
+    setHostTarget(*result.module, target_machine);
+    
+    llvm::SmallVector<char, 0> object;
+    llvm::raw_svector_ostream out(object);
+    llvm::legacy::PassManager codegen_pm;
+#if LLVM_VERSION_MAJOR >= 18
+    auto file_type = llvm::CodeGenFileType::ObjectFile;
+#else
+    auto file_type = llvm::CGFT_ObjectFile;
+#endif
+    if (target_machine.addPassesToEmitFile(codegen_pm, out, nullptr, file_type)) {
+        throw std::runtime_error("the host target cannot emit object files");
+    }
+    codegen_pm.run(*result.module);
+    return std::string(object.begin(), object.end());
+}
+
+void* CompilerSession::jit(const std::string& source, const std::string& function) {
+    llvm::orc::LLJIT &engine = jitEngine();
+    std::string library_name = "quill." + std::to_string(jit_libraries++);
+    CompileResult result = compile(source, library_name);
+    
+    auto library = engine.createJITDylib(library_name);
+    if (!library) fail("could not create " + library_name, library.takeError());
+    library->addToLinkOrder(engine.getMainJITDylib());
+    
+    llvm::orc::ThreadSafeModule module(std::move(result.module), std::move(result.context));
+    if (llvm::Error error = engine.addIRModule(*library, std::move(module))) {
+        fail("could not load " + library_name, std::move(error));
+    }
+    auto symbol = engine.lookup(*library, function);
+    if (!symbol) fail("could not find " + function, symbol.takeError());
+#if LLVM_VERSION_MAJOR >= 15
+    return symbol->toPtr<void*>();
+#else
+    return reinterpret_cast<void*>(symbol->getAddress());
+#endif
+}
+
+void CompilerSession::flushOutput() {
+    quill_flush_output();
+}
+
+llvm::TargetMachine& CompilerSession::hostTargetMachine() {
+    if (!target_machine) {
+        target_machine = QuillOptimizationManager::createHostTargetMachine();
+        if (!target_machine) throw std::runtime_error("the host target is not available");
+        llvm::InitializeNativeTargetAsmPrinter();
+    }
+    return *target_machine;
+}
+
+llvm::orc::LLJIT& CompilerSession::jitEngine() {
+    if (jit_engine) return *jit_engine;
+    
+    QuillOptimizationManager::initializeHost();
+    llvm::InitializeNativeTargetAsmPrinter();
+    auto engine = llvm::orc::LLJITBuilder().create();
+    if (!engine) fail("could not start the JIT", engine.takeError());
+    jit_engine = std::move(*engine);
+    
+    // Every program's library links against the main one, which resolves
+    // the runtime and then anything else in the process (libc, libm)
+    llvm::orc::JITDylib &main = jit_engine->getMainJITDylib();
+    llvm::orc::SymbolMap runtime;
+    auto define = [&](const char* name, void* address) {
+#if LLVM_VERSION_MAJOR >= 17
+        runtime[jit_engine->mangleAndIntern(name)] = llvm::orc::ExecutorSymbolDef(
+            llvm::orc::ExecutorAddr::fromPtr(address), llvm::JITSymbolFlags::Exported);
+#else
+        runtime[jit_engine->mangleAndIntern(name)] = llvm::JITEvaluatedSymbol(
+            llvm::pointerToJITTargetAddress(address), llvm::JITSymbolFlags::Exported);
+#endif
+    };
+    // The runtime is part of libquill, so JIT-compiled programs call straight
+    // into this process
+#define QUILL_DEFINE_RUNTIME_SYMBOL(name) define(#name, reinterpret_cast<void*>(&name));
+    QUILL_RUNTIME_SYMBOLS(QUILL_DEFINE_RUNTIME_SYMBOL)
+#undef QUILL_DEFINE_RUNTIME_SYMBOL
+    if (llvm::Error error = main.define(llvm::orc::absoluteSymbols(std::move(runtime)))) {
+        fail("could not define the runtime", std::move(error));
+    }
+    
+    auto process = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+        jit_engine->getDataLayout().getGlobalPrefix());
+    if (!process) fail("could not search the process", process.takeError());
+    main.addGenerator(std::move(*process));
+    return *jit_engine;
+}
@@ -0,0 +1,104 @@
+#include "json_writer.h"
+#include <cmath>
+#include <cstdio>
+
+using namespace quill;
+
+JsonWriter::JsonWriter(std::ostream& out) : out(out) {}
+
+void JsonWriter::beginObject() {
+    beginValue();
+    out << '{';
+    nonempty.push_back(false);
+}
+
+void JsonWriter::endObject() {
+    close('}');
+}
+
+void JsonWriter::beginArray() {
+    beginValue();
+    out << '[';
+    nonempty.push_back(false);
+}
+
+void JsonWriter::endArray() {
+    close(']');
+}
+
+void JsonWriter::key(const std::string& name) {
+    beginValue();
+    writeString(name);
+    out << ": ";
+    after_key = true;
+}
+
+void JsonWriter::value(const std::string& text) {
+    beginValue();
+    writeString(text);
+}
+
+void JsonWriter::writeString(const std::string& text) {
+    out << '"';
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out << escaped;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+void JsonWriter::value(const char* text) {
+    value(std::string(text));
+}
+
+void JsonWriter::value(bool flag) {
+    beginValue();
+    out << (flag ? "true" : "false");
+}
+
+void JsonWriter::value(double number) {
+    beginValue();
+    if (!std::isfinite(number)) {
+        out << "null";
+        return;
+    }
+    char formatted[32];
+    std::snprintf(formatted, sizeof(formatted), "%.12g", number);
+    out << formatted;
+}
+
+void JsonWriter::beginValue() {
+    if (after_key) {
+        after_key = false;
+        return;
+    }
+    if (nonempty.empty()) return;
+    if (nonempty.back()) out << ',';
+    nonempty.back() = true;
+    newline();
+}
+
+void JsonWriter::close(char bracket) {
+    bool had_values = nonempty.back();
+    nonempty.pop_back();
+    if (had_values) newline();
+    out << bracket;
+    if (nonempty.empty()) out << '\n';
+}
+
+void JsonWriter::newline() {
+    out << '\n' << std::string(2 * nonempty.size(), ' ');
+}
@@ -12,6 +12,8 @@ Lexer::Lexer(const std::string& src) : source(src), position(0), line(1), column
         {"elif", TokenType::ELIF},
         {"while", TokenType::WHILE},
         {"for", TokenType::FOR},
+        {"in", TokenType::IN},
+        {"parallel", TokenType::PARALLEL},
         {"return", TokenType::RETURN},
         {"print", TokenType::PRINT},
         {"True", TokenType::TRUE},
@@ -216,6 +218,11 @@ std::vector<Token> Lexer::tokenize() {
             tokens.push_back(Token(TokenType::GREATER_EQUAL, ">=", start_line, start_column));
             continue;
         }
+        if (c == '-' && peek_char() == '>') {
+            advance(); advance();
+            tokens.push_back(Token(TokenType::ARROW, "->", start_line, start_column));
+            continue;
+        }
         
         // Single-character tokens
         advance();
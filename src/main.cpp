@@ -1,23 +1,51 @@
-#include "lexer.h"
-#include "parser.h"
-#include "codegen.h"
+#include "compile_cache.h"
+#include "compile_server.h"
+#include "compiler_session.h"
+#include "json_writer.h"
 #include "optimization_passes.h"
 #include "timer.h"
-#include "type_checker.h"
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
 #include <iostream>
 #include <fstream>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <sys/resource.h>
+#include <thread>
 #include <vector>
 
 struct CompilerOptions {
-    std::string input_file;
+    std::vector<std::string> input_files;
+    unsigned jobs = 1;  // 0 for one per core
     std::string output_file;
     quill::QuillOptimizationManager::OptimizationLevel opt_level = quill::QuillOptimizationManager::O0;
     bool emit_llvm_ir = false;
     bool emit_assembly = false;
     bool show_optimization_report = false;
     bool show_timing = false;
+    std::string time_trace;
+    std::string stats_json;
+    bool memoize = false;
+    bool no_memoize = false;
+    bool no_link_runtime = false;
+    std::string profile_generate;
+    std::string profile_use;
+    bool use_cache = false;
+    bool cache_stats = false;
+    std::string cache_dir;
+    uint64_t cache_size = quill::CompileCache::DEFAULT_MAX_BYTES;
+    bool server = false;
+    bool client = false;
+    std::string server_socket;
+    bool fast_math = false;
+    bool associative_math = false;
+    bool no_signed_zeros = false;
     bool enable_type_checking = true;
     bool show_type_errors = true;
     bool help = false;
@@ -25,17 +53,46 @@ struct CompilerOptions {
 
 void print_usage(const char* program_name) {
     std::cout << "Quill Compiler - Python-inspired Language\n\n";
-    std::cout << "Usage: " << program_name << " [OPTIONS] <source_file>\n\n";
+    std::cout << "Usage: " << program_name << " [OPTIONS] <source_file>...\n\n";
     std::cout << "Options:\n";
     std::cout << "  -O0              No optimization (default)\n";
     std::cout << "  -O1              Basic optimizations\n";
     std::cout << "  -O2              More aggressive optimizations\n";
     std::cout << "  -O3              Maximum optimization\n";
-    std::cout << "  -o <file>        Output file name\n";
+    std::cout << "  -o <file>        Output file name (one input only; default <source_file>.o)\n";
+    std::cout << "  -j <N>           Compile up to N files at once (0 for one per core)\n";
+    std::cout << "  @<filelist>      Compile the files listed one per line in <filelist>\n";
     std::cout << "  --emit-llvm      Emit LLVM IR instead of object file\n";
     std::cout << "  --emit-asm       Emit assembly code\n";
     std::cout << "  --opt-report     Show optimization report\n";
     std::cout << "  --timing         Show compilation timing\n";
+    std::cout << "  --stats-json=<file>\n";
+    std::cout << "                   Write phase timings, optimization counters and memory use as JSON\n";
+    std::cout << "  --time-trace=<file>\n";
+    std::cout << "                   Write a Chrome trace of every phase, pass and function to <file>\n";
+    std::cout << "  --memoize        Cache results of pure recursive functions (default at -O3)\n";
+    std::cout << "  --no-memoize     Never memoize, even at -O3\n";
+    std::cout << "  --no-link-runtime\n";
+    std::cout << "                   Leave the runtime to the final link instead of optimizing it in\n";
+    std::cout << "  --profile-generate[=<file>]\n";
+    std::cout << "                   Instrument the program to write a raw profile (default default_%m.profraw)\n";
+    std::cout << "  --profile-use=<file>\n";
+    std::cout << "                   Optimize with a profile merged by llvm-profdata\n";
+    std::cout << "  --cache          Reuse earlier compiles of this file or of its unchanged functions\n";
+    std::cout << "  --cache-dir=<dir>\n";
+    std::cout << "                   Cache directory (implies --cache; default $QUILL_CACHE_DIR)\n";
+    std::cout << "  --cache-size=<MiB>\n";
+    std::cout << "                   Evict least recently used entries beyond this size (default 512, 0 for no limit)\n";
+    std::cout << "  --cache-stats    Show cache hits, misses and size\n";
+    std::cout << "  --server[=<socket>]\n";
+    std::cout << "                   Serve compiles from warm state on a Unix socket (default $QUILL_SERVER_SOCKET)\n";
+    std::cout << "  --client[=<socket>]\n";
+    std::cout << "                   Compile through a running --server, falling back to compiling here\n";
+    std::cout << "  --ffast-math     Allow all IEEE-unsafe floating-point rewrites\n";
+    std::cout << "  --fassociative-math\n";
+    std::cout << "                   Allow reassociating floating-point math (vectorizes sums)\n";
+    std::cout << "  --fno-signed-zeros\n";
+    std::cout << "                   Treat -0.0 and +0.0 as interchangeable\n";
     std::cout << "  --no-typecheck   Disable type checking\n";
     std::cout << "  --type-errors    Show detailed type error information\n";
     std::cout << "  -h, --help       Show this help message\n\n";
@@ -44,6 +101,8 @@ void print_usage(const char* program_name) {
     std::cout << "  " << program_name << " -O3 --opt-report program.quill\n";
     std::cout << "  " << program_name << " --emit-llvm program.quill\n";
     std::cout << "  " << program_name << " --type-errors --timing program.quill\n";
+    std::cout << "  " << program_name << " --client -O2 program.quill\n";
+    std::cout << "  " << program_name << " -O2 -j 8 @strategies.txt\n";
 }
 
 CompilerOptions parse_arguments(int argc, char* argv[]) {
@@ -66,18 +125,84 @@ CompilerOptions parse_arguments(int argc, char* argv[]) {
             options.emit_llvm_ir = true;
         } else if (arg == "--emit-asm") {
             options.emit_assembly = true;
+        } else if (arg == "--memoize") {
+            options.memoize = true;
+        } else if (arg == "--no-memoize") {
+            options.no_memoize = true;
+        } else if (arg == "--no-link-runtime") {
+            options.no_link_runtime = true;
+        } else if (arg == "--profile-generate") {
+            options.profile_generate = "default_%m.profraw";
+        } else if (arg.rfind("--profile-generate=", 0) == 0) {
+            options.profile_generate = arg.substr(std::string("--profile-generate=").size());
+        } else if (arg.rfind("--profile-use=", 0) == 0) {
+            options.profile_use = arg.substr(std::string("--profile-use=").size());
+        } else if (arg == "--cache") {
+            options.use_cache = true;
+        } else if (arg.rfind("--cache-dir=", 0) == 0) {
+            options.use_cache = true;
+            options.cache_dir = arg.substr(std::string("--cache-dir=").size());
+        } else if (arg.rfind("--cache-size=", 0) == 0) {
+            // Whole MiB, no more than fit in a byte count
+            std::string value = arg.substr(std::string("--cache-size=").size());
+            char* end = nullptr;
+            errno = 0;
+            unsigned long long mib = std::strtoull(value.c_str(), &end, 10);
+            if (value.empty() || !std::isdigit((unsigned char)value[0]) || *end != '\0' || errno == ERANGE ||
+                mib > (UINT64_MAX >> 20)) {
+                std::cerr << "Invalid cache size: " << value << std::endl;
+                options.help = true;
+            } else {
+                options.cache_size = (uint64_t)mib << 20;
+            }
+        } else if (arg == "--cache-stats") {
+            options.cache_stats = true;
+        } else if (arg == "--server") {
+            options.server = true;
+        } else if (arg.rfind("--server=", 0) == 0) {
+            options.server = true;
+            options.server_socket = arg.substr(std::string("--server=").size());
+        } else if (arg == "--client") {
+            options.client = true;
+        } else if (arg.rfind("--client=", 0) == 0) {
+            options.client = true;
+            options.server_socket = arg.substr(std::string("--client=").size());
+        } else if (arg == "--ffast-math") {
+            options.fast_math = true;
+        } else if (arg == "--fassociative-math") {
+            options.associative_math = true;
+        } else if (arg == "--fno-signed-zeros") {
+            options.no_signed_zeros = true;
         } else if (arg == "--opt-report") {
             options.show_optimization_report = true;
         } else if (arg == "--timing") {
             options.show_timing = true;
+        } else if (arg.rfind("--stats-json=", 0) == 0) {
+            options.stats_json = arg.substr(std::string("--stats-json=").size());
+        } else if (arg.rfind("--time-trace=", 0) == 0) {
+            options.time_trace = arg.substr(std::string("--time-trace=").size());
         } else if (arg == "--no-typecheck") {
             options.enable_type_checking = false;
         } else if (arg == "--type-errors") {
             options.show_type_errors = true;
         } else if (arg == "-o" && i + 1 < argc) {
             options.output_file = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            options.jobs = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2 && std::isdigit((unsigned char)arg[2])) {
+            options.jobs = std::strtoul(arg.c_str() + 2, nullptr, 10);
+        } else if (arg.front() == '@') {
+            // An unreadable list is reported like an unreadable source
+            std::ifstream list(arg.substr(1));
+            if (!list.is_open()) options.input_files.push_back(arg.substr(1));
+            std::string line;
+            while (std::getline(list, line)) {
+                size_t begin = line.find_first_not_of(" \t\r");
+                size_t end = line.find_last_not_of(" \t\r");
+                if (begin != std::string::npos) options.input_files.push_back(line.substr(begin, end - begin + 1));
+            }
         } else if (arg.front() != '-') {
-            options.input_file = arg;
+            options.input_files.push_back(arg);
         } else {
             std::cerr << "Unknown option: " << arg << std::endl;
             options.help = true;
@@ -87,27 +212,46 @@ CompilerOptions parse_arguments(int argc, char* argv[]) {
     return options;
 }
 
-int main(int argc, char* argv[]) {
-    CompilerOptions options = parse_arguments(argc, argv);
-    
-    if (options.help || options.input_file.empty()) {
-        print_usage(argv[0]);
-        return options.help ? 0 : 1;
-    }
-    
-    // Set default output file if not specified
-    if (options.output_file.empty()) {
-        options.output_file = options.input_file + ".o";
-    }
+// Everything that changes the emitted module; reporting flags are left out
+std::string compute_cache_key(const CompilerOptions& options, const std::string& source,
+                              const std::string& compiler_identity) {
+    quill::CompileCache::KeyBuilder key;
+    key.add("compiler", compiler_identity);
+    key.add("source", source);
+    key.add("opt", std::to_string((int)options.opt_level));
+    key.add("flags", std::string() +
+            (options.memoize ? 'm' : '-') + (options.no_memoize ? 'M' : '-') +
+            (options.no_link_runtime ? 'R' : '-') + (options.fast_math ? 'f' : '-') +
+            (options.associative_math ? 'a' : '-') + (options.no_signed_zeros ? 'z' : '-') +
+            (options.enable_type_checking ? 't' : '-'));
+    key.add("profile-generate", options.profile_generate);
+    if (!options.profile_use.empty()) key.addFile("profile-use", options.profile_use);
+    return key.finish();
+}
+
+// What --stats-json reports for one input
+struct FileStatistics {
+    bool compiled = false;
+    double total_ms = 0;
+    quill::CompileResult result;  // without its module
+};
+
+// Compiles one source file. Messages go to `out` and `err` so batch
+// workers can hold them until the file is done.
+int compile_file(const CompilerOptions& options, const std::string& input_file, std::ostream& out,
+                 std::ostream& err, quill::CompileCache* cache, const std::string& compiler_identity,
+                 FileStatistics* statistics = nullptr) {
+    std::string output_file = options.output_file.empty() ? input_file + ".o" : options.output_file;
     
     BenchmarkTimer total_timer("Total Compilation");
     total_timer.start();
+    llvm::TimeTraceScope trace_scope("Compile", input_file);
     
     try {
         // Read source file
-        std::ifstream file(options.input_file);
+        std::ifstream file(input_file);
         if (!file.is_open()) {
-            std::cerr << "Error: Could not open file " << options.input_file << std::endl;
+            err << "Error: Could not open file " << input_file << std::endl;
             return 1;
         }
         
@@ -116,124 +260,341 @@ int main(int argc, char* argv[]) {
         std::string source = buffer.str();
         file.close();
         
-        if (options.show_timing) {
-            std::cout << "=== Quill Compiler Performance Analysis ===" << std::endl;
-        }
-        
-        // Lexical analysis
-        BenchmarkTimer lex_timer("Lexical Analysis");
-        if (options.show_timing) lex_timer.start();
-        
-        Lexer lexer(source);
-        auto tokens = lexer.tokenize();
-        
-        if (options.show_timing) {
-            lex_timer.stop();
-            std::cout << "Lexical Analysis: " << lex_timer.get_last_measurement_ms() 
-                      << " ms (" << tokens.size() << " tokens)" << std::endl;
-        }
-        
-        // Syntax analysis
-        BenchmarkTimer parse_timer("Parsing");
-        if (options.show_timing) parse_timer.start();
-        
-        Parser parser(std::move(tokens));
-        auto program = parser.parse();
-        
-        if (options.show_timing) {
-            parse_timer.stop();
-            std::cout << "Parsing: " << parse_timer.get_last_measurement_ms() << " ms" << std::endl;
-        }
-        
-        // Type checking (if enabled)
-        if (options.enable_type_checking) {
-            BenchmarkTimer typecheck_timer("Type Checking");
-            if (options.show_timing) typecheck_timer.start();
-            
-            quill::TypeChecker type_checker;
-            auto type_result = type_checker.checkProgram(program.get());
-            
-            if (options.show_timing) {
-                typecheck_timer.stop();
-                std::cout << "Type Checking: " << typecheck_timer.get_last_measurement_ms() << " ms" << std::endl;
-            }
-            
-            // Report type checking results
-            if (type_result.hasErrors() || !type_checker.getErrors().empty()) {
-                if (options.show_type_errors) {
-                    std::cout << "\nType Checking Results:" << std::endl;
-                    const auto& errors = type_checker.getErrors();
-                    for (const auto& error : errors) {
-                        std::cout << "Error: " << error << std::endl;
-                    }
-                    
-                    const auto& warnings = type_checker.getWarnings();
-                    for (const auto& warning : warnings) {
-                        std::cout << "Warning: " << warning << std::endl;
+        // An identical earlier compile already produced the output. Timing,
+        // optimization reports and statistics describe a real compile, so
+        // they skip it.
+        std::string cache_key;
+        if (options.use_cache) {
+            cache_key = compute_cache_key(options, source, compiler_identity);
+            std::string artifact;
+            if (!options.show_timing && !options.show_optimization_report && options.stats_json.empty() &&
+                cache->lookup(cache_key, artifact)) {
+                if (options.emit_llvm_ir) {
+                    out << "\n=== Generated LLVM IR ===" << std::endl;
+                    out << artifact;
+                } else {
+                    std::ofstream output(output_file, std::ios::binary);
+                    if (!(output << artifact)) {
+                        err << "Could not write " << output_file << std::endl;
+                        return 1;
                     }
+                    out << "Successfully compiled '" << input_file 
+                              << "' with -O" << (int)options.opt_level << " (cached)" << std::endl;
+                    out << "Output written to: " << output_file << std::endl;
                 }
-            } else if (options.show_type_errors) {
-                std::cout << "Type checking passed successfully" << std::endl;
+                return 0;
             }
         }
         
-        // Code generation
-        BenchmarkTimer codegen_timer("Code Generation");
-        if (options.show_timing) codegen_timer.start();
-        
-        CodeGen codegen;
-        codegen.generate(*program);
+        quill::SessionOptions session_options;
+        session_options.opt_level = options.opt_level;
+        session_options.type_checking = options.enable_type_checking;
+        session_options.memoize = options.memoize;
+        session_options.no_memoize = options.no_memoize;
+        session_options.link_runtime = !options.no_link_runtime;
+        session_options.fast_math = options.fast_math;
+        session_options.associative_math = options.associative_math;
+        session_options.no_signed_zeros = options.no_signed_zeros;
+        session_options.profile_generate = options.profile_generate;
+        session_options.profile_use = options.profile_use;
+        session_options.detailed_statistics = statistics != nullptr;
+        if (options.use_cache) {
+            session_options.cache = cache;
+            session_options.cache_salt = compiler_identity;
+        }
+        quill::CompilerSession session(session_options);
+        quill::CompileResult result = session.compile(source);
         
         if (options.show_timing) {
-            codegen_timer.stop();
-            std::cout << "Code Generation: " << codegen_timer.get_last_measurement_ms() << " ms" << std::endl;
+            out << "=== Quill Compiler Performance Analysis ===" << std::endl;
+            out << "Lexical Analysis: " << result.lexing_ms << " ms (" << result.tokens << " tokens)" << std::endl;
+            out << "Parsing: " << result.parsing_ms << " ms" << std::endl;
+            if (options.enable_type_checking) {
+                out << "Type Checking: " << result.type_checking_ms << " ms" << std::endl;
+            }
         }
         
-        // Optimization
-        BenchmarkTimer opt_timer("Optimization");
-        if (options.show_timing) opt_timer.start();
-        
-        quill::QuillOptimizationManager optimizer(options.opt_level);
-        if (options.opt_level != quill::QuillOptimizationManager::O0) {
-            optimizer.runOptimizations(*codegen.module);
+        // Report type checking results
+        if (options.enable_type_checking && options.show_type_errors) {
+            if (result.type_errors) {
+                out << "\nType Checking Results:" << std::endl;
+                for (const auto& error : result.errors) {
+                    out << "Error: " << error << std::endl;
+                }
+                for (const auto& warning : result.warnings) {
+                    out << "Warning: " << warning << std::endl;
+                }
+            } else {
+                out << "Type checking passed successfully" << std::endl;
+            }
         }
         
         if (options.show_timing) {
-            opt_timer.stop();
-            std::cout << "Optimization: " << opt_timer.get_last_measurement_ms() << " ms" << std::endl;
+            out << "Code Generation: " << result.codegen_ms << " ms" << std::endl;
+            out << "Optimization: " << result.optimization_ms << " ms" << std::endl;
         }
         
         // Show optimization report
         if (options.show_optimization_report) {
-            optimizer.printOptimizationReport();
+            result.optimizer->printOptimizationReport(out);
         }
         
         // Output generation
+        std::string ir = result.irText();
         if (options.emit_llvm_ir) {
-            std::cout << "\n=== Generated LLVM IR ===" << std::endl;
-            codegen.print_ir();
+            out << "\n=== Generated LLVM IR ===" << std::endl;
+            out << ir;
         } else {
-            // Write object/assembly file
-            codegen.write_object_file(options.output_file);
+            // The "object" file holds LLVM IR for llc
+            std::ofstream output(output_file, std::ios::binary);
+            if (!(output << ir)) {
+                err << "Could not write " << output_file << std::endl;
+                return 1;
+            }
+            out << "Note: Generated LLVM IR instead of object file. " << std::endl;
+            out << "To compile to object: llc " << output_file << " -o " << output_file << ".o" << std::endl;
             
             if (!options.show_timing) {
-                std::cout << "Successfully compiled '" << options.input_file 
-                          << "' with -O" << (int)options.opt_level << std::endl;
-                std::cout << "Output written to: " << options.output_file << std::endl;
+                out << "Successfully compiled '" << input_file 
+                    << "' with -O" << (int)options.opt_level << std::endl;
+                out << "Output written to: " << output_file << std::endl;
             }
         }
         
+        // Diagnostics are not cached, so only clean compiles are stored
+        if (options.use_cache && !result.hasDiagnostics()) {
+            cache->store(cache_key, ir);
+        }
+        
         total_timer.stop();
         
         if (options.show_timing) {
-            std::cout << "Total Compilation: " << total_timer.get_last_measurement_ms() << " ms" << std::endl;
-            std::cout << "===========================================" << std::endl;
+            out << "Total Compilation: " << total_timer.get_last_measurement_ms() << " ms" << std::endl;
+            out << "===========================================" << std::endl;
         }
         
+        if (statistics) {
+            statistics->compiled = true;
+            statistics->total_ms = total_timer.get_last_measurement_ms();
+            result.module.reset();
+            result.context.reset();
+            statistics->result = std::move(result);
+        }
+    
     } catch (const std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
+        err << "Error: " << e.what() << std::endl;
         return 1;
     }
     
     return 0;
-}
\ No newline at end of file
+}
+
+// Compiles every input on `jobs` threads, each file in its own LLVM
+// context. Output is printed a file at a time as each one finishes.
+int compile_batch(const CompilerOptions& options, unsigned jobs, quill::CompileCache* cache,
+                  const std::string& compiler_identity, std::vector<FileStatistics>* statistics) {
+    // Workers would otherwise all wait on the first one to detect the host
+    quill::QuillOptimizationManager::initializeHost();
+    
+    std::atomic<size_t> next_file(0);
+    std::atomic<unsigned> failures(0);
+    std::mutex output_mutex;
+    auto worker = [&] {
+        for (size_t i = next_file++; i < options.input_files.size(); i = next_file++) {
+            std::ostringstream out, err;
+            int status = compile_file(options, options.input_files[i], out, err, cache, compiler_identity,
+                                      statistics ? &(*statistics)[i] : nullptr);
+            if (status != 0) failures++;
+            
+            std::lock_guard<std::mutex> lock(output_mutex);
+            std::cout << out.str() << std::flush;
+            std::cerr << err.str() << std::flush;
+        }
+    };
+    
+    // Each worker records its own trace, written out with the main thread's
+    auto traced_worker = [&] {
+        if (!options.time_trace.empty()) llvm::timeTraceProfilerInitialize(0, "quill");
+        worker();
+        if (!options.time_trace.empty()) llvm::timeTraceProfilerFinishThread();
+    };
+    
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < jobs; ++i) workers.emplace_back(traced_worker);
+    worker();
+    for (std::thread& thread : workers) thread.join();
+    
+    if (failures > 0) {
+        std::cerr << "Error: " << failures << " of " << options.input_files.size() << " files failed to compile"
+                  << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+bool write_stats_json(const CompilerOptions& options, const std::vector<FileStatistics>& statistics) {
+    std::ofstream file(options.stats_json);
+    quill::JsonWriter json(file);
+    json.beginObject();
+    json.field("opt_level", (int)options.opt_level);
+    json.key("files");
+    json.beginArray();
+    for (size_t i = 0; i < statistics.size(); ++i) {
+        const FileStatistics &file_statistics = statistics[i];
+        const quill::CompileResult &result = file_statistics.result;
+        json.beginObject();
+        json.field("file", options.input_files[i]);
+        json.field("status", file_statistics.compiled ? "compiled" : "failed");
+        if (file_statistics.compiled) {
+            json.field("tokens", result.tokens);
+            json.field("type_errors", result.type_errors);
+            json.key("phases_ms");
+            json.beginObject();
+            json.field("lexing", result.lexing_ms);
+            json.field("parsing", result.parsing_ms);
+            json.field("type_checking", result.type_checking_ms);
+            json.field("codegen", result.codegen_ms);
+            json.field("optimization", result.optimization_ms);
+            json.field("total", file_statistics.total_ms);
+            json.endObject();
+            json.key("optimization");
+            result.optimizer->writeStatisticsJSON(json);
+        }
+        json.endObject();
+    }
+    json.endArray();
+    
+    // Process-wide: with -j, files compiled at once share the peak
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    json.field("peak_rss_kb", (long)usage.ru_maxrss);
+    json.endObject();
+    return static_cast<bool>(file);
+}
+
+int run_compiler(int argc, char* argv[]) {
+    CompilerOptions options = parse_arguments(argc, argv);
+    
+    std::unique_ptr<quill::CompileCache> cache;
+    if (options.use_cache || options.cache_stats) {
+        cache = std::make_unique<quill::CompileCache>(
+            options.cache_dir.empty() ? quill::CompileCache::defaultDirectory() : options.cache_dir,
+            options.cache_size);
+    }
+    if (options.cache_stats && options.input_files.empty() && !options.help) {
+        cache->printStats();
+        return 0;
+    }
+    
+    if (options.help || options.input_files.empty()) {
+        print_usage(argv[0]);
+        return options.help ? 0 : 1;
+    }
+    
+    if (!options.profile_generate.empty() && !options.profile_use.empty()) {
+        std::cerr << "Error: --profile-generate and --profile-use cannot be combined" << std::endl;
+        return 1;
+    }
+    if (!options.profile_use.empty() && !std::ifstream(options.profile_use).good()) {
+        std::cerr << "Error: Could not open profile " << options.profile_use << std::endl;
+        return 1;
+    }
+    if (options.input_files.size() > 1 && !options.output_file.empty()) {
+        std::cerr << "Error: -o cannot be used with several input files" << std::endl;
+        return 1;
+    }
+    
+    std::string compiler_identity;
+    if (options.use_cache) compiler_identity = quill::CompileCache::compilerIdentity(argv[0]);
+    
+    if (!options.time_trace.empty()) llvm::timeTraceProfilerInitialize(0, "quill");
+    
+    unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min<size_t>(jobs, options.input_files.size());
+    std::vector<FileStatistics> statistics(options.stats_json.empty() ? 0 : options.input_files.size());
+    std::vector<FileStatistics>* collected = options.stats_json.empty() ? nullptr : &statistics;
+    int status = 0;
+    if (jobs > 1) {
+        status = compile_batch(options, jobs, cache.get(), compiler_identity, collected);
+    } else {
+        for (size_t i = 0; i < options.input_files.size(); ++i) {
+            if (compile_file(options, options.input_files[i], std::cout, std::cerr, cache.get(), compiler_identity,
+                             collected ? &statistics[i] : nullptr) != 0) {
+                status = 1;
+            }
+        }
+    }
+    
+    if (collected && !write_stats_json(options, statistics)) {
+        std::cerr << "Error: Could not write " << options.stats_json << std::endl;
+        status = 1;
+    }
+    
+    if (!options.time_trace.empty()) {
+        if (llvm::Error error = llvm::timeTraceProfilerWrite(options.time_trace, options.time_trace)) {
+            std::cerr << "Error: Could not write " << options.time_trace << ": " << llvm::toString(std::move(error))
+                      << std::endl;
+            status = 1;
+        }
+        llvm::timeTraceProfilerCleanup();
+    }
+    
+    if (options.cache_stats) cache->printStats();
+    return status;
+}
+
+// Compiles a small program through every stage so the server forks with
+// LLVM's lazily built state (pass registries, target tables, host CPU
+// features) already in place
+void warm_up() {
+    const char* program =
+        "def square(x: float) -> float:\n"
+        "    return x * x\n"
+        "\n"
+        "def main():\n"
+        "    values = [1.5, 2.5, 3.5]\n"
+        "    total = 0.0\n"
+        "    for i in range(len(values)):\n"
+        "        total = total + square(values[i])\n"
+        "    print(total)\n";
+    
+    quill::SessionOptions options;
+    options.opt_level = quill::QuillOptimizationManager::O3;
+    quill::CompilerSession(options).emitIR(program);
+}
+
+int main(int argc, char* argv[]) {
+    CompilerOptions options = parse_arguments(argc, argv);
+    // Resolving the default may create its directory, so only servers and clients do
+    std::string socket_path;
+    if ((options.server && !options.help) || options.client) {
+        socket_path = options.server_socket.empty() ? quill::CompileServer::defaultSocketPath()
+                                                    : options.server_socket;
+    }
+    
+    if (options.server && !options.help) {
+        quill::QuillOptimizationManager::initializeHost();
+        warm_up();
+        return quill::CompileServer(socket_path).serve([](int argc, char* argv[]) {
+            int status = run_compiler(argc, argv);
+            llvm::outs().flush();
+            llvm::errs().flush();
+            return status;
+        });
+    }
+    
+    if (options.client) {
+        std::vector<std::string> args;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg != "--client" && arg.rfind("--client=", 0) != 0) args.push_back(arg);
+        }
+        int status;
+        if (quill::CompileServer::forward(socket_path, args, status)) return status;
+        if (!socket_path.empty()) {
+            std::cerr << "Note: no compile server at " << socket_path << ", compiling locally" << std::endl;
+        }
+    }
+    
+    return run_compiler(argc, argv);
+}
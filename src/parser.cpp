@@ -48,8 +48,8 @@ void Parser::skip_newlines() {
 
 std::unique_ptr<ExprAST> Parser::parse_primary() {
     if (match(TokenType::NUMBER)) {
-        double value = std::stod(tokens[current - 1].value);
-        return std::make_unique<NumberExprAST>(value);
+        const std::string& text = tokens[current - 1].value;
+        return std::make_unique<NumberExprAST>(std::stod(text), text.find('.') != std::string::npos);
     }
     
     if (match(TokenType::STRING)) {
@@ -84,6 +84,20 @@ std::unique_ptr<ExprAST> Parser::parse_primary() {
         return expr;
     }
     
+    // List literal
+    if (match(TokenType::LEFT_BRACKET)) {
+        std::vector<std::unique_ptr<ExprAST>> elements;
+        
+        if (!check(TokenType::RIGHT_BRACKET)) {
+            do {
+                elements.push_back(parse_expression());
+            } while (match(TokenType::COMMA));
+        }
+        
+        consume(TokenType::RIGHT_BRACKET, "Expected ']' after list elements");
+        return std::make_unique<ListExprAST>(std::move(elements));
+    }
+    
     if (match(TokenType::TRUE)) {
         return std::make_unique<NumberExprAST>(1.0);
     }
@@ -102,7 +116,19 @@ std::unique_ptr<ExprAST> Parser::parse_unary() {
         return std::make_unique<UnaryExprAST>(op, std::move(operand));
     }
     
-    return parse_primary();
+    return parse_postfix();
+}
+
+std::unique_ptr<ExprAST> Parser::parse_postfix() {
+    auto expr = parse_primary();
+    
+    while (match(TokenType::LEFT_BRACKET)) {
+        auto index = parse_expression();
+        consume(TokenType::RIGHT_BRACKET, "Expected ']' after index");
+        expr = std::make_unique<IndexExprAST>(std::move(expr), std::move(index));
+    }
+    
+    return expr;
 }
 
 std::unique_ptr<ExprAST> Parser::parse_factor() {
@@ -204,6 +230,20 @@ std::unique_ptr<StmtAST> Parser::parse_assignment() {
 
 std::unique_ptr<StmtAST> Parser::parse_expression_statement() {
     auto expr = parse_expression();
+    
+    // Element store: xs[i] = value
+    if (match(TokenType::ASSIGN)) {
+        std::unique_ptr<IndexExprAST> target(dynamic_cast<IndexExprAST*>(expr.get()));
+        if (!target) {
+            throw std::runtime_error("Invalid assignment target at line " +
+                                     std::to_string(tokens[current - 1].line));
+        }
+        expr.release();
+        
+        auto value = parse_expression();
+        return std::make_unique<IndexAssignmentStmtAST>(std::move(target), std::move(value));
+    }
+    
     return std::make_unique<ExprStmtAST>(std::move(expr));
 }
 
@@ -235,6 +275,64 @@ std::unique_ptr<StmtAST> Parser::parse_while_statement() {
     return std::make_unique<WhileStmtAST>(std::move(condition), std::move(body));
 }
 
+std::unique_ptr<StmtAST> Parser::parse_for_statement(bool parallel) {
+    consume(TokenType::FOR, parallel ? "Expected 'for' after 'parallel'" : "Expected 'for'");
+    
+    if (!check(TokenType::IDENTIFIER)) {
+        throw std::runtime_error("Expected loop variable at line " + std::to_string(current_token().line));
+    }
+    std::string var = current_token().value;
+    advance();
+    
+    consume(TokenType::IN, "Expected 'in' after loop variable");
+    if (!check(TokenType::IDENTIFIER) || current_token().value != "range") {
+        throw std::runtime_error("Only 'for ... in range(...)' loops are supported at line " +
+                                 std::to_string(current_token().line));
+    }
+    advance();
+    consume(TokenType::LEFT_PAREN, "Expected '(' after 'range'");
+    
+    std::vector<std::unique_ptr<ExprAST>> args;
+    do {
+        args.push_back(parse_expression());
+    } while (match(TokenType::COMMA));
+    consume(TokenType::RIGHT_PAREN, "Expected ')' after range arguments");
+    
+    if (args.size() > 3) {
+        throw std::runtime_error("range() takes at most 3 arguments at line " +
+                                 std::to_string(tokens[current - 1].line));
+    }
+    
+    // The step decides the exit comparison, so it must be a constant
+    long long step = 1;
+    if (args.size() == 3) {
+        ExprAST* step_expr = args[2].get();
+        bool negative = false;
+        if (auto unary = dynamic_cast<UnaryExprAST*>(step_expr)) {
+            negative = unary->op == '-';
+            step_expr = negative ? unary->operand.get() : nullptr;
+        }
+        auto number = dynamic_cast<NumberExprAST*>(step_expr);
+        if (!number || number->is_float || number->value != static_cast<long long>(number->value) || number->value == 0) {
+            throw std::runtime_error("range() step must be a nonzero integer constant at line " +
+                                     std::to_string(tokens[current - 1].line));
+        }
+        step = negative ? -static_cast<long long>(number->value) : static_cast<long long>(number->value);
+        args.pop_back();
+    }
+    
+    std::unique_ptr<ExprAST> start = args.size() == 2 ? std::move(args[0]) : nullptr;
+    std::unique_ptr<ExprAST> stop = std::move(args.back());
+    
+    consume(TokenType::COLON, "Expected ':' after for clause");
+    skip_newlines();
+    
+    auto body = parse_block();
+    auto loop = std::make_unique<ForRangeStmtAST>(var, std::move(start), std::move(stop), step, std::move(body));
+    loop->parallel = parallel;
+    return loop;
+}
+
 std::unique_ptr<StmtAST> Parser::parse_return_statement() {
     consume(TokenType::RETURN, "Expected 'return'");
     
@@ -282,6 +380,14 @@ std::unique_ptr<StmtAST> Parser::parse_statement() {
         return parse_while_statement();
     }
     
+    if (check(TokenType::FOR)) {
+        return parse_for_statement();
+    }
+    
+    if (match(TokenType::PARALLEL)) {
+        return parse_for_statement(true);
+    }
+    
     if (check(TokenType::RETURN)) {
         return parse_return_statement();
     }
@@ -306,6 +412,7 @@ std::unique_ptr<FunctionAST> Parser::parse_function() {
     consume(TokenType::LEFT_PAREN, "Expected '(' after function name");
     
     std::vector<std::string> args;
+    std::vector<std::string> arg_types;
     if (!check(TokenType::RIGHT_PAREN)) {
         do {
             if (!check(TokenType::IDENTIFIER)) {
@@ -313,15 +420,48 @@ std::unique_ptr<FunctionAST> Parser::parse_function() {
             }
             args.push_back(current_token().value);
             advance();
+            
+            // Optional annotation: name: type
+            arg_types.push_back(match(TokenType::COLON) ? parse_type_annotation() : "");
         } while (match(TokenType::COMMA));
     }
     
     consume(TokenType::RIGHT_PAREN, "Expected ')' after parameters");
+    
+    // Optional return annotation: -> type
+    std::string return_type;
+    if (match(TokenType::ARROW)) {
+        return_type = parse_type_annotation();
+    }
+    
     consume(TokenType::COLON, "Expected ':' after function signature");
     skip_newlines();
     
     auto body = parse_block();
-    return std::make_unique<FunctionAST>(name, std::move(args), std::move(body));
+    return std::make_unique<FunctionAST>(name, std::move(args), std::move(body),
+                                         std::move(arg_types), return_type);
+}
+
+std::string Parser::parse_type_annotation() {
+    if (!check(TokenType::IDENTIFIER)) {
+        throw std::runtime_error("Expected type name at line " + std::to_string(current_token().line));
+    }
+    
+    std::string annotation = current_token().value;
+    advance();
+    
+    // Parameterized types: list[int], tuple[int, float]
+    if (match(TokenType::LEFT_BRACKET)) {
+        annotation += "[";
+        do {
+            if (annotation.back() != '[') annotation += ", ";
+            annotation += parse_type_annotation();
+        } while (match(TokenType::COMMA));
+        consume(TokenType::RIGHT_BRACKET, "Expected ']' after type parameters");
+        annotation += "]";
+    }
+    
+    return annotation;
 }
 
 std::unique_ptr<ProgramAST> Parser::parse() {
@@ -0,0 +1,33 @@
+#include "compile_server.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <limits.h>
+#include <unistd.h>
+
+// Sends its arguments to a running `quill --server`. Without a server it
+// runs the quill next to it with the same arguments, so scripts can always
+// call quill-client.
+int main(int argc, char* argv[]) {
+    std::string socket_path = quill::CompileServer::defaultSocketPath();
+    std::vector<std::string> args(argv + 1, argv + argc);
+    int status;
+    if (quill::CompileServer::forward(socket_path, args, status)) return status;
+    
+    char executable[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+    std::string compiler = "quill";
+    if (length > 0) {
+        std::string self(executable, length);
+        compiler = self.substr(0, self.rfind('/') + 1) + "quill";
+    }
+    
+    argv[0] = &compiler[0];
+    execv(compiler.c_str(), argv);
+    execvp("quill", argv);
+    std::cerr << "Error: no compile server at " << socket_path << " and could not run quill: "
+              << std::strerror(errno) << std::endl;
+    return 1;
+}
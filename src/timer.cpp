@@ -1,16 +1,98 @@
 #include "timer.h"
+#include "json_writer.h"
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include <cmath>
 #include <algorithm>
 #include <functional>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// In the order of HardwareCounters' fields
+const uint64_t COUNTER_EVENTS[] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+const int COUNTER_COUNT = sizeof(COUNTER_EVENTS) / sizeof(COUNTER_EVENTS[0]);
+
+int open_counter(uint64_t event, int group_fd) {
+    perf_event_attr attr = {};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = event;
+    attr.disabled = group_fd == -1;
+    // User space only, which unprivileged processes may usually count
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+// Two-sided 95% critical values of Student's t for 1 to 30 degrees of freedom
+const double T_95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+// Rounds down to the nearest tabulated degrees of freedom, which errs wide
+double t_critical_95(size_t degrees) {
+    if (degrees <= 30) return T_95[degrees - 1];
+    if (degrees < 40) return 2.042;
+    if (degrees < 60) return 2.021;
+    if (degrees < 120) return 2.000;
+    return 1.980;
+}
+
+} // namespace
 
 BenchmarkTimer::BenchmarkTimer(const std::string& name) : benchmark_name(name) {
     measurements.reserve(100); // Pre-allocate for efficiency
 }
 
+BenchmarkTimer::~BenchmarkTimer() {
+#ifdef __linux__
+    for (int fd : counter_fds) close(fd);
+#endif
+}
+
+bool BenchmarkTimer::enable_hardware_counters() {
+#ifdef __linux__
+    if (!counter_fds.empty()) return true;
+    for (uint64_t event : COUNTER_EVENTS) {
+        int fd = open_counter(event, counter_fds.empty() ? -1 : counter_fds[0]);
+        if (fd == -1) {
+            for (int open_fd : counter_fds) close(open_fd);
+            counter_fds.clear();
+            return false;
+        }
+        counter_fds.push_back(fd);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
 void BenchmarkTimer::start() {
+#ifdef __linux__
+    if (!counter_fds.empty()) {
+        ioctl(counter_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(counter_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
     start_time = std::chrono::high_resolution_clock::now();
 }
 
@@ -19,10 +101,26 @@ void BenchmarkTimer::stop() {
     auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
     double ms = duration.count() / 1000000.0;
     measurements.push_back(ms);
+#ifdef __linux__
+    if (counter_fds.empty()) return;
+    ioctl(counter_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    // nr, time enabled, time running, then one value per event
+    uint64_t data[3 + COUNTER_COUNT] = {};
+    HardwareCounters counters;
+    if (read(counter_fds[0], data, sizeof(data)) == (ssize_t)sizeof(data) && data[2] > 0) {
+        // Scale up when the kernel multiplexed the group with other events
+        double scale = (double)data[1] / data[2];
+        uint64_t* fields[] = {&counters.cycles, &counters.instructions, &counters.cache_misses,
+                              &counters.branch_misses};
+        for (int i = 0; i < COUNTER_COUNT; i++) *fields[i] = (uint64_t)(data[3 + i] * scale);
+    }
+    counter_measurements.push_back(counters);
+#endif
 }
 
 void BenchmarkTimer::reset() {
     measurements.clear();
+    counter_measurements.clear();
 }
 
 double BenchmarkTimer::get_last_measurement_ms() const {
@@ -65,11 +163,48 @@ double BenchmarkTimer::get_stddev_ms() const {
     return std::sqrt(variance);
 }
 
-void BenchmarkTimer::run_benchmark(int iterations, std::function<void()> benchmark_func) {
+double BenchmarkTimer::get_median_ms() const {
+    return get_percentile_ms(50.0);
+}
+
+double BenchmarkTimer::get_percentile_ms(double percent) const {
+    if (measurements.empty()) return 0.0;
+    
+    std::vector<double> sorted = measurements;
+    std::sort(sorted.begin(), sorted.end());
+    double rank = std::min(std::max(percent, 0.0), 100.0) / 100.0 * (sorted.size() - 1);
+    size_t lower = (size_t)rank;
+    if (lower + 1 >= sorted.size()) return sorted.back();
+    return sorted[lower] + (rank - lower) * (sorted[lower + 1] - sorted[lower]);
+}
+
+double BenchmarkTimer::get_ci95_half_width_ms() const {
+    if (measurements.size() < 2) return 0.0;
+    return t_critical_95(measurements.size() - 1) * get_stddev_ms() / std::sqrt((double)measurements.size());
+}
+
+void BenchmarkTimer::run_benchmark(int iterations, std::function<void()> benchmark_func,
+                                   const BenchmarkOptions& options) {
     reset();
+    pinned_cpu = -1;
+    
+#ifdef __linux__
+    cpu_set_t previous_cpus;
+    bool pinned = false;
+    if (options.pin_cpu >= 0 && options.pin_cpu < CPU_SETSIZE &&
+        sched_getaffinity(0, sizeof(previous_cpus), &previous_cpus) == 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(options.pin_cpu, &cpus);
+        pinned = sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+        if (pinned) pinned_cpu = options.pin_cpu;
+    }
+#endif
     
-    // Warm-up run
-    benchmark_func();
+    // Warm-up runs
+    for (int i = 0; i < options.warmup_iterations; ++i) {
+        benchmark_func();
+    }
     
     // Actual measurements
     for (int i = 0; i < iterations; ++i) {
@@ -77,6 +212,10 @@ void BenchmarkTimer::run_benchmark(int iterations, std::function<void()> benchma
         benchmark_func();
         stop();
     }
+    
+#ifdef __linux__
+    if (pinned) sched_setaffinity(0, sizeof(previous_cpus), &previous_cpus);
+#endif
 }
 
 void BenchmarkTimer::print_results() const {
@@ -87,6 +226,27 @@ void BenchmarkTimer::print_results() const {
     std::cout << "Min: " << get_min_ms() << " ms" << std::endl;
     std::cout << "Max: " << get_max_ms() << " ms" << std::endl;
     std::cout << "StdDev: " << get_stddev_ms() << " ms" << std::endl;
+    std::cout << "Median: " << get_median_ms() << " ms" << std::endl;
+    std::cout << "P95: " << get_percentile_ms(95.0) << " ms" << std::endl;
+    std::cout << "P99: " << get_percentile_ms(99.0) << " ms" << std::endl;
+    std::cout << "95% CI: " << get_average_ms() << " +/- " << get_ci95_half_width_ms() << " ms" << std::endl;
+    if (!counter_measurements.empty()) {
+        HardwareCounters total;
+        for (const HardwareCounters& counters : counter_measurements) {
+            total.cycles += counters.cycles;
+            total.instructions += counters.instructions;
+            total.cache_misses += counters.cache_misses;
+            total.branch_misses += counters.branch_misses;
+        }
+        double runs = counter_measurements.size();
+        std::cout << std::setprecision(0);
+        std::cout << "Cycles/run: " << total.cycles / runs << std::endl;
+        std::cout << "Instructions/run: " << total.instructions / runs << std::endl;
+        std::cout << "Cache misses/run: " << total.cache_misses / runs << std::endl;
+        std::cout << "Branch misses/run: " << total.branch_misses / runs << std::endl;
+        std::cout << std::setprecision(3);
+        std::cout << "IPC: " << (total.cycles ? (double)total.instructions / total.cycles : 0.0) << std::endl;
+    }
     std::cout << "----------------------------------------" << std::endl;
 }
 
@@ -100,4 +260,53 @@ void BenchmarkTimer::save_results_csv(const std::string& filename) const {
          << get_min_ms() << ","
          << get_max_ms() << ","
          << get_stddev_ms() << std::endl;
+}
+
+void BenchmarkTimer::write_results_json(quill::JsonWriter& json) const {
+    json.beginObject();
+    json.field("name", benchmark_name);
+    json.field("runs", measurements.size());
+    json.field("pinned_cpu", pinned_cpu);
+    json.key("time_ms");
+    json.beginObject();
+    json.field("mean", get_average_ms());
+    json.field("median", get_median_ms());
+    json.field("min", get_min_ms());
+    json.field("max", get_max_ms());
+    json.field("stddev", get_stddev_ms());
+    json.field("p95", get_percentile_ms(95.0));
+    json.field("p99", get_percentile_ms(99.0));
+    json.field("ci95_half_width", get_ci95_half_width_ms());
+    json.key("samples");
+    json.beginArray();
+    for (double measurement : measurements) json.value(measurement);
+    json.endArray();
+    json.endObject();
+    if (!counter_measurements.empty()) {
+        // One array per event, aligned with the time samples
+        json.key("hardware_counters");
+        json.beginObject();
+        const char* names[] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+        for (int i = 0; i < 4; i++) {
+            json.key(names[i]);
+            json.beginArray();
+            for (const HardwareCounters& counters : counter_measurements) {
+                const uint64_t values[] = {counters.cycles, counters.instructions, counters.cache_misses,
+                                           counters.branch_misses};
+                json.value(values[i]);
+            }
+            json.endArray();
+        }
+        json.endObject();
+    }
+    json.endObject();
+}
+
+bool BenchmarkTimer::save_results_json(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) return false;
+    
+    quill::JsonWriter json(file);
+    write_results_json(json);
+    return file.good();
 }
\ No newline at end of file
@@ -0,0 +1,43 @@
+// Runs a Quill program in this process through CompilerSession::jit, the way
+// libquill hosts do, and prints what it printed. Used by the
+// *_jit_output_matches_O0 tests.
+//
+//   jit_run -O<level> <source_file>
+#include "compiler_session.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace quill;
+
+int main(int argc, char** argv) {
+    if (argc != 3 || std::string(argv[1]).size() != 3 || argv[1][0] != '-' || argv[1][1] != 'O' ||
+        argv[1][2] < '0' || argv[1][2] > '3') {
+        std::cerr << "usage: " << argv[0] << " -O<level> <source_file>" << std::endl;
+        return 2;
+    }
+    
+    std::ifstream file(argv[2]);
+    if (!file) {
+        std::cerr << "cannot read " << argv[2] << std::endl;
+        return 2;
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+    
+    try {
+        SessionOptions options;
+        options.opt_level = (QuillOptimizationManager::OptimizationLevel)(argv[1][2] - '0');
+        CompilerSession session(options);
+        auto program = reinterpret_cast<double (*)()>(session.jit(source.str()));
+        program();
+        // The program printed into this process's buffers
+        CompilerSession::flushOutput();
+    } catch (const std::exception& error) {
+        std::cerr << argv[2] << ": " << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
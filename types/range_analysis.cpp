@@ -0,0 +1,991 @@
+#include "../include/range_analysis.h"
+#include "../include/builtins.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+using namespace quill;
+
+namespace {
+
+// Doubles represent every integer below 2^53 exactly. Interval bounds are
+// rounded monotonically, so a bound strictly below the limit proves the
+// exact bound is too.
+const double EXACT_INTEGER_LIMIT = 9007199254740992.0; // 2^53
+const double INFINITY_VALUE = std::numeric_limits<double>::infinity();
+
+// No allocation reaches 2^53 elements, so len() is always an exact integer
+const double MAX_LIST_LENGTH = EXACT_INTEGER_LIMIT - 1.0;
+
+// 0 * inf shows up when a bound is exactly zero; the real product is zero.
+double boundProduct(double a, double b) {
+    double product = a * b;
+    return std::isnan(product) ? 0.0 : product;
+}
+
+ValueRange fromCandidates(const double* candidates, int count, bool integral) {
+    double lo = candidates[0];
+    double hi = candidates[0];
+    for (int i = 1; i < count; ++i) {
+        lo = std::min(lo, candidates[i]);
+        hi = std::max(hi, candidates[i]);
+    }
+    return ValueRange::interval(lo, hi, integral);
+}
+
+char negateComparison(char op) {
+    switch (op) {
+        case '<': return 'G';
+        case 'L': return '>';
+        case '>': return 'L';
+        case 'G': return '<';
+        case '=': return '!';
+        case '!': return '=';
+        default:  return 0;
+    }
+}
+
+char mirrorComparison(char op) {
+    switch (op) {
+        case '<': return '>';
+        case 'L': return 'G';
+        case '>': return '<';
+        case 'G': return 'L';
+        default:  return op;
+    }
+}
+
+bool isComparison(char op) {
+    return op == '<' || op == 'L' || op == '>' || op == 'G' || op == '=' || op == '!';
+}
+
+// range() truncates its bounds; trunc is monotonic, so bounds map directly
+ValueRange truncated(const ValueRange& range) {
+    return ValueRange::interval(std::trunc(range.lo), std::trunc(range.hi), true);
+}
+
+// Variables assigned anywhere in a statement, including nested loop variables
+void collectAssigned(const StmtAST* stmt, std::set<std::string>& names) {
+    if (auto assign = dynamic_cast<const AssignmentStmtAST*>(stmt)) {
+        names.insert(assign->name);
+    } else if (auto block = dynamic_cast<const BlockStmtAST*>(stmt)) {
+        for (const auto& child : block->statements) {
+            collectAssigned(child.get(), names);
+        }
+    } else if (auto if_stmt = dynamic_cast<const IfStmtAST*>(stmt)) {
+        collectAssigned(if_stmt->then_stmt.get(), names);
+        if (if_stmt->else_stmt) collectAssigned(if_stmt->else_stmt.get(), names);
+    } else if (auto while_stmt = dynamic_cast<const WhileStmtAST*>(stmt)) {
+        collectAssigned(while_stmt->body.get(), names);
+    } else if (auto for_stmt = dynamic_cast<const ForRangeStmtAST*>(stmt)) {
+        names.insert(for_stmt->var);
+        collectAssigned(for_stmt->body.get(), names);
+    }
+}
+
+// A per-node flag holds only if it held on every evaluation of the node
+template <typename Node>
+void recordForAll(std::unordered_map<const Node*, bool>& flags, const Node* node, bool value) {
+    auto it = flags.find(node);
+    if (it == flags.end()) {
+        flags[node] = value;
+    } else {
+        it->second = it->second && value;
+    }
+}
+
+void forgetFacts(std::set<std::pair<std::string, std::string>>& facts, const std::string& name) {
+    for (auto it = facts.begin(); it != facts.end();) {
+        if (it->first == name || it->second == name) {
+            it = facts.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+} // namespace
+
+// ValueRange Implementation
+ValueRange ValueRange::constant(double value) {
+    if (std::isnan(value)) return top();
+    bool whole = std::isfinite(value) && value == std::floor(value);
+    ValueRange range = interval(value, value, whole);
+    range.negative_zero = value == 0.0 && std::signbit(value);
+    return range;
+}
+
+ValueRange ValueRange::nativeInteger() {
+    ValueRange range = interval(-9223372036854775808.0, 9223372036854775807.0, true);
+    range.native_int = true;
+    return range;
+}
+
+ValueRange ValueRange::interval(double lo, double hi, bool integral) {
+    ValueRange range;
+    range.lo = lo;
+    range.hi = hi;
+    range.integral = integral;
+    range.negative_zero = false;
+    range.nan = false;
+    return range;
+}
+
+bool ValueRange::isBounded() const {
+    return std::isfinite(lo) && std::isfinite(hi);
+}
+
+bool ValueRange::equals(const ValueRange& other) const {
+    return lo == other.lo && hi == other.hi && integral == other.integral &&
+           native_int == other.native_int && negative_zero == other.negative_zero &&
+           nan == other.nan;
+}
+
+bool ValueRange::isExactInteger() const {
+    return integral && !negative_zero && !nan && !isEmpty() &&
+           lo > -EXACT_INTEGER_LIMIT && hi < EXACT_INTEGER_LIMIT;
+}
+
+bool ValueRange::fitsInt32() const {
+    return isExactInteger() && lo >= -2147483648.0 && hi <= 2147483647.0;
+}
+
+ValueRange ValueRange::join(const ValueRange& other) const {
+    if (isEmpty()) return other;
+    if (other.isEmpty()) return *this;
+    ValueRange joined = interval(std::min(lo, other.lo), std::max(hi, other.hi),
+                                 integral && other.integral);
+    joined.negative_zero = negative_zero || other.negative_zero;
+    joined.nan = nan || other.nan;
+    joined.native_int = (native_int || other.native_int) && joined.integral && !joined.nan;
+    return joined;
+}
+
+ValueRange ValueRange::widen(const ValueRange& next) const {
+    if (isEmpty()) return next;
+    if (next.isEmpty()) return *this;
+    ValueRange widened = interval(next.lo < lo ? -INFINITY_VALUE : lo,
+                                  next.hi > hi ? INFINITY_VALUE : hi,
+                                  integral && next.integral);
+    widened.negative_zero = negative_zero || next.negative_zero;
+    widened.nan = nan || next.nan;
+    widened.native_int = (native_int || next.native_int) && widened.integral && !widened.nan;
+    return widened;
+}
+
+ValueRange ValueRange::intersect(const ValueRange& other) const {
+    ValueRange narrowed = interval(std::max(lo, other.lo), std::min(hi, other.hi), integral);
+    narrowed.native_int = native_int;
+    narrowed.negative_zero = negative_zero && narrowed.contains(0.0);
+    narrowed.nan = nan && other.nan;
+    return narrowed;
+}
+
+std::string ValueRange::toString() const {
+    std::stringstream ss;
+    ss << (native_int ? "int64" : integral ? "int" : "float") << "[" << lo << ", " << hi << "]";
+    return ss.str();
+}
+
+// RangeArithmetic Implementation
+
+// Integer arithmetic stays in 64-bit integers once a declared int is
+// involved and the other operand is a whole number; integers have no
+// -0.0 and no NaN
+static bool nativeOperands(const ValueRange& a, const ValueRange& b) {
+    return (a.native_int || b.native_int) && a.integral && b.integral && !a.nan && !b.nan;
+}
+
+static ValueRange withNativeInt(ValueRange result, const ValueRange& a, const ValueRange& b) {
+    result.native_int = nativeOperands(a, b);
+    if (result.native_int) {
+        result.negative_zero = false;
+        result.nan = false;
+    }
+    return result;
+}
+
+ValueRange RangeArithmetic::add(const ValueRange& a, const ValueRange& b) {
+    // -0.0 + -0.0 is the only sum that is -0.0
+    ValueRange result = ValueRange::interval(a.lo + b.lo, a.hi + b.hi, a.integral && b.integral);
+    result.negative_zero = a.negative_zero && b.negative_zero;
+    // inf + -inf is NaN
+    result.nan = a.nan || b.nan || (a.hi == INFINITY_VALUE && b.lo == -INFINITY_VALUE) ||
+                 (a.lo == -INFINITY_VALUE && b.hi == INFINITY_VALUE);
+    return withNativeInt(result, a, b);
+}
+
+ValueRange RangeArithmetic::sub(const ValueRange& a, const ValueRange& b) {
+    // -0.0 - 0.0 is the only difference that is -0.0
+    ValueRange result = ValueRange::interval(a.lo - b.hi, a.hi - b.lo, a.integral && b.integral);
+    result.negative_zero = a.negative_zero && b.contains(0.0);
+    // inf - inf is NaN
+    result.nan = a.nan || b.nan || (a.hi == INFINITY_VALUE && b.hi == INFINITY_VALUE) ||
+                 (a.lo == -INFINITY_VALUE && b.lo == -INFINITY_VALUE);
+    return withNativeInt(result, a, b);
+}
+
+ValueRange RangeArithmetic::mul(const ValueRange& a, const ValueRange& b) {
+    double candidates[] = {
+        boundProduct(a.lo, b.lo), boundProduct(a.lo, b.hi),
+        boundProduct(a.hi, b.lo), boundProduct(a.hi, b.hi)
+    };
+    // A zero product is -0.0 when either factor is negative or -0.0
+    ValueRange result = fromCandidates(candidates, 4, a.integral && b.integral);
+    result.negative_zero = result.contains(0.0) &&
+                           (a.lo < 0.0 || b.lo < 0.0 || a.negative_zero || b.negative_zero);
+    // 0 * inf is NaN
+    result.nan = a.nan || b.nan || (a.contains(0.0) && !b.isBounded()) ||
+                 (b.contains(0.0) && !a.isBounded());
+    return withNativeInt(result, a, b);
+}
+
+ValueRange RangeArithmetic::div(const ValueRange& a, const ValueRange& b) {
+    // Quill division is true division: never integral, unbounded near zero
+    if (b.contains(0.0)) {
+        return ValueRange::top();
+    }
+    double candidates[] = {a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi};
+    for (double& candidate : candidates) {
+        if (std::isnan(candidate)) candidate = 0.0;
+    }
+    ValueRange result = fromCandidates(candidates, 4, false);
+    result.negative_zero = result.contains(0.0);
+    // inf / inf is NaN
+    result.nan = a.nan || b.nan || (!a.isBounded() && !b.isBounded());
+    return result;
+}
+
+ValueRange RangeArithmetic::rem(const ValueRange& a, const ValueRange& b) {
+    // fmod semantics: result takes the sign of the dividend and its
+    // magnitude is below both |a| and |b|. A zero divisor yields NaN.
+    if (a.isEmpty() || b.isEmpty()) {
+        return ValueRange::top();
+    }
+    if (b.contains(0.0)) {
+        // Declared ints stay integers (codegen raises on a zero divisor);
+        // doubles yield NaN
+        return nativeOperands(a, b) ? ValueRange::nativeInteger() : ValueRange::top();
+    }
+
+    bool integral = a.integral && b.integral;
+    double magnitude = std::max(std::fabs(b.lo), std::fabs(b.hi));
+    if (integral) {
+        magnitude -= 1.0;
+    }
+
+    double lo = a.lo >= 0.0 ? 0.0 : std::max(a.lo, -magnitude);
+    double hi = a.hi <= 0.0 ? 0.0 : std::min(a.hi, magnitude);
+    // A zero remainder of a negative dividend is -0.0
+    ValueRange result = ValueRange::interval(lo, hi, integral);
+    result.negative_zero = a.lo < 0.0 || a.negative_zero;
+    // fmod(inf, b) is NaN
+    result.nan = a.nan || b.nan || !a.isBounded();
+    return withNativeInt(result, a, b);
+}
+
+ValueRange RangeArithmetic::neg(const ValueRange& a) {
+    ValueRange result = ValueRange::interval(-a.hi, -a.lo, a.integral);
+    result.native_int = a.native_int;
+    result.negative_zero = !a.native_int && a.contains(0.0);
+    result.nan = a.nan;
+    return result;
+}
+
+// A NaN second argument never compares below the first, so min and max
+// keep the first argument whole and are NaN only when it is
+ValueRange RangeArithmetic::min(const ValueRange& a, const ValueRange& b) {
+    ValueRange result = ValueRange::interval(std::min(a.lo, b.lo), b.nan ? a.hi : std::min(a.hi, b.hi),
+                                             a.integral && b.integral);
+    result.negative_zero = a.negative_zero || b.negative_zero;
+    result.nan = a.nan;
+    return withNativeInt(result, a, b);
+}
+
+ValueRange RangeArithmetic::max(const ValueRange& a, const ValueRange& b) {
+    ValueRange result = ValueRange::interval(b.nan ? a.lo : std::max(a.lo, b.lo), std::max(a.hi, b.hi),
+                                             a.integral && b.integral);
+    result.negative_zero = a.negative_zero || b.negative_zero;
+    result.nan = a.nan;
+    return withNativeInt(result, a, b);
+}
+
+ValueRange RangeArithmetic::abs(const ValueRange& a) {
+    ValueRange result = ValueRange::interval(a.lo >= 0.0 ? a.lo : a.hi <= 0.0 ? -a.hi : 0.0,
+                                             std::max(-a.lo, a.hi), a.integral);
+    result.native_int = a.native_int;
+    result.nan = a.nan;
+    return result;
+}
+
+ValueRange RangeArithmetic::floor(const ValueRange& a) {
+    // floor(-0.0) is -0.0; every other input rounds away from it
+    ValueRange result = ValueRange::interval(std::floor(a.lo), std::floor(a.hi), true);
+    result.negative_zero = a.negative_zero;
+    result.nan = a.nan;
+    return result;
+}
+
+ValueRange RangeArithmetic::increasing(const ValueRange& a, double (*fn)(double), double domain_lo) {
+    // Outside the domain the result is NaN, which no interval covers
+    if (!(a.lo >= domain_lo)) {
+        return ValueRange::top();
+    }
+    // sqrt(-0.0) is -0.0
+    ValueRange result = ValueRange::interval(fn(a.lo), fn(a.hi), false);
+    result.negative_zero = a.negative_zero;
+    result.nan = a.nan;
+    return result;
+}
+
+ValueRange RangeArithmetic::boolean() {
+    return ValueRange::interval(0.0, 1.0, true);
+}
+
+// RangeAnalysis::State Implementation
+bool RangeAnalysis::ListInfo::equals(const ListInfo& other) const {
+    return min_length == other.min_length && integer_elements == other.integer_elements;
+}
+
+ValueRange RangeAnalysis::State::lookup(const std::string& name) const {
+    auto it = vars.find(name);
+    return (it != vars.end()) ? it->second : ValueRange::top();
+}
+
+double RangeAnalysis::State::minLength(const std::string& list) const {
+    auto it = lists.find(list);
+    return (it != lists.end()) ? it->second.min_length : 0.0;
+}
+
+bool RangeAnalysis::State::provesBelowLength(const std::string& index, const std::string& list) const {
+    ValueRange range = lookup(index);
+    return below_length.count({index, list}) || (!range.nan && range.hi < minLength(list));
+}
+
+bool RangeAnalysis::State::provesLengthBound(const std::string& bound, const std::string& list) const {
+    ValueRange range = lookup(bound);
+    return length_bounds.count({bound, list}) || (!range.nan && range.hi <= minLength(list));
+}
+
+void RangeAnalysis::State::forget(const std::string& name) {
+    lists.erase(name);
+    forgetFacts(below_length, name);
+    forgetFacts(length_bounds, name);
+}
+
+void RangeAnalysis::State::join(const State& other) {
+    if (!other.reachable) return;
+    if (!reachable) {
+        *this = other;
+        return;
+    }
+
+    // A fact survives when each side either tracks it or implies it by ranges
+    ListFacts below;
+    ListFacts bounds;
+    for (const ListFacts& facts : {below_length, other.below_length}) {
+        for (const auto& fact : facts) {
+            if (provesBelowLength(fact.first, fact.second) &&
+                other.provesBelowLength(fact.first, fact.second)) {
+                below.insert(fact);
+            }
+        }
+    }
+    for (const ListFacts& facts : {length_bounds, other.length_bounds}) {
+        for (const auto& fact : facts) {
+            if (provesLengthBound(fact.first, fact.second) &&
+                other.provesLengthBound(fact.first, fact.second)) {
+                bounds.insert(fact);
+            }
+        }
+    }
+    below_length = std::move(below);
+    length_bounds = std::move(bounds);
+
+    // Lists assigned on only one path are forgotten
+    for (auto it = lists.begin(); it != lists.end();) {
+        auto other_it = other.lists.find(it->first);
+        if (other_it == other.lists.end()) {
+            it = lists.erase(it);
+            continue;
+        }
+        it->second.min_length = std::min(it->second.min_length, other_it->second.min_length);
+        it->second.integer_elements = it->second.integer_elements && other_it->second.integer_elements;
+        ++it;
+    }
+
+    for (const auto& pair : other.vars) {
+        auto it = vars.find(pair.first);
+        if (it == vars.end()) {
+            vars[pair.first] = pair.second;
+        } else {
+            it->second = it->second.join(pair.second);
+        }
+    }
+}
+
+bool RangeAnalysis::State::equals(const State& other) const {
+    if (reachable != other.reachable) return false;
+    if (vars.size() != other.vars.size()) return false;
+    if (below_length != other.below_length || length_bounds != other.length_bounds) return false;
+    if (lists.size() != other.lists.size()) return false;
+
+    for (const auto& pair : lists) {
+        auto it = other.lists.find(pair.first);
+        if (it == other.lists.end() || !it->second.equals(pair.second)) {
+            return false;
+        }
+    }
+
+    for (const auto& pair : vars) {
+        auto it = other.vars.find(pair.first);
+        if (it == other.vars.end() || !it->second.equals(pair.second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// RangeAnalysis Implementation
+void RangeAnalysis::clear() {
+    expression_ranges.clear();
+    safe_indexes.clear();
+    integer_literals.clear();
+    float_lists.clear();
+    variable_ranges.clear();
+    integer_functions.clear();
+    user_functions.clear();
+    list_functions.clear();
+    current_variables = nullptr;
+}
+
+void RangeAnalysis::declareFunction(const FunctionAST* function) {
+    if (!function) return;
+
+    user_functions.insert(function->name);
+    if (function->return_type == "int") {
+        integer_functions.insert(function->name);
+    }
+    if (isListAnnotation(function->return_type)) {
+        ListInfo info;
+        info.integer_elements = isIntegerListAnnotation(function->return_type);
+        list_functions[function->name] = info;
+    }
+}
+
+bool RangeAnalysis::isListAnnotation(const std::string& annotation) {
+    return annotation == "list" || annotation.compare(0, 5, "list[") == 0;
+}
+
+bool RangeAnalysis::isIntegerListAnnotation(const std::string& annotation) {
+    return annotation == "list[int]";
+}
+
+void RangeAnalysis::analyzeFunction(const FunctionAST* function) {
+    if (!function || !function->body) return;
+
+    current_variables = &variable_ranges[function->name];
+
+    // Parameters arrive from unknown callers: doubles unless declared int
+    State state;
+    for (size_t i = 0; i < function->args.size(); ++i) {
+        ValueRange param = function->getArgAnnotation(i) == "int" ? ValueRange::nativeInteger()
+                                                                  : ValueRange::top();
+        state.vars[function->args[i]] = param;
+        recordVariable(function->args[i], param);
+
+        if (isListAnnotation(function->getArgAnnotation(i))) {
+            ListInfo info;
+            info.integer_elements = isIntegerListAnnotation(function->getArgAnnotation(i));
+            state.lists[function->args[i]] = info;
+        }
+    }
+
+    analyzeStatement(function->body.get(), state);
+    current_variables = nullptr;
+}
+
+const ValueRange* RangeAnalysis::getExpressionRange(const ExprAST* expr) const {
+    auto it = expression_ranges.find(expr);
+    return (it != expression_ranges.end()) ? &it->second : nullptr;
+}
+
+bool RangeAnalysis::isIndexSafe(const IndexExprAST* expr) const {
+    auto it = safe_indexes.find(expr);
+    return it != safe_indexes.end() && it->second;
+}
+
+void RangeAnalysis::markFloatList(const ListExprAST* expr) {
+    float_lists.insert(expr);
+}
+
+bool RangeAnalysis::hasIntegerElements(const ListExprAST* expr) const {
+    auto it = integer_literals.find(expr);
+    return it != integer_literals.end() && it->second;
+}
+
+const ValueRange* RangeAnalysis::getVariableRange(const std::string& function_name,
+                                                  const std::string& variable) const {
+    auto func_it = variable_ranges.find(function_name);
+    if (func_it == variable_ranges.end()) return nullptr;
+
+    auto var_it = func_it->second.find(variable);
+    return (var_it != func_it->second.end()) ? &var_it->second : nullptr;
+}
+
+void RangeAnalysis::analyzeStatement(const StmtAST* stmt, State& state) {
+    if (!stmt || !state.reachable) return;
+
+    if (auto assign = dynamic_cast<const AssignmentStmtAST*>(stmt)) {
+        ValueRange value = evaluate(assign->value.get(), state);
+        ListInfo info;
+        bool is_list = listInfo(assign->value.get(), state, info);
+        const VariableExprAST* measured = lengthOperand(assign->value.get());
+
+        state.forget(assign->name);
+        state.vars[assign->name] = value;
+        recordVariable(assign->name, value);
+
+        if (is_list) {
+            state.lists[assign->name] = info;
+        }
+        // n = len(xs): lists never shrink, so n stays a lower bound
+        if (measured && measured->name != assign->name) {
+            state.length_bounds.insert({assign->name, measured->name});
+        }
+    } else if (auto store = dynamic_cast<const IndexAssignmentStmtAST*>(stmt)) {
+        evaluate(store->value.get(), state);
+        evaluate(store->target.get(), state);
+    } else if (auto block = dynamic_cast<const BlockStmtAST*>(stmt)) {
+        for (const auto& statement : block->statements) {
+            analyzeStatement(statement.get(), state);
+        }
+    } else if (auto if_stmt = dynamic_cast<const IfStmtAST*>(stmt)) {
+        analyzeIf(if_stmt, state);
+    } else if (auto while_stmt = dynamic_cast<const WhileStmtAST*>(stmt)) {
+        analyzeWhile(while_stmt, state);
+    } else if (auto for_stmt = dynamic_cast<const ForRangeStmtAST*>(stmt)) {
+        analyzeFor(for_stmt, state);
+    } else if (auto ret = dynamic_cast<const ReturnStmtAST*>(stmt)) {
+        if (ret->value) {
+            evaluate(ret->value.get(), state);
+        }
+        state.reachable = false;
+    } else if (auto print_stmt = dynamic_cast<const PrintStmtAST*>(stmt)) {
+        evaluate(print_stmt->expression.get(), state);
+    } else if (auto expr_stmt = dynamic_cast<const ExprStmtAST*>(stmt)) {
+        evaluate(expr_stmt->expression.get(), state);
+
+        // append(xs, v) grows xs by one element
+        auto call = dynamic_cast<const CallExprAST*>(expr_stmt->expression.get());
+        if (call && call->callee == "append" && !user_functions.count(call->callee) &&
+            call->args.size() == 2) {
+            auto list = dynamic_cast<const VariableExprAST*>(call->args[0].get());
+            auto it = list ? state.lists.find(list->name) : state.lists.end();
+            if (it != state.lists.end()) {
+                it->second.min_length += 1.0;
+            }
+        }
+    }
+}
+
+void RangeAnalysis::analyzeIf(const IfStmtAST* stmt, State& state) {
+    evaluate(stmt->condition.get(), state);
+
+    State then_state = state;
+    refine(stmt->condition.get(), true, then_state);
+    analyzeStatement(stmt->then_stmt.get(), then_state);
+
+    State else_state = state;
+    refine(stmt->condition.get(), false, else_state);
+    if (stmt->else_stmt) {
+        analyzeStatement(stmt->else_stmt.get(), else_state);
+    }
+
+    then_state.join(else_state);
+    state = then_state;
+}
+
+void RangeAnalysis::analyzeWhile(const WhileStmtAST* stmt, State& state) {
+    // Codegen tests the condition before the first iteration and again
+    // after each one, so the body only ever sees refined states.
+    State entry = state;
+    evaluate(stmt->condition.get(), entry);
+    State head = entry;
+    State out;
+
+    for (int iteration = 0; ; ++iteration) {
+        State body_in = head;
+        refine(stmt->condition.get(), true, body_in);
+
+        out = body_in;
+        analyzeStatement(stmt->body.get(), out);
+        if (out.reachable) {
+            evaluate(stmt->condition.get(), out);
+        }
+
+        State next = entry;
+        next.join(out);
+        widenLoopState(iteration, head, next);
+
+        if (next.equals(head)) break;
+        head = next;
+    }
+
+    // The guard and the back-edge test both leave through here
+    State exit = entry;
+    exit.join(out);
+    refine(stmt->condition.get(), false, exit);
+    state = exit;
+}
+
+void RangeAnalysis::analyzeFor(const ForRangeStmtAST* stmt, State& state) {
+    // Bounds are evaluated once, before the loop
+    ValueRange start = stmt->start ? evaluate(stmt->start.get(), state) : ValueRange::constant(0.0);
+    ValueRange stop = evaluate(stmt->stop.get(), state);
+    start = truncated(start);
+    stop = truncated(stop);
+
+    ValueRange induction = stmt->step > 0 ? ValueRange::interval(start.lo, stop.hi - 1.0, true)
+                                          : ValueRange::interval(stop.lo + 1.0, start.hi, true);
+    induction.native_int = true;
+    if (induction.isEmpty()) return;
+
+    // The stop value is a hidden variable; while it stays a lower bound on
+    // some list's length, every induction value indexes that list safely
+    const std::string stop_name = "range.stop." + stmt->var;
+    State entry = state;
+    entry.forget(stop_name);
+    
+    // Each worker of a parallel loop accumulates a partial reduction over
+    // an arbitrary subset of iterations, so enclosing variables the body
+    // updates keep only their kind, not their sequential bounds
+    if (stmt->parallel) {
+        std::set<std::string> assigned;
+        collectAssigned(stmt->body.get(), assigned);
+        for (const std::string& name : assigned) {
+            auto it = entry.vars.find(name);
+            if (it == entry.vars.end() || name == stmt->var) continue;
+            ValueRange partial = ValueRange::top();
+            partial.integral = it->second.integral;
+            partial.native_int = it->second.native_int;
+            entry.forget(name);
+            entry.vars[name] = partial;
+            recordVariable(name, partial);
+        }
+    }
+    
+    if (stmt->step > 0) {
+        if (const VariableExprAST* list = lengthOperand(stmt->stop.get())) {
+            entry.length_bounds.insert({stop_name, list->name});
+        } else if (auto bound = dynamic_cast<const VariableExprAST*>(stmt->stop.get())) {
+            for (const auto& fact : state.length_bounds) {
+                if (fact.first == bound->name) {
+                    entry.length_bounds.insert({stop_name, fact.second});
+                }
+            }
+        }
+    }
+
+    State head = entry;
+    State out;
+
+    for (int iteration = 0; ; ++iteration) {
+        State body_in = head;
+        body_in.forget(stmt->var);
+        body_in.vars[stmt->var] = induction;
+        recordVariable(stmt->var, induction);
+        for (const auto& fact : head.length_bounds) {
+            if (fact.first == stop_name) {
+                body_in.below_length.insert({stmt->var, fact.second});
+            }
+        }
+
+        out = body_in;
+        analyzeStatement(stmt->body.get(), out);
+
+        State next = entry;
+        next.join(out);
+        widenLoopState(iteration, head, next);
+
+        if (next.equals(head)) break;
+        head = next;
+    }
+
+    State exit = entry;
+    exit.join(out);
+    exit.forget(stop_name);
+    state = exit;
+}
+
+void RangeAnalysis::widenLoopState(int iteration, const State& head, State& next) const {
+    if (iteration >= MAX_LOOP_ITERATIONS) {
+        // Give up on precision for anything the loop still changes
+        for (auto& pair : next.vars) {
+            if (!pair.second.equals(head.lookup(pair.first))) {
+                pair.second = ValueRange::top();
+            }
+        }
+        next.below_length.clear();
+        next.length_bounds.clear();
+    } else if (iteration >= WIDENING_DELAY) {
+        for (auto& pair : next.vars) {
+            auto it = head.vars.find(pair.first);
+            if (it != head.vars.end()) {
+                pair.second = it->second.widen(pair.second);
+            }
+        }
+    }
+}
+
+ValueRange RangeAnalysis::evaluate(const ExprAST* expr, const State& state) {
+    if (!expr) return ValueRange::top();
+
+    ValueRange result = ValueRange::top();
+
+    if (auto num = dynamic_cast<const NumberExprAST*>(expr)) {
+        result = ValueRange::constant(num->value);
+    } else if (auto var = dynamic_cast<const VariableExprAST*>(expr)) {
+        result = state.lookup(var->name);
+    } else if (auto bin = dynamic_cast<const BinaryExprAST*>(expr)) {
+        ValueRange lhs = evaluate(bin->lhs.get(), state);
+        ValueRange rhs = evaluate(bin->rhs.get(), state);
+
+        switch (bin->op) {
+            case '+': result = RangeArithmetic::add(lhs, rhs); break;
+            case '-': result = RangeArithmetic::sub(lhs, rhs); break;
+            case '*': result = RangeArithmetic::mul(lhs, rhs); break;
+            case '/': result = RangeArithmetic::div(lhs, rhs); break;
+            case '%': result = RangeArithmetic::rem(lhs, rhs); break;
+            case '&':
+            case '|':
+                result = RangeArithmetic::boolean();
+                break;
+            default:
+                if (isComparison(bin->op)) {
+                    result = RangeArithmetic::boolean();
+                }
+                break;
+        }
+    } else if (auto unary = dynamic_cast<const UnaryExprAST*>(expr)) {
+        ValueRange operand = evaluate(unary->operand.get(), state);
+        if (unary->op == '-') {
+            result = RangeArithmetic::neg(operand);
+        } else if (unary->op == '!') {
+            result = RangeArithmetic::boolean();
+        }
+    } else if (auto call = dynamic_cast<const CallExprAST*>(expr)) {
+        std::vector<ValueRange> args;
+        for (const auto& arg : call->args) {
+            args.push_back(evaluate(arg.get(), state));
+        }
+        const MathBuiltin* builtin = user_functions.count(call->callee) ? nullptr : findMathBuiltin(call->callee);
+        if (builtin && args.size() == builtin->arity) {
+            const std::string& name = call->callee;
+            if (name == "min") {
+                result = RangeArithmetic::min(args[0], args[1]);
+            } else if (name == "max") {
+                result = RangeArithmetic::max(args[0], args[1]);
+            } else if (name == "abs") {
+                result = RangeArithmetic::abs(args[0]);
+            } else if (name == "floor") {
+                result = RangeArithmetic::floor(args[0]);
+            } else if (name == "sqrt") {
+                result = RangeArithmetic::increasing(args[0], std::sqrt, 0.0);
+            } else if (name == "log") {
+                result = RangeArithmetic::increasing(args[0], std::log, 0.0);
+            } else if (name == "exp") {
+                result = RangeArithmetic::increasing(args[0], std::exp, -std::numeric_limits<double>::infinity());
+            }
+        } else if (integer_functions.count(call->callee)) {
+            result = ValueRange::nativeInteger();
+        } else if (call->callee == "len" && !user_functions.count(call->callee)) {
+            ListInfo info;
+            if (call->args.size() == 1) {
+                listInfo(call->args[0].get(), state, info);
+            }
+            result = ValueRange::interval(info.min_length, MAX_LIST_LENGTH, true);
+            result.native_int = true;
+        }
+    } else if (auto list = dynamic_cast<const ListExprAST*>(expr)) {
+        // Whole-number elements are stored unboxed as list[int] unless the
+        // literal is typed list[float], as [1.0, 2.0] is
+        bool integer_elements = !list->elements.empty() && !float_lists.count(list);
+        for (const auto& element : list->elements) {
+            ValueRange range = evaluate(element.get(), state);
+            integer_elements = integer_elements && (range.native_int || range.isExactInteger());
+        }
+        if (recording) {
+            recordForAll(integer_literals, list, integer_elements);
+        }
+    } else if (auto index = dynamic_cast<const IndexExprAST*>(expr)) {
+        result = evaluateIndex(index, state);
+    }
+
+    recordExpression(expr, result);
+    return result;
+}
+
+ValueRange RangeAnalysis::evaluateIndex(const IndexExprAST* expr, const State& state) {
+    evaluate(expr->list.get(), state);
+    ValueRange index = evaluate(expr->index.get(), state);
+
+    ListInfo info;
+    bool is_list = listInfo(expr->list.get(), state, info);
+
+    // Safe when the index is non-negative and provably below the length;
+    // a NaN index has no integer form, so it is never proven safe
+    bool safe = false;
+    if (is_list && !index.nan && index.lo >= 0.0) {
+        auto list_var = dynamic_cast<const VariableExprAST*>(expr->list.get());
+        auto index_var = dynamic_cast<const VariableExprAST*>(expr->index.get());
+        safe = index.hi < info.min_length ||
+               (list_var && index_var && state.provesBelowLength(index_var->name, list_var->name));
+    }
+    if (recording) {
+        recordForAll(safe_indexes, expr, safe);
+    }
+
+    return (is_list && info.integer_elements) ? ValueRange::nativeInteger() : ValueRange::top();
+}
+
+bool RangeAnalysis::listInfo(const ExprAST* expr, const State& state, ListInfo& info) const {
+    if (auto list = dynamic_cast<const ListExprAST*>(expr)) {
+        auto it = integer_literals.find(list);
+        info.min_length = static_cast<double>(list->elements.size());
+        info.integer_elements = it != integer_literals.end() && it->second;
+        return true;
+    }
+    if (auto var = dynamic_cast<const VariableExprAST*>(expr)) {
+        auto it = state.lists.find(var->name);
+        if (it == state.lists.end()) return false;
+        info = it->second;
+        return true;
+    }
+    if (auto call = dynamic_cast<const CallExprAST*>(expr)) {
+        auto it = list_functions.find(call->callee);
+        if (it == list_functions.end()) return false;
+        info = it->second;
+        return true;
+    }
+    return false;
+}
+
+const VariableExprAST* RangeAnalysis::lengthOperand(const ExprAST* expr) const {
+    auto call = dynamic_cast<const CallExprAST*>(expr);
+    if (!call || call->callee != "len" || user_functions.count(call->callee) || call->args.size() != 1) {
+        return nullptr;
+    }
+    return dynamic_cast<const VariableExprAST*>(call->args[0].get());
+}
+
+void RangeAnalysis::refine(const ExprAST* cond, bool taken, State& state) {
+    if (!cond || !state.reachable) return;
+
+    if (auto unary = dynamic_cast<const UnaryExprAST*>(cond)) {
+        if (unary->op == '!') {
+            refine(unary->operand.get(), !taken, state);
+        }
+        return;
+    }
+
+    auto bin = dynamic_cast<const BinaryExprAST*>(cond);
+    if (!bin) return;
+
+    if (bin->op == '&') {
+        // Both sides hold when the conjunction is taken
+        if (taken) {
+            refine(bin->lhs.get(), true, state);
+            refine(bin->rhs.get(), true, state);
+        }
+        return;
+    }
+
+    if (bin->op == '|') {
+        // Neither side holds when the disjunction falls through
+        if (!taken) {
+            refine(bin->lhs.get(), false, state);
+            refine(bin->rhs.get(), false, state);
+        }
+        return;
+    }
+
+    if (!isComparison(bin->op)) return;
+
+    char op = taken ? bin->op : negateComparison(bin->op);
+    refineComparison(op, taken, bin->lhs.get(), bin->rhs.get(), state);
+    refineComparison(mirrorComparison(op), taken, bin->rhs.get(), bin->lhs.get(), state);
+}
+
+void RangeAnalysis::refineComparison(char op, bool taken, const ExprAST* lhs, const ExprAST* rhs,
+                                     State& state) {
+    auto var = dynamic_cast<const VariableExprAST*>(lhs);
+    if (!var) return;
+
+    // Evaluate without recording: this is the edge, not a program point
+    recording = false;
+    ValueRange bound = evaluate(rhs, state);
+    recording = true;
+
+    // Every value of var passes a comparison against NaN
+    if (taken && bound.nan) return;
+
+    ValueRange current = state.lookup(var->name);
+    // A NaN var still reaches the true edge; only its other values narrow
+    bool keeps_nan = taken && current.nan;
+
+    // i < len(xs), directly or through n = len(xs)
+    if (op == '<' && !keeps_nan) {
+        if (const VariableExprAST* list = lengthOperand(rhs)) {
+            state.below_length.insert({var->name, list->name});
+        } else if (auto bound_var = dynamic_cast<const VariableExprAST*>(rhs)) {
+            for (const auto& fact : state.length_bounds) {
+                if (fact.first == bound_var->name) {
+                    state.below_length.insert({var->name, fact.second});
+                }
+            }
+        }
+    }
+
+    double strict = (current.integral && bound.integral) ? 1.0 : 0.0;
+
+    ValueRange narrowed = current;
+    switch (op) {
+        case '<': narrowed.hi = std::min(current.hi, bound.hi - strict); break;
+        case 'L': narrowed.hi = std::min(current.hi, bound.hi); break;
+        case '>': narrowed.lo = std::max(current.lo, bound.lo + strict); break;
+        case 'G': narrowed.lo = std::max(current.lo, bound.lo); break;
+        case '=': narrowed = current.intersect(bound); break;
+        default:  return;
+    }
+
+    narrowed.nan = keeps_nan;
+
+    if (narrowed.isEmpty()) {
+        if (!keeps_nan) state.reachable = false;
+        return;
+    }
+    state.vars[var->name] = narrowed;
+}
+
+void RangeAnalysis::recordExpression(const ExprAST* expr, const ValueRange& range) {
+    if (!recording) return;
+
+    auto it = expression_ranges.find(expr);
+    if (it == expression_ranges.end()) {
+        expression_ranges[expr] = range;
+    } else {
+        it->second = it->second.join(range);
+    }
+}
+
+void RangeAnalysis::recordVariable(const std::string& name, const ValueRange& range) {
+    if (!current_variables) return;
+
+    auto it = current_variables->find(name);
+    if (it == current_variables->end()) {
+        (*current_variables)[name] = range;
+    } else {
+        it->second = it->second.join(range);
+    }
+}
@@ -1,7 +1,9 @@
 #include "../include/type_checker.h"
 #include "../include/ast.h"
+#include <llvm/Support/TimeProfiler.h>
 #include <sstream>
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 
 using namespace quill;
@@ -72,6 +74,60 @@ void TypeChecker::initializeBuiltins() {
     auto print_type = TypeFactory::createFunction(std::move(print_params), 
                                                  TypeFactory::createVoid());
     defineFunction("print", std::move(print_type));
+    
+    // len function: (list) -> int
+    std::vector<std::unique_ptr<Type>> len_params;
+    len_params.push_back(TypeFactory::createList(TypeFactory::createUnknown()));
+    defineFunction("len", TypeFactory::createFunction(std::move(len_params),
+                                                      TypeFactory::createInt()));
+    
+    // append function: (list, element) -> void
+    std::vector<std::unique_ptr<Type>> append_params;
+    append_params.push_back(TypeFactory::createList(TypeFactory::createUnknown()));
+    append_params.push_back(TypeFactory::createUnknown());
+    defineFunction("append", TypeFactory::createFunction(std::move(append_params),
+                                                         TypeFactory::createVoid()));
+    
+    // Math builtins: floats in, float out; abs, min and max keep ints ints
+    for (const MathBuiltin& builtin : MATH_BUILTINS) {
+        std::vector<std::unique_ptr<Type>> params;
+        for (unsigned i = 0; i < builtin.arity; ++i) {
+            params.push_back(TypeFactory::createFloat());
+        }
+        defineFunction(builtin.name, TypeFactory::createFunction(std::move(params), TypeFactory::createFloat()));
+        if (builtin.preserves_int) {
+            integer_preserving_builtins.insert(type_env.lookup(builtin.name));
+        }
+    }
+}
+
+std::unique_ptr<Type> TypeChecker::resolveAnnotation(const std::string& annotation,
+                                                     std::unique_ptr<Type> fallback,
+                                                     bool report_errors) {
+    if (annotation.empty()) {
+        return fallback;
+    }
+    
+    auto type = TypeAnnotationParser::parseTypeAnnotation(annotation);
+    if (type->isError()) {
+        if (report_errors) {
+            reportError(static_cast<ErrorType*>(type.get())->error_message);
+        }
+        return fallback;
+    }
+    return type;
+}
+
+void TypeChecker::checkDeclaredType(const Type* declared, const Type* actual, const std::string& context,
+                                    TypeCheckResult& result) {
+    if (!declared || !actual || declared->isUnknown() || isAssignable(declared, actual)) {
+        return;
+    }
+    std::string error = TypeErrorReporter::formatTypeError(context, declared, actual);
+    if (!actual->isUnknown()) {
+        annotation_errors.push_back(error);
+    }
+    result.addError(error);
 }
 
 TypeCheckResult TypeChecker::checkProgram(ProgramAST* program) {
@@ -82,23 +138,28 @@ TypeCheckResult TypeChecker::checkProgram(ProgramAST* program) {
     }
     
     clearMessages();
+    range_analysis.clear();
     beginInference();
     
     // First pass: collect all function signatures
     for (const auto& func : program->functions) {
         std::vector<std::unique_ptr<Type>> param_types;
-        for (const auto& param : func->args) {
-            // Assume unknown types - will be inferred
-            param_types.push_back(TypeFactory::createUnknown());
+        for (size_t i = 0; i < func->args.size(); ++i) {
+            // Annotated parameters are exact; the rest will be inferred
+            param_types.push_back(resolveAnnotation(func->getArgAnnotation(i),
+                                                    TypeFactory::createUnknown(), false));
         }
         
-        auto func_type = TypeFactory::createFunction(std::move(param_types),
-                                                   TypeFactory::createUnknown());
+        auto return_type = resolveAnnotation(func->return_type, TypeFactory::createUnknown(), false);
+        auto func_type = TypeFactory::createFunction(std::move(param_types), std::move(return_type));
+        integer_preserving_builtins.erase(type_env.lookup(func->name));  // shadowed by the user's definition
         defineFunction(func->name, std::move(func_type));
+        range_analysis.declareFunction(func.get());
     }
     
     // Second pass: type check each function
     for (const auto& func : program->functions) {
+        llvm::TimeTraceScope scope("TypeCheckFunction", func->name);
         auto result = checkFunction(func.get());
         if (result.hasErrors()) {
             for (const auto& error : result.errors) {
@@ -124,20 +185,27 @@ TypeCheckResult TypeChecker::checkFunction(FunctionAST* function) {
     }
     
     pushScope();
+    current_function = function;
     
     // Define parameters in function scope
-    for (const auto& param_name : function->args) {
-        // Since current AST doesn't have type annotations, default to double
-        // (Quill is primarily a numerical language)
-        auto param_type = TypeFactory::createFloat();
-        defineVariable(param_name, std::move(param_type));
+    for (size_t i = 0; i < function->args.size(); ++i) {
+        // Unannotated parameters default to double (Quill is primarily a
+        // numerical language)
+        auto param_type = resolveAnnotation(function->getArgAnnotation(i),
+                                            TypeFactory::createFloat(), true);
+        defineVariable(function->args[i], std::move(param_type));
     }
     
     // Check function body
     auto body_result = checkStatement(function->body.get());
     
+    current_function = nullptr;
     popScope();
     
+    // Compute integer value ranges for narrowing in codegen
+    range_analysis.analyzeFunction(function);
+    
+    // checkReturn compared each returned value with the declared type
     TypeCheckResult result;
     if (body_result.hasErrors()) {
         result.errors = body_result.errors;
@@ -169,10 +237,14 @@ TypeCheckResult TypeChecker::checkStatement(StmtAST* stmt) {
         return checkIf(if_stmt);
     } else if (auto while_stmt = dynamic_cast<WhileStmtAST*>(stmt)) {
         return checkWhile(while_stmt);
+    } else if (auto for_stmt = dynamic_cast<ForRangeStmtAST*>(stmt)) {
+        return checkFor(for_stmt);
     } else if (auto print_stmt = dynamic_cast<PrintStmtAST*>(stmt)) {
         return checkPrint(print_stmt);
     } else if (auto block = dynamic_cast<BlockStmtAST*>(stmt)) {
         return checkBlock(block);
+    } else if (auto index_assign = dynamic_cast<IndexAssignmentStmtAST*>(stmt)) {
+        return checkIndexAssignment(index_assign);
     } else if (auto expr_stmt = dynamic_cast<ExprStmtAST*>(stmt)) {
         return checkExpression(expr_stmt->expression.get());
     }
@@ -218,6 +290,34 @@ TypeCheckResult TypeChecker::checkAssignment(const AssignmentStmtAST* stmt) {
     return TypeCheckResult(TypeFactory::createVoid());
 }
 
+TypeCheckResult TypeChecker::checkIndexAssignment(const IndexAssignmentStmtAST* stmt) {
+    if (!stmt) {
+        TypeCheckResult result;
+        result.addError("Null index assignment statement");
+        return result;
+    }
+    
+    auto target_result = inferIndexType(stmt->target.get());
+    if (target_result.hasErrors()) {
+        return target_result;
+    }
+    
+    auto value_result = inferExpressionType(stmt->value.get());
+    if (value_result.hasErrors()) {
+        return value_result;
+    }
+    
+    // Elements are unboxed, so the value must fit the element type
+    if (!isAssignable(target_result.type.get(), value_result.type.get())) {
+        TypeCheckResult result;
+        result.addError(TypeErrorReporter::formatTypeError(
+            "list element assignment", target_result.type.get(), value_result.type.get()));
+        return result;
+    }
+    
+    return TypeCheckResult(TypeFactory::createVoid());
+}
+
 TypeCheckResult TypeChecker::checkReturn(const ReturnStmtAST* stmt) {
     if (!stmt) {
         TypeCheckResult result;
@@ -225,11 +325,17 @@ TypeCheckResult TypeChecker::checkReturn(const ReturnStmtAST* stmt) {
         return result;
     }
     
-    if (stmt->value) {
-        return inferExpressionType(stmt->value.get());
-    } else {
+    if (!stmt->value) {
         return TypeCheckResult(TypeFactory::createVoid());
     }
+    
+    auto result = inferExpressionType(stmt->value.get());
+    if (!result.hasErrors() && current_function && current_function->hasReturnAnnotation()) {
+        auto declared = resolveAnnotation(current_function->return_type, TypeFactory::createUnknown(), false);
+        checkDeclaredType(declared.get(), result.type.get(),
+                          "return value of function '" + current_function->name + "'", result);
+    }
+    return result;
 }
 
 TypeCheckResult TypeChecker::checkIf(const IfStmtAST* stmt) {
@@ -320,6 +426,52 @@ TypeCheckResult TypeChecker::checkWhile(const WhileStmtAST* stmt) {
     return result;
 }
 
+TypeCheckResult TypeChecker::checkFor(const ForRangeStmtAST* stmt) {
+    if (!stmt) {
+        TypeCheckResult result;
+        result.addError("Null for statement");
+        return result;
+    }
+    
+    // range() bounds must be numeric; they are truncated to integers
+    for (ExprAST* bound : {stmt->start.get(), stmt->stop.get()}) {
+        if (!bound) continue;
+        
+        auto bound_result = inferExpressionType(bound);
+        if (bound_result.hasErrors()) {
+            return bound_result;
+        }
+        if (!bound_result.type->isNumeric()) {
+            TypeCheckResult result;
+            result.addError("range() bounds must be numeric, got: " + bound_result.type->toString());
+            return result;
+        }
+    }
+    
+    // The loop variable is an int, like any other variable it outlives the loop
+    Type* existing_type = lookupVariable(stmt->var);
+    if (existing_type && !existing_type->isNumeric()) {
+        TypeCheckResult result;
+        result.addError("Loop variable '" + stmt->var + "' is not numeric: " + existing_type->toString());
+        return result;
+    }
+    if (!existing_type) {
+        defineVariable(stmt->var, TypeFactory::createInt());
+        current_context->setVariableType(stmt->var, TypeFactory::createInt());
+    }
+    current_context->markVariableModified(stmt->var);
+    
+    auto body_result = checkStatement(stmt->body.get());
+    
+    TypeCheckResult result;
+    if (body_result.hasErrors()) {
+        result.errors = body_result.errors;
+    }
+    
+    result.type = TypeFactory::createVoid();
+    return result;
+}
+
 TypeCheckResult TypeChecker::checkPrint(const PrintStmtAST* stmt) {
     if (!stmt) {
         TypeCheckResult result;
@@ -384,6 +536,10 @@ TypeCheckResult TypeChecker::inferExpressionType(ExprAST* expr) {
         return inferUnaryType(unary);
     } else if (auto call = dynamic_cast<CallExprAST*>(expr)) {
         return inferCallType(call);
+    } else if (auto list = dynamic_cast<ListExprAST*>(expr)) {
+        return inferListType(list);
+    } else if (auto index = dynamic_cast<IndexExprAST*>(expr)) {
+        return inferIndexType(index);
     }
     
     TypeCheckResult result;
@@ -403,8 +559,9 @@ TypeCheckResult TypeChecker::inferNumberType(NumberExprAST* expr) {
         return result;
     }
     
-    // Determine if it's an integer or float based on the value
-    if (expr->value == static_cast<int>(expr->value)) {
+    // Literals with a decimal point are floats; integral literals are ints
+    // as long as they fit the native 64-bit integer
+    if (!expr->is_float && std::fabs(expr->value) < 9223372036854775808.0) {
         return TypeCheckResult(TypeFactory::createInt());
     } else {
         return TypeCheckResult(TypeFactory::createFloat());
@@ -464,8 +621,9 @@ TypeCheckResult TypeChecker::inferBinaryType(BinaryExprAST* expr) {
         case '*':
         case '/':
         case '%':
-            // Arithmetic operations
+            // Arithmetic operations; '/' is true division, a float even for ints
             if (left_type->isNumeric() && right_type->isNumeric()) {
+                if (expr->op == '/') return TypeCheckResult(TypeFactory::createFloat());
                 return TypeCheckResult(TypeFactory::promoteNumericTypes(left_type, right_type));
             } else {
                 TypeCheckResult result;
@@ -553,14 +711,102 @@ TypeCheckResult TypeChecker::inferCallType(CallExprAST* expr) {
     // Look up function
     FunctionType* func_type = lookupFunction(expr->callee, arg_types);
     if (!func_type) {
+        // Name the argument that does not fit when the function exists
         TypeCheckResult result;
-        result.addError(TypeErrorReporter::formatUndefinedFunction(expr->callee));
+        Type* declared = type_env.lookup(expr->callee);
+        if (!declared || !declared->isFunction()) {
+            result.addError(TypeErrorReporter::formatUndefinedFunction(expr->callee));
+            return result;
+        }
+        auto* declared_function = static_cast<FunctionType*>(declared);
+        if (declared_function->param_types.size() != arg_types.size()) {
+            result.addError(TypeErrorReporter::formatArgumentMismatch(
+                expr->callee, declared_function->param_types.size(), arg_types.size()));
+            return result;
+        }
+        for (size_t i = 0; i < arg_types.size(); ++i) {
+            checkDeclaredType(declared_function->param_types[i].get(), arg_types[i],
+                              "argument " + std::to_string(i + 1) + " of function '" + expr->callee + "'",
+                              result);
+        }
         return result;
     }
     
+    if (integer_preserving_builtins.count(func_type)) {
+        bool all_ints = std::all_of(arg_types.begin(), arg_types.end(), [](const Type* type) {
+            return type->kind == TypeKind::INT;
+        });
+        if (all_ints) return TypeCheckResult(TypeFactory::createInt());
+    }
+    
     return TypeCheckResult(std::unique_ptr<Type>(func_type->return_type->clone()));
 }
 
+TypeCheckResult TypeChecker::inferListType(ListExprAST* expr) {
+    if (!expr) {
+        TypeCheckResult result;
+        result.addError("Null list expression");
+        return result;
+    }
+    
+    // Element type is the common type of all elements; [] stays unknown
+    std::unique_ptr<Type> element_type = TypeFactory::createUnknown();
+    for (const auto& element : expr->elements) {
+        auto element_result = inferExpressionType(element.get());
+        if (element_result.hasErrors()) {
+            return element_result;
+        }
+        
+        if (!element_result.type->isNumeric()) {
+            TypeCheckResult result;
+            result.addError("List elements must be numeric, got: " + element_result.type->toString());
+            return result;
+        }
+        
+        element_type = TypeFactory::unifyTypes(element_type.get(), element_result.type.get());
+    }
+    
+    // Codegen stores the elements as the type checker typed them
+    if (element_type->isFloat()) {
+        range_analysis.markFloatList(expr);
+    }
+    
+    return TypeCheckResult(TypeFactory::createList(std::move(element_type)));
+}
+
+TypeCheckResult TypeChecker::inferIndexType(IndexExprAST* expr) {
+    if (!expr) {
+        TypeCheckResult result;
+        result.addError("Null index expression");
+        return result;
+    }
+    
+    auto list_result = inferExpressionType(expr->list.get());
+    if (list_result.hasErrors()) {
+        return list_result;
+    }
+    
+    auto index_result = inferExpressionType(expr->index.get());
+    if (index_result.hasErrors()) {
+        return index_result;
+    }
+    
+    if (list_result.type->kind != TypeKind::LIST) {
+        TypeCheckResult result;
+        result.addError("Cannot index a value of type " + list_result.type->toString());
+        return result;
+    }
+    
+    if (!index_result.type->isNumeric()) {
+        TypeCheckResult result;
+        result.addError("List index must be numeric, got: " + index_result.type->toString());
+        return result;
+    }
+    
+    const ListType* list_type = static_cast<const ListType*>(list_result.type.get());
+    return TypeCheckResult(std::unique_ptr<Type>(list_type->element_type->clone()));
+}
+
 bool TypeChecker::isAssignable(const Type* target, const Type* source) {
     if (!target || !source) return false;
     return target->isAssignableFrom(source);
@@ -633,6 +879,7 @@ void TypeChecker::reportWarning(const std::string& message) {
 void TypeChecker::clearMessages() {
     error_messages.clear();
     warning_messages.clear();
+    annotation_errors.clear();
 }
 
 // TypeErrorReporter Implementation
@@ -756,15 +1003,23 @@ std::unique_ptr<Type> TypeAnnotationResolver::resolveFromFunction(const Function
     }
     
     std::vector<std::unique_ptr<Type>> param_types;
-    for (const auto& param_name : func->args) {
-        // Default to double for all parameters (simplified type system)
-        auto param_type = TypeFactory::createFloat();
+    for (size_t i = 0; i < func->args.size(); ++i) {
+        // Unannotated parameters default to double (simplified type system)
+        const std::string& annotation = func->getArgAnnotation(i);
+        auto param_type = annotation.empty() ? TypeFactory::createFloat()
+                                             : resolveAnnotation(annotation);
+        if (param_type->isError()) {
+            return param_type;
+        }
         param_types.push_back(std::move(param_type));
     }
     
-    // Since current AST doesn't have return type annotations, 
-    // default to double (most Quill functions return double)
-    auto return_type = TypeFactory::createFloat();
+    // Unannotated functions return double (most Quill functions do)
+    auto return_type = func->hasReturnAnnotation() ? resolveAnnotation(func->return_type)
+                                                   : TypeFactory::createFloat();
+    if (return_type->isError()) {
+        return return_type;
+    }
     
     return TypeFactory::createFunction(std::move(param_types), std::move(return_type));
 }
@@ -2,6 +2,7 @@
 #include <sstream>
 #include <algorithm>
 #include <iostream>
+#include <cctype>
 
 using namespace quill;
 
@@ -85,6 +86,16 @@ bool ListType::equals(const Type* other) const {
     return element_type->equals(other_list->element_type.get());
 }
 
+bool ListType::isAssignableFrom(const Type* other) const {
+    if (!other || other->kind != TypeKind::LIST) return false;
+    const ListType* other_list = static_cast<const ListType*>(other);
+    
+    // Elements are stored unboxed, so only identical element types mix;
+    // unknown covers empty literals and element-generic builtins
+    return element_type->isUnknown() || other_list->element_type->isUnknown() ||
+           element_type->equals(other_list->element_type.get());
+}
+
 Type* ListType::clone() const {
     return new ListType(std::unique_ptr<Type>(element_type->clone()));
 }
@@ -659,4 +670,146 @@ const FunctionType* InterfaceType::getMethod(const std::string& name) const {
         }
     }
     return nullptr;
-}
\ No newline at end of file
+}
+// TypeAnnotationParser implementation
+std::unique_ptr<Type> TypeAnnotationParser::parseTypeAnnotation(const std::string& annotation) {
+    // Split into identifiers and the punctuation used by annotations
+    std::vector<std::string> tokens;
+    std::string current;
+    for (char c : annotation) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
+            current += c;
+            continue;
+        }
+        if (!current.empty()) {
+            tokens.push_back(current);
+            current.clear();
+        }
+        if (c == '[' || c == ']' || c == ',' || c == '|') {
+            tokens.push_back(std::string(1, c));
+        } else if (!std::isspace(static_cast<unsigned char>(c))) {
+            return TypeFactory::createError("Unexpected character in type annotation: " + annotation);
+        }
+    }
+    if (!current.empty()) {
+        tokens.push_back(current);
+    }
+    
+    if (tokens.empty()) {
+        return TypeFactory::createUnknown();
+    }
+    
+    size_t pos = 0;
+    auto type = parseFromTokens(tokens, pos);
+    if (!type->isError() && pos != tokens.size()) {
+        return TypeFactory::createError("Unexpected '" + tokens[pos] + "' in type annotation: " + annotation);
+    }
+    return type;
+}
+
+std::unique_ptr<Type> TypeAnnotationParser::parseFromTokens(const std::vector<std::string>& tokens, size_t& pos) {
+    return parseUnionType(tokens, pos);
+}
+
+std::unique_ptr<Type> TypeAnnotationParser::parsePrimitiveType(const std::string& name) {
+    if (name == "int") return TypeFactory::createInt();
+    if (name == "float") return TypeFactory::createFloat();
+    if (name == "bool") return TypeFactory::createBool();
+    if (name == "str" || name == "string") return TypeFactory::createString();
+    if (name == "void" || name == "None") return TypeFactory::createVoid();
+    return nullptr;
+}
+
+std::unique_ptr<Type> TypeAnnotationParser::parseListType(const std::vector<std::string>& tokens, size_t& pos) {
+    // list[T]
+    ++pos;
+    if (pos >= tokens.size() || tokens[pos] != "[") {
+        return TypeFactory::createError("Expected '[' after 'list'");
+    }
+    ++pos;
+    
+    auto element_type = parseFromTokens(tokens, pos);
+    if (element_type->isError()) return element_type;
+    
+    if (pos >= tokens.size() || tokens[pos] != "]") {
+        return TypeFactory::createError("Expected ']' to close list type");
+    }
+    ++pos;
+    return TypeFactory::createList(std::move(element_type));
+}
+
+std::unique_ptr<Type> TypeAnnotationParser::parseTupleType(const std::vector<std::string>& tokens, size_t& pos) {
+    // tuple[T1, T2, ...]
+    ++pos;
+    if (pos >= tokens.size() || tokens[pos] != "[") {
+        return TypeFactory::createError("Expected '[' after 'tuple'");
+    }
+    ++pos;
+    
+    std::vector<std::unique_ptr<Type>> element_types;
+    while (true) {
+        auto element_type = parseFromTokens(tokens, pos);
+        if (element_type->isError()) return element_type;
+        element_types.push_back(std::move(element_type));
+        
+        if (pos < tokens.size() && tokens[pos] == ",") {
+            ++pos;
+            continue;
+        }
+        break;
+    }
+    
+    if (pos >= tokens.size() || tokens[pos] != "]") {
+        return TypeFactory::createError("Expected ']' to close tuple type");
+    }
+    ++pos;
+    return TypeFactory::createTuple(std::move(element_types));
+}
+
+std::unique_ptr<Type> TypeAnnotationParser::parseUnionType(const std::vector<std::string>& tokens, size_t& pos) {
+    // T1 | T2 | ... ; a single member is returned unwrapped
+    std::vector<std::unique_ptr<Type>> members;
+    
+    while (true) {
+        if (pos >= tokens.size()) {
+            return TypeFactory::createError("Unexpected end of type annotation");
+        }
+        
+        const std::string& name = tokens[pos];
+        std::unique_ptr<Type> member;
+        if (name == "list") {
+            member = parseListType(tokens, pos);
+        } else if (name == "tuple") {
+            member = parseTupleType(tokens, pos);
+        } else if (auto primitive = parsePrimitiveType(name)) {
+            member = std::move(primitive);
+            ++pos;
+        } else {
+            member = parseGenericType(tokens, pos);
+        }
+        
+        if (member->isError()) return member;
+        members.push_back(std::move(member));
+        
+        if (pos < tokens.size() && tokens[pos] == "|") {
+            ++pos;
+            continue;
+        }
+        break;
+    }
+    
+    if (members.size() == 1) {
+        return std::move(members[0]);
+    }
+    return TypeFactory::createUnion(std::move(members));
+}
+
+std::unique_ptr<Type> TypeAnnotationParser::parseGenericType(const std::vector<std::string>& tokens, size_t& pos) {
+    // Type parameters are capitalized identifiers: T, Key, Value
+    const std::string& name = tokens[pos];
+    if (name.empty() || !std::isupper(static_cast<unsigned char>(name[0]))) {
+        return TypeFactory::createError("Unknown type annotation: " + name);
+    }
+    ++pos;
+    return std::make_unique<GenericType>(name);
+}